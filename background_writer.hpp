@@ -0,0 +1,111 @@
+#ifndef ZAK_BACKGROUND_WRITER_HPP
+#define ZAK_BACKGROUND_WRITER_HPP
+
+// C/C++ Libraries
+#include <atomic>
+#include <functional>
+#include <pthread.h>
+#include <thread>
+
+// Local Libraries
+#include "frame_signal.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Thread that drains a wait-free queue whenever a producer signals
+   *
+   * The recorders and the event stream queue work from the detection thread
+   * through `SpscRing`s and write it out on a thread of their own. This is
+   * that thread: it calls `drain` until nothing is left, then sleeps on a
+   * `FrameSignal` until the producer's `notify` (one non-blocking eventfd
+   * write) instead of polling. `stop` drains whatever is still queued before
+   * the thread exits.
+   */
+  class BackgroundWriter
+  {
+  public:
+    BackgroundWriter(void) : _running(false) {}
+
+    ~BackgroundWriter(void)
+    {
+      stop();
+    }
+
+    /**
+     * \brief Start the thread
+     *
+     * \param[in] _drain Writes what is queued; returns whether it found any
+     */
+    void start(std::function<bool(void)> _drain)
+    {
+      stop();
+      _drain_queue = _drain;
+      _running.store(true, std::memory_order_release);
+      _thread = std::thread(&BackgroundWriter::writerLoop, this);
+    }
+
+    /**
+     * \brief Drain the queue and join the thread
+     */
+    void stop(void)
+    {
+      _running.store(false, std::memory_order_release);
+      _signal.notify();
+      if (_thread.joinable())
+      {
+        _thread.join();
+      }
+    }
+
+    /**
+     * \brief Wake the thread after queueing (producer; never blocks)
+     */
+    void notify(void)
+    {
+      _signal.notify();
+    }
+
+    /**
+     * \brief The writer thread (valid while running; for placement)
+     */
+    pthread_t thread(void)
+    {
+      return _thread.native_handle();
+    }
+
+    bool isRunning(void) const
+    {
+      return _thread.joinable();
+    }
+
+  private:
+    static const int IDLE_WAIT_MS = 100; // longest sleep (a missed notify only delays)
+
+    std::atomic<bool> _running;
+    std::function<bool(void)> _drain_queue;
+    FrameSignal _signal;
+    std::thread _thread;
+
+    void writerLoop(void)
+    {
+      for (;;)
+      {
+        // Cleared before draining, so work queued meanwhile wakes the next wait
+        bool running = _running.load(std::memory_order_acquire);
+        _signal.clear();
+        if (_drain_queue())
+        {
+          continue;
+        }
+        if (!running)
+        {
+          break;
+        }
+        _signal.wait(IDLE_WAIT_MS);
+      }
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_BACKGROUND_WRITER_HPP
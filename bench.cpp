@@ -0,0 +1,581 @@
+// C/C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "bench_harness.hpp"
+#include "cascade_loader.hpp"
+#include "depth_codec.hpp"
+#include "face_detector.hpp"
+#include "face_embedder.hpp"
+#include "frame_dedup.hpp"
+#include "frame_kernels.hpp"
+#include "identity_index.hpp"
+#include "multi_cascade_detector.hpp"
+#include "options.hpp"
+#include "people_counter.hpp"
+#include "roi_detector.hpp"
+#include "synthetic_frames.hpp"
+#include "trace.hpp"
+
+/*
+ * Frame-path benchmark suite
+ *
+ * Times every per-frame kernel of `head_hunter` on synthetic Kinect frames at
+ * each video resolution (LOW 320x240, MEDIUM 640x480, HIGH 1280x1024):
+ *
+ * - video_to_bgr:       `getBGRVideo` conversion
+ * - depth_heat_map:     `getDepthHeatMap` colorization of 11-bit depth
+ * - depth_callback_11bit: libfreenect's unpacking of `FREENECT_DEPTH_11BIT`
+ *                       on its event thread (packed capture skips it)
+ * - depth_unpack:       `--packed-depth` unpacking on the consumer thread
+ * - depth_heat_map_packed: colorization straight from packed depth
+ * - depth_encode, depth_decode: lossless depth codec (`--record-depth`);
+ *                       the compression ratio is printed. `*_recorded` run
+ *                       on the 16-bit PNGs of `--depth-images` (e.g. written
+ *                       by `depth_decode`)
+ * - preprocess:         downscale + grayscale ahead of the cascade
+ * - rgb_path, bayer_path, yuv_path, ir_path: capture to cascade input
+ *                       (demosaic, RGB to BGR and preprocessing versus Bayer
+ *                       luma, the YUV Y plane or the IR frame as is), at the
+ *                       detector's image scale; `*_half` at half scale
+ * - detect_multiscale:  `detectMultiScale` on the `--images` footage; without
+ *                       it, on a synthetic frame whose windows the cascade
+ *                       rejects in its first stages, which understates the
+ *                       cost badly
+ * - detect_umat:        detection through the T-API (`cv::UMat`) path
+ * - detect_full_res:    `detectMultiScale` on the whole frame at full
+ *                       resolution (the cost `--roi` avoids)
+ * - roi_detect:         two-level `--roi` detection on a frame pair with a
+ *                       small moving region
+ * - two_pass_*:         preprocessing for two detection passes on one frame,
+ *                       per pass (uncached) or shared (`zak::FrameCache`)
+ * - two_cascades_*:     frontal and profile cascades on one frame, uncached
+ *                       and cached
+ * - three_cascades_*:   frontal, profile and mirrored profile, as separate
+ *                       `detectMultiScale` calls or one fused parallel scan
+ * - dedup_signature:    `--dedup` block-mean signature and comparison
+ * - annotate:           face rectangle drawing
+ * - embed_batch, embed_single: embeddings of four faces in one forward pass
+ *                       or one pass each (with `--embedding-model`)
+ * - identity_search_*:  nearest enrolled identity of an embedding, flat on a
+ *                       small gallery, and exhaustive versus inverted lists
+ *                       on a large one (whose recall is printed); the
+ *                       "resolution" is dimensions x entries
+ * - people_count:       `--people` depth-only counting on an overhead scene
+ *                       of four people (background learned beforehand)
+ * - trace_span:         one `--trace` span recorded (two clock reads and a
+ *                       ring store); the share of a 30 fps frame taken by
+ *                       the spans `head_hunter` records per frame is printed
+ *
+ * Depth cases also report the bytes they read and write per frame.
+ *
+ * Synthetic frames are deterministic (fixed seed). Detection cost depends on
+ * image content, so `--images` should point at real footage when comparing
+ * detection numbers across releases. Correctness (packed depth, the codec
+ * round trip, T-API detections, people counts) is checked by
+ * `head_hunter_check` (`make check`), not here.
+ *
+ * Usage: head_hunter_bench [--filter=<text>] [--min-time=0.5]
+ *            [--json=<path>] [--images="glob*"] [--depth-images="glob*"]
+ *            [--cascade=<xml>]
+ *            [--cascade-cache=<yml>] [--profile-cascade=<xml>] [--opencl]
+ *            [--embedding-model=<onnx>]
+ */
+
+namespace
+{
+  const cv::Size RESOLUTIONS[] = {cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 1024)};
+
+  /**
+   * \brief libfreenect's unpacker (`convert_packed_to_16bit`), which runs on
+   *        its event thread for `FREENECT_DEPTH_11BIT`
+   */
+  void unpackDepthBitSerial(const cv::Mat &_packed, cv::Mat &_depth)
+  {
+    _depth.create(_packed.rows, ((_packed.cols * 8) / 11), CV_16UC1);
+    const uint8_t *raw = _packed.ptr<uint8_t>(0);
+    uint16_t *frame = _depth.ptr<uint16_t>(0);
+    uint32_t buffer = 0;
+    int bits_in = 0;
+    for (size_t remaining = _depth.total(); remaining; --remaining)
+    {
+      while (bits_in < 11)
+      {
+        buffer = ((buffer << 8) | *(raw++));
+        bits_in += 8;
+      }
+      bits_in -= 11;
+      *(frame++) = ((buffer >> bits_in) & 0x7FF);
+    }
+  }
+
+  std::string caseName(const std::string &_kernel, cv::Size _size)
+  {
+    return (_kernel + "/" + std::to_string(_size.width) + "x" + std::to_string(_size.height));
+  }
+
+  /**
+   * \brief Synthetic gallery: `_identities` people, `_samples` noisy
+   *        embeddings each around a random (normalized) center
+   */
+  void syntheticGallery(zak::IdentityIndex &_index, std::vector<float> &_centers, int _identities, int _samples, int _dimensions)
+  {
+    cv::RNG rng(0x5A4B);
+    _centers.resize(static_cast<size_t>(_identities) * _dimensions);
+    std::vector<float> sample(_dimensions);
+    for (int identity = 0; identity < _identities; ++identity)
+    {
+      float *center = &_centers[static_cast<size_t>(identity) * _dimensions];
+      for (int i = 0; i < _dimensions; ++i)
+      {
+        center[i] = static_cast<float>(rng.uniform(-1.0, 1.0));
+      }
+      for (int s = 0; s < _samples; ++s)
+      {
+        for (int i = 0; i < _dimensions; ++i)
+        {
+          sample[i] = (center[i] + static_cast<float>(rng.uniform(-0.5, 0.5)));
+        }
+        _index.add(sample.data(), _dimensions, std::to_string(identity));
+      }
+    }
+    _index.build();
+  }
+
+  /**
+   * \brief Time the depth codec on a set of frames (cycled) and print the
+   *        compression ratio
+   */
+  void benchDepthCodec(zak::BenchHarness &_harness, zak::DepthCodec &_codec, const std::string &_encode_name, const std::string &_decode_name, const std::vector<cv::Mat> &_frames)
+  {
+    std::vector<std::vector<uint8_t> > encoded(_frames.size());
+    double raw_bytes = 0, encoded_bytes = 0;
+    cv::Mat decoded;
+    for (size_t i = 0; i < _frames.size(); ++i)
+    {
+      _codec.encode(_frames[i], encoded[i]);
+      raw_bytes += (2.0 * _frames[i].total());
+      encoded_bytes += encoded[i].size();
+    }
+
+    // Bytes per frame: raw in plus compressed out (and the reverse)
+    double bytes_per_frame = ((raw_bytes + encoded_bytes) / _frames.size());
+    size_t next = 0;
+    std::vector<uint8_t> output;
+    bool ran = _harness.run(_encode_name, _frames[0].size(), [&]() {
+      _codec.encode(_frames[next], output);
+      next = ((next + 1) % _frames.size());
+    }, bytes_per_frame);
+    next = 0;
+    ran = (_harness.run(_decode_name, _frames[0].size(), [&]() {
+      _codec.decode(encoded[next], decoded);
+      next = ((next + 1) % encoded.size());
+    }, bytes_per_frame) || ran);
+    if (ran)
+    {
+      std::cout << "  " << _encode_name << " ratio " << (raw_bytes / std::max(encoded_bytes, 1.0)) << ":1 (" << (encoded_bytes / _frames.size()) << " bytes/frame)" << std::endl;
+    }
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  zak::Options options(argc, argv);
+  zak::BenchHarness harness(options.getDouble("min-time", 0.5), options.get("filter", ""));
+  zak::DetectorSettings settings = zak::defaultDetectorSettings();
+
+  // Fixed test images for the detector (optional)
+  std::vector<cv::Mat> test_images;
+  if (options.has("images"))
+  {
+    std::vector<cv::String> paths;
+    cv::glob(options.get("images", ""), paths);
+    for (auto &path : paths)
+    {
+      cv::Mat image = cv::imread(path);
+      if (!image.empty())
+      {
+        test_images.push_back(image);
+      }
+    }
+    if (test_images.empty())
+    {
+      std::cerr << "No images match " << options.get("images", "") << std::endl;
+      return 1;
+    }
+  }
+
+  cv::CascadeClassifier cascade;
+  bool from_cache = false;
+  bool cascade_loaded = !zak::loadCascade(cascade, options.get("cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_frontalface_alt2.xml"), options.get("cascade-cache", ""), from_cache);
+  if (!cascade_loaded)
+  {
+    std::cerr << "Cascade unavailable; skipping detect_multiscale" << std::endl;
+  }
+  cv::CascadeClassifier profile_cascade;
+  bool profile_loaded = !zak::loadCascade(profile_cascade, options.get("profile-cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_profileface.xml"), "", from_cache);
+  if (!profile_loaded)
+  {
+    std::cerr << "Profile cascade unavailable; skipping two_cascades" << std::endl;
+  }
+  zak::FaceDetector detector(cascade);
+  zak::FaceDetector profile_detector(profile_cascade);
+  zak::FrameCache frame_cache;
+  zak::MultiCascadeDetector multi_cascade(cascade);
+  std::string profile_path = options.get("profile-cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_profileface.xml");
+  if (profile_loaded &&
+      (multi_cascade.addProfile(profile_path, "", zak::MultiCascadeDetector::PASS_PROFILE) || multi_cascade.addProfile(profile_path, "", zak::MultiCascadeDetector::PASS_MIRRORED_PROFILE)))
+  {
+    return 1;
+  }
+  zak::DepthColorizer colorizer;
+  zak::DepthCodec depth_codec;
+  zak::FaceEmbedder embedder;
+  if (options.has("embedding-model") && embedder.load(options.get("embedding-model", "")))
+  {
+    return 1;
+  }
+
+  // Recorded depth for the codec (optional; 16-bit PNGs of raw 11-bit values)
+  std::vector<cv::Mat> depth_images;
+  if (options.has("depth-images"))
+  {
+    std::vector<cv::String> paths;
+    cv::glob(options.get("depth-images", ""), paths);
+    for (auto &path : paths)
+    {
+      cv::Mat image = cv::imread(path, cv::IMREAD_ANYDEPTH);
+      if (image.type() == CV_16UC1)
+      {
+        depth_images.push_back(image);
+      }
+    }
+    if (depth_images.empty())
+    {
+      std::cerr << "No 16-bit depth images match " << options.get("depth-images", "") << std::endl;
+      return 1;
+    }
+  }
+
+  // T-API cases run on OpenCL with `--opencl` (when a device exists), otherwise on OpenCV's CPU fallback
+  zak::configureOpenCL(options.getBool("opencl", false), std::cout);
+  if (test_images.empty())
+  {
+    std::cerr << "No --images: detection cases run on a synthetic frame and understate detection cost" << std::endl;
+  }
+
+  zak::BenchHarness::printHeader(std::cout);
+  for (const cv::Size &size : RESOLUTIONS)
+  {
+    cv::Mat rgb_image = zak::syntheticVideo(size);
+    cv::Mat depth_image = zak::syntheticDepth(size);
+    cv::Mat bgr_image, heat_map;
+
+    harness.run(caseName("video_to_bgr", size), size, [&]() {
+      zak::convertVideoToBGR(rgb_image, bgr_image);
+    });
+
+    double pixels = size.area();
+    harness.run(caseName("depth_heat_map", size), size, [&]() {
+      colorizer.colorize(depth_image, heat_map);
+    }, (5 * pixels));
+
+    // Packed depth: the 11-bit path moves 11/8 bytes in and 2 out on the event
+    // thread, then 2 in and 3 out per pixel to colorize; the packed path moves
+    // 11/8 in and 3 out, all on the consumer.
+    cv::Mat packed_depth, unpacked_depth, packed_heat_map;
+    zak::packDepth(depth_image, packed_depth);
+    double packed_bytes = static_cast<double>(packed_depth.total());
+    harness.run(caseName("depth_callback_11bit", size), size, [&]() {
+      unpackDepthBitSerial(packed_depth, unpacked_depth);
+    }, (packed_bytes + (2 * pixels)));
+    harness.run(caseName("depth_unpack", size), size, [&]() {
+      zak::unpackDepth(packed_depth, unpacked_depth);
+    }, (packed_bytes + (2 * pixels)));
+    harness.run(caseName("depth_heat_map_packed", size), size, [&]() {
+      colorizer.colorizePacked(packed_depth, packed_heat_map);
+    }, (packed_bytes + (3 * pixels)));
+    benchDepthCodec(harness, depth_codec, caseName("depth_encode", size), caseName("depth_decode", size), std::vector<cv::Mat>(1, depth_image));
+
+    zak::convertVideoToBGR(rgb_image, bgr_image);
+    harness.run(caseName("preprocess", size), size, [&]() {
+      detector.preprocess(bgr_image, settings);
+    });
+
+    // Capture to cascade input, end to end. In RGB capture libfreenect demosaics
+    // in its callback (stood in for by OpenCV's demosaic, which is faster);
+    // Bayer capture hands over the mosaic and detection reads luma from it;
+    // YUV capture hands over UYVY and detection reads the Y plane; IR capture
+    // hands over grayscale.
+    cv::Mat bayer_image, bayer_copy, uyvy_image, uyvy_copy, ir_image, ir_copy, demosaiced, bgr_path;
+    zak::mosaicBayer(rgb_image, bayer_image);
+    zak::packUYVY(rgb_image, uyvy_image);
+    cv::cvtColor(rgb_image, ir_image, cv::COLOR_RGB2GRAY);
+    zak::FrameCache path_cache;
+    const float path_scales[] = {settings.image_scale, 2.0f};
+    for (auto scale : path_scales)
+    {
+      std::string suffix = ((scale == settings.image_scale) ? "" : "_half");
+      harness.run(caseName("rgb_path" + suffix, size), size, [&]() {
+        cv::cvtColor(bayer_image, demosaiced, cv::COLOR_BayerGB2RGB);
+        zak::convertVideoToBGR(demosaiced, bgr_path);
+        path_cache.reset(bgr_path);
+        path_cache.level(scale);
+      });
+      harness.run(caseName("bayer_path" + suffix, size), size, [&]() {
+        bayer_image.copyTo(bayer_copy);
+        path_cache.resetBayer(bayer_copy);
+        path_cache.level(scale);
+      });
+      harness.run(caseName("yuv_path" + suffix, size), size, [&]() {
+        uyvy_image.copyTo(uyvy_copy);
+        path_cache.resetUYVY(uyvy_copy);
+        path_cache.level(scale);
+      });
+      harness.run(caseName("ir_path" + suffix, size), size, [&]() {
+        ir_image.copyTo(ir_copy);
+        path_cache.resetGrayscale(ir_copy);
+        path_cache.level(scale);
+      });
+    }
+
+    // Detector input: the test images at this resolution (or the synthetic frame)
+    std::vector<cv::Mat> detection_frames;
+    if (test_images.empty())
+    {
+      detection_frames.push_back(bgr_image);
+    }
+    for (auto &image : test_images)
+    {
+      cv::Mat resized;
+      cv::resize(image, resized, size);
+      detection_frames.push_back(resized);
+    }
+
+    if (cascade_loaded && harness.selected(caseName("detect_multiscale", size)))
+    {
+      // Downscale the test images once; only the cascade is timed
+      std::vector<cv::Mat> cascade_images;
+      for (auto &frame : detection_frames)
+      {
+        cascade_images.push_back(detector.preprocess(frame, settings).clone());
+      }
+
+      size_t next = 0;
+      std::vector<cv::Rect> faces;
+      harness.run(caseName("detect_multiscale", size), size, [&]() {
+        detector.detectGrayscale(cascade_images[next], settings, faces);
+        next = ((next + 1) % cascade_images.size());
+      });
+    }
+
+    if (cascade_loaded && harness.selected(caseName("detect_umat", size)))
+    {
+      // Same frames through the T-API path
+      zak::FrameCache umat_cache;
+      umat_cache.setAccelerated(true);
+      std::vector<cv::Rect> umat_faces;
+      size_t next = 0;
+      harness.run(caseName("detect_umat", size), size, [&]() {
+        umat_cache.reset(detection_frames[next]);
+        detector.detect(umat_cache, settings, umat_faces);
+        next = ((next + 1) % detection_frames.size());
+      });
+    }
+
+    if (cascade_loaded && harness.selected(caseName("detect_full_res", size)))
+    {
+      zak::DetectorSettings full_res = settings;
+      full_res.image_scale = 1.0f;
+      full_res.min_face = 20;
+      std::vector<cv::Rect> faces;
+      cv::Mat grayscale = detector.preprocess(bgr_image, full_res).clone();
+      harness.run(caseName("detect_full_res", size), size, [&]() {
+        detector.detectGrayscale(grayscale, full_res, faces);
+      });
+    }
+
+    if (cascade_loaded && harness.selected(caseName("roi_detect", size)))
+    {
+      // Alternate two frames that differ in one small region (a distant mover)
+      cv::Mat frames[2] = {bgr_image.clone(), bgr_image.clone()};
+      cv::Rect mover((size.width / 2), (size.height / 3), (size.width / 20), (size.height / 10));
+      frames[1](mover).setTo(cv::Scalar::all(255));
+      zak::RoiDetector roi_detector(cascade);
+      std::vector<cv::Rect> faces;
+      double fine_fraction = 0;
+      size_t next = 0;
+      harness.run(caseName("roi_detect", size), size, [&]() {
+        roi_detector.detect(frames[next], settings, faces);
+        fine_fraction += roi_detector.fineFraction();
+        next ^= 1;
+      });
+      std::cout << "  roi_detect scanned " << (100 * fine_fraction / (harness.results().back().iterations + harness.warmup_iterations)) << "% of each frame at full resolution" << std::endl;
+    }
+
+    harness.run(caseName("two_pass_uncached", size), size, [&]() {
+      detector.preprocess(bgr_image, settings);
+      profile_detector.preprocess(bgr_image, settings);
+    });
+
+    harness.run(caseName("two_pass_cached", size), size, [&]() {
+      frame_cache.reset(bgr_image);
+      frame_cache.level(settings.image_scale);
+      frame_cache.level(settings.image_scale);
+    });
+
+    if (cascade_loaded && profile_loaded)
+    {
+      std::vector<cv::Rect> frontal_faces, profile_faces;
+      harness.run(caseName("two_cascades_uncached", size), size, [&]() {
+        detector.detect(bgr_image, settings, frontal_faces);
+        profile_detector.detect(bgr_image, settings, profile_faces);
+      });
+
+      harness.run(caseName("two_cascades_cached", size), size, [&]() {
+        frame_cache.reset(bgr_image);
+        detector.detect(frame_cache, settings, frontal_faces);
+        profile_detector.detect(frame_cache, settings, profile_faces);
+      });
+
+      cv::Mat mirrored_image;
+      std::vector<cv::Rect> mirrored_faces, fused_faces;
+      harness.run(caseName("three_cascades_separate", size), size, [&]() {
+        detector.detect(bgr_image, settings, frontal_faces);
+        profile_detector.detect(bgr_image, settings, profile_faces);
+        cv::flip(bgr_image, mirrored_image, 1);
+        profile_detector.detect(mirrored_image, settings, mirrored_faces);
+      });
+
+      harness.run(caseName("three_cascades_fused", size), size, [&]() {
+        frame_cache.reset(bgr_image);
+        multi_cascade.detect(frame_cache, settings, fused_faces);
+      });
+    }
+
+    // Signature of a static frame: the price of every `--dedup` frame
+    zak::FrameDeduplicator frame_dedup(6, UINT32_MAX);
+    harness.run(caseName("dedup_signature", size), size, [&]() {
+      frame_dedup.duplicate(bgr_image);
+    });
+
+    std::vector<cv::Rect> faces;
+    for (int i = 0; i < 4; ++i)
+    {
+      faces.push_back(cv::Rect(((i * size.width) / 4), (size.height / 4), (size.width / 5), (size.width / 5)));
+    }
+    harness.run(caseName("annotate", size), size, [&]() {
+      zak::annotateFaces(bgr_image, faces);
+    });
+
+    if (embedder.loaded())
+    {
+      cv::Mat embeddings;
+      harness.run(caseName("embed_batch", size), size, [&]() {
+        embedder.embed(bgr_image, faces, embeddings);
+      });
+      harness.run(caseName("embed_single", size), size, [&]() {
+        for (auto &face : faces)
+        {
+          embedder.embed(bgr_image, std::vector<cv::Rect>(1, face), embeddings);
+        }
+      });
+    }
+  }
+
+  // Identity search: 128-dimensional embeddings (SFace), 256 and 16384 entries
+  const int dimensions = 128;
+  if (harness.selected("identity_search"))
+  {
+    zak::IdentityIndex small_gallery, large_flat, large_ivf;
+    std::vector<float> small_centers, centers;
+    large_flat.ivf_threshold = UINT32_MAX;
+    syntheticGallery(small_gallery, small_centers, 32, 8, dimensions);
+    syntheticGallery(large_flat, centers, 1024, 16, dimensions);
+    syntheticGallery(large_ivf, centers, 1024, 16, dimensions);
+
+    // Queries: normalized identity centers
+    std::vector<float> queries(centers);
+    for (size_t q = 0; q < (queries.size() / dimensions); ++q)
+    {
+      float *query = &queries[q * dimensions];
+      float norm = std::sqrt(zak::dotProduct(query, query, dimensions));
+      std::transform(query, (query + dimensions), query, [norm](float _value) { return (_value / norm); });
+    }
+    size_t query_count = (queries.size() / dimensions), next = 0;
+    zak::IdentityIndex::Match match;
+    harness.run("identity_search_flat", cv::Size(dimensions, small_gallery.size()), [&]() {
+      small_gallery.search(&queries[(next % 32) * dimensions], dimensions, match);
+      ++next;
+    });
+    harness.run("identity_search_exhaustive", cv::Size(dimensions, large_flat.size()), [&]() {
+      large_flat.search(&queries[(next++ % query_count) * dimensions], dimensions, match);
+    });
+    harness.run("identity_search_ivf", cv::Size(dimensions, large_ivf.size()), [&]() {
+      large_ivf.search(&queries[(next++ % query_count) * dimensions], dimensions, match);
+    });
+
+    // Recall: the inverted lists find the identity the exhaustive search finds
+    size_t agree = 0;
+    zak::IdentityIndex::Match exact;
+    for (size_t q = 0; q < query_count; ++q)
+    {
+      large_flat.search(&queries[q * dimensions], dimensions, exact);
+      large_ivf.search(&queries[q * dimensions], dimensions, match);
+      agree += (exact.identity == match.identity);
+    }
+    std::cout << "  identity_search_ivf recall " << ((100.0 * agree) / query_count) << "% (" << large_ivf.lists() << " lists, " << large_ivf.probes << " probed)" << std::endl;
+  }
+
+  // Depth-only people counting (depth is 640x480 at every video resolution)
+  if (harness.selected("people_count"))
+  {
+    cv::Size size(640, 480);
+    std::vector<cv::Mat> scenes;
+    for (int people = 0; people <= 4; ++people)
+    {
+      scenes.push_back(zak::syntheticOverhead(size, people));
+    }
+    zak::PeopleCounter counter;
+    std::vector<zak::PeopleCounter::Person> people;
+    while (counter.learning())
+    {
+      counter.update(scenes[0], people);
+    }
+    harness.run(caseName("people_count", size), size, [&]() {
+      counter.update(scenes[4], people);
+    }, (2.0 * size.area()));
+  }
+
+  // Tracing overhead
+  if (harness.selected("trace_span"))
+  {
+    const int spans_per_frame = 24; // callbacks, conversions, copies, detection, display and waits, with margin
+    zak::tracer().enable(16384);
+    uint64_t sequence = 0;
+    if (harness.run("trace_span", cv::Size(1, 1), [&]() {
+          zak::TraceSpan span("bench", ++sequence);
+        }))
+    {
+      std::cout << "  trace_span: " << spans_per_frame << " spans per frame take " << ((100.0 * spans_per_frame * harness.results().back().median_ns) / (1e9 / 30)) << "% of a 30 fps frame" << std::endl;
+    }
+  }
+
+  if (!depth_images.empty())
+  {
+    benchDepthCodec(harness, depth_codec, "depth_encode_recorded", "depth_decode_recorded", depth_images);
+  }
+
+  if (options.has("json") && harness.writeJson(options.get("json", ""), "head_hunter_bench"))
+  {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,177 @@
+#ifndef ZAK_BENCH_HARNESS_HPP
+#define ZAK_BENCH_HARNESS_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+namespace zak
+{
+  /**
+   * \brief Timing of one kernel at one resolution
+   */
+  struct BenchResult
+  {
+    std::string name;
+    cv::Size resolution;
+    size_t iterations;
+    double median_ns; // per frame
+    double p99_ns;    // per frame
+    double ns_per_pixel;
+    double frames_per_second;
+    double bytes_per_frame; // memory read and written per frame (0: not reported)
+  };
+
+  /**
+   * \brief Minimal self-contained micro-benchmark runner
+   *
+   * Each case is warmed up, then timed one frame at a time until both
+   * `min_iterations` and `min_time_s` are reached. The median is reported
+   * (robust to scheduler noise) alongside the 99th percentile.
+   */
+  class BenchHarness
+  {
+  public:
+    /**
+     * \param[in] _filter Only run cases whose name contains this text
+     */
+    BenchHarness(double _min_time_s, const std::string &_filter)
+        : _min_time_s(_min_time_s),
+          _filter(_filter),
+          warmup_iterations(3),
+          min_iterations(10) {}
+
+    /**
+     * \brief Time `_body()`, which processes one frame of `_resolution`
+     *
+     * \param[in] _bytes_per_frame Bytes the body reads and writes per frame,
+     *                             for kernels bound by memory traffic (0: not
+     *                             reported)
+     * \return false when the case was filtered out
+     */
+    template <typename Body>
+    bool run(const std::string &_name, cv::Size _resolution, Body _body, double _bytes_per_frame = 0)
+    {
+      if (!selected(_name))
+      {
+        return false;
+      }
+
+      for (size_t i = 0; i < warmup_iterations; ++i)
+      {
+        _body();
+      }
+
+      std::vector<double> samples;
+      double elapsed_ns = 0;
+      while (samples.size() < min_iterations || elapsed_ns < (_min_time_s * 1e9))
+      {
+        Clock::time_point start = Clock::now();
+        _body();
+        double sample_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        samples.push_back(sample_ns);
+        elapsed_ns += sample_ns;
+      }
+      std::sort(samples.begin(), samples.end());
+
+      BenchResult result;
+      result.name = _name;
+      result.resolution = _resolution;
+      result.iterations = samples.size();
+      result.median_ns = samples[samples.size() / 2];
+      result.p99_ns = samples[(samples.size() * 99) / 100];
+      result.ns_per_pixel = (result.median_ns / _resolution.area());
+      result.frames_per_second = (1e9 / result.median_ns);
+      result.bytes_per_frame = _bytes_per_frame;
+      _results.push_back(result);
+      print(std::cout, result);
+      return true;
+    }
+
+    /**
+     * \brief Whether a case would run (lets callers skip expensive setup)
+     */
+    bool selected(const std::string &_name) const
+    {
+      return (_filter.empty() || _name.find(_filter) != std::string::npos);
+    }
+
+    static void printHeader(std::ostream &_out)
+    {
+      _out << std::left << std::setw(28) << "kernel" << std::setw(11) << "resolution" << std::right
+           << std::setw(8) << "iters" << std::setw(14) << "ns/frame" << std::setw(14) << "p99 ns"
+           << std::setw(10) << "ns/pixel" << std::setw(11) << "frames/s" << std::setw(13) << "bytes/frame" << std::endl;
+    }
+
+    static void print(std::ostream &_out, const BenchResult &_result)
+    {
+      _out << std::left << std::setw(28) << _result.name
+           << std::setw(11) << (std::to_string(_result.resolution.width) + "x" + std::to_string(_result.resolution.height)) << std::right
+           << std::setw(8) << _result.iterations << std::fixed << std::setprecision(0)
+           << std::setw(14) << _result.median_ns << std::setw(14) << _result.p99_ns << std::setprecision(3)
+           << std::setw(10) << _result.ns_per_pixel << std::setprecision(1)
+           << std::setw(11) << _result.frames_per_second << std::setprecision(0) << std::setw(13);
+      if (_result.bytes_per_frame > 0)
+      {
+        _out << _result.bytes_per_frame;
+      }
+      else
+      {
+        _out << "-";
+      }
+      _out << std::endl;
+    }
+
+    /**
+     * \brief Write all results as JSON (for tracking regressions across releases)
+     *
+     * \return 0 on success, -1 if the file cannot be written
+     */
+    int writeJson(const std::string &_path, const std::string &_suite) const
+    {
+      std::ofstream out(_path.c_str());
+      if (!out)
+      {
+        std::cerr << "Unable to write " << _path << std::endl;
+        return -1;
+      }
+
+      out << "{\n  \"suite\": \"" << _suite << "\",\n  \"opencv\": \"" << CV_VERSION << "\",\n  \"threads\": " << cv::getNumThreads()
+          << ",\n  \"min_time_s\": " << _min_time_s << ",\n  \"results\": [";
+      out << std::setprecision(6);
+      for (size_t i = 0; i < _results.size(); ++i)
+      {
+        const BenchResult &result = _results[i];
+        out << (i ? "," : "") << "\n    {\"name\": \"" << result.name << "\", \"width\": " << result.resolution.width
+            << ", \"height\": " << result.resolution.height << ", \"iterations\": " << result.iterations
+            << ", \"median_ns\": " << result.median_ns << ", \"p99_ns\": " << result.p99_ns
+            << ", \"ns_per_pixel\": " << result.ns_per_pixel << ", \"frames_per_second\": " << result.frames_per_second << ", \"bytes_per_frame\": " << result.bytes_per_frame << "}";
+      }
+      out << "\n  ]\n}\n";
+      return (out ? 0 : -1);
+    }
+
+    const std::vector<BenchResult> &results(void) const { return _results; }
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    double _min_time_s;
+    std::string _filter;
+    std::vector<BenchResult> _results;
+
+  public:
+    size_t warmup_iterations;
+    size_t min_iterations;
+  };
+} // namespace zak
+
+#endif // ZAK_BENCH_HARNESS_HPP
@@ -0,0 +1,281 @@
+#ifndef ZAK_CASCADE_LOADER_HPP
+#define ZAK_CASCADE_LOADER_HPP
+
+// C/C++ Libraries
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+/*
+ * Cascade classifier loading
+ * ==========================
+ *
+ * Parsing `haarcascade_frontalface_alt2.xml` means tokenizing ~40,000 decimal
+ * numbers out of XML. The first successful load re-emits the cascade as a
+ * YAML cache in which every numeric sequence is stored as a base64 encoded
+ * binary block (`cv::FileStorage::BASE64`), so later loads decode raw
+ * doubles instead of parsing text. The cache records the size and
+ * modification time of its source and is rebuilt whenever they change.
+ *
+ * Both the source and the cache are read into a string and handed to
+ * `cv::FileStorage` as in-memory documents (`cv::FileStorage::MEMORY`, which
+ * only accepts a string; mapping the file would still mean one copy).
+ */
+
+namespace zak
+{
+  /**
+   * \brief Read a whole file
+   *
+   * \return 0 on success, -1 if it cannot be read or is empty
+   */
+  inline int readFile(const std::string &_path, std::string &_contents)
+  {
+    std::ifstream in(_path.c_str(), std::ios::binary);
+    std::ostringstream contents;
+    if (!in || !(contents << in.rdbuf()))
+    {
+      return -1;
+    }
+    _contents = contents.str();
+    return (_contents.empty() ? -1 : 0);
+  }
+
+  /**
+   * \brief Identify a file version by its size and modification time
+   */
+  inline std::string fileStamp(const std::string &_path)
+  {
+    struct stat info;
+    if (stat(_path.c_str(), &info))
+    {
+      return std::string();
+    }
+    std::ostringstream stamp;
+    stamp << info.st_size << ":" << info.st_mtime;
+    return stamp.str();
+  }
+
+  /**
+   * \brief Recursively copy a `cv::FileNode` tree into a `cv::FileStorage`
+   *
+   * Sequences containing only numbers are written as `std::vector` so a
+   * storage opened with `cv::FileStorage::BASE64` emits them as binary blocks.
+   */
+  inline void copyFileNode(cv::FileStorage &_fs, const std::string &_name, const cv::FileNode &_node)
+  {
+    if (_node.isMap())
+    {
+      _fs.startWriteStruct(_name, cv::FileNode::MAP);
+      for (cv::FileNodeIterator it = _node.begin(); it != _node.end(); ++it)
+      {
+        copyFileNode(_fs, (*it).name(), *it);
+      }
+      _fs.endWriteStruct();
+    }
+    else if (_node.isSeq())
+    {
+      bool all_int = true, all_numeric = (_node.size() > 0);
+      for (cv::FileNodeIterator it = _node.begin(); all_numeric && it != _node.end(); ++it)
+      {
+        all_int = (all_int && (*it).isInt());
+        all_numeric = ((*it).isInt() || (*it).isReal());
+      }
+
+      if (all_numeric && all_int)
+      {
+        std::vector<int> values;
+        for (cv::FileNodeIterator it = _node.begin(); it != _node.end(); ++it)
+        {
+          values.push_back(static_cast<int>(*it));
+        }
+        cv::write(_fs, _name, values);
+      }
+      else if (all_numeric)
+      {
+        std::vector<double> values;
+        for (cv::FileNodeIterator it = _node.begin(); it != _node.end(); ++it)
+        {
+          values.push_back(static_cast<double>(*it));
+        }
+        cv::write(_fs, _name, values);
+      }
+      else
+      {
+        _fs.startWriteStruct(_name, cv::FileNode::SEQ);
+        for (cv::FileNodeIterator it = _node.begin(); it != _node.end(); ++it)
+        {
+          copyFileNode(_fs, std::string(), *it);
+        }
+        _fs.endWriteStruct();
+      }
+    }
+    else if (_node.isInt())
+    {
+      _fs.write(_name, static_cast<int>(_node));
+    }
+    else if (_node.isReal())
+    {
+      _fs.write(_name, static_cast<double>(_node));
+    }
+    else if (_node.isString())
+    {
+      _fs.write(_name, static_cast<std::string>(_node));
+    }
+  }
+
+  /**
+   * \brief Default cache location for a cascade: `<name>.cache.yml` in the
+   *        working directory
+   */
+  inline std::string cascadeCachePath(const std::string &_source_path)
+  {
+    std::string cache_path = _source_path.substr(_source_path.find_last_of('/') + 1);
+    if (cache_path.size() > 4 && cache_path.compare(cache_path.size() - 4, 4, ".xml") == 0)
+    {
+      cache_path.erase(cache_path.size() - 4);
+    }
+    return (cache_path + ".cache.yml");
+  }
+
+  /**
+   * \brief Load a cascade classifier, preferring the pre-serialized cache
+   *
+   * \param[out] _classifier Classifier to populate
+   * \param[in] _source_path Cascade XML shipped with OpenCV
+   * \param[in] _cache_path Binary cache (created or refreshed as required;
+   *                        an empty path disables caching)
+   * \param[out] _from_cache Whether the cache was used
+   * \return 0 on success, -1 on failure
+   */
+  inline int loadCascade(
+      cv::CascadeClassifier &_classifier,
+      const std::string &_source_path,
+      const std::string &_cache_path,
+      bool &_from_cache)
+  {
+    std::string stamp = fileStamp(_source_path);
+    _from_cache = false;
+
+    // Load from the cache when it matches the source
+    std::string document;
+    if (!_cache_path.empty() && !readFile(_cache_path, document))
+    {
+      try
+      {
+        cv::FileStorage cache(document, (cv::FileStorage::READ | cv::FileStorage::MEMORY | cv::FileStorage::FORMAT_YAML));
+        if (cache.isOpened() && static_cast<std::string>(cache["source_stamp"]) == stamp && _classifier.read(cache["cascade"]))
+        {
+          _from_cache = true;
+          return 0;
+        }
+      }
+      catch (const cv::Exception &e)
+      {
+        std::cerr << "Ignoring unreadable cascade cache " << _cache_path << ": " << e.what() << std::endl;
+      }
+    }
+
+    // Fall back to the source XML
+    if (readFile(_source_path, document))
+    {
+      std::cerr << "Unable to open cascade " << _source_path << std::endl;
+      return -1;
+    }
+    cv::FileStorage source;
+    cv::FileNode cascade;
+    try
+    {
+      source.open(document, (cv::FileStorage::READ | cv::FileStorage::MEMORY));
+      cascade = source.getFirstTopLevelNode();
+      if (!source.isOpened() || !_classifier.read(cascade))
+      {
+        // Old format cascades can only be loaded through the file path
+        if (!_classifier.load(_source_path))
+        {
+          std::cerr << "Unable to parse cascade " << _source_path << std::endl;
+          return -1;
+        }
+        return 0;
+      }
+    }
+    catch (const cv::Exception &e)
+    {
+      std::cerr << "Unable to parse cascade " << _source_path << ": " << e.what() << std::endl;
+      return -1;
+    }
+
+    // Refresh the cache for the next launch
+    if (!_cache_path.empty())
+    {
+      try
+      {
+        std::string temporary_path(_cache_path + ".tmp");
+        cv::FileStorage cache(temporary_path, (cv::FileStorage::WRITE_BASE64 | cv::FileStorage::FORMAT_YAML));
+        copyFileNode(cache, "cascade", cascade);
+        cache.write("source_stamp", stamp);
+        cache.release();
+        if (rename(temporary_path.c_str(), _cache_path.c_str()))
+        {
+          perror("rename()");
+        }
+      }
+      catch (const cv::Exception &e)
+      {
+        std::cerr << "Unable to write cascade cache " << _cache_path << ": " << e.what() << std::endl;
+      }
+    }
+
+    return 0;
+  }
+
+  /**
+   * \brief Exercise the detector before live frames arrive
+   *
+   * The first `detectMultiScale` calls pay for lazy allocations (image
+   * pyramid, integral buffers) and thread pool start-up. Running the detector
+   * on a synthetic frame of the production size moves that cost out of the
+   * time-to-first-detection. With `_accelerated`, the T-API path is exercised
+   * as well, which also builds the OpenCL kernels.
+   *
+   * \param[in] _size Size of the grayscale image the detector will receive
+   * \param[in] _iterations Number of detection passes
+   * \param[in] _accelerated Also warm up `cv::UMat` detection
+   */
+  inline void warmUpCascade(
+      cv::CascadeClassifier &_classifier,
+      cv::Size _size,
+      double _scale_factor,
+      int _min_neighbors,
+      cv::Size _min_size,
+      int _iterations = 2,
+      bool _accelerated = false)
+  {
+    cv::Mat synthetic(_size, CV_8UC1);
+    cv::randu(synthetic, 0, 256);
+    cv::GaussianBlur(synthetic, synthetic, cv::Size(5, 5), 0);
+
+    std::vector<cv::Rect> faces;
+    for (int i = 0; i < _iterations; ++i)
+    {
+      _classifier.detectMultiScale(synthetic, faces, _scale_factor, _min_neighbors, 0, _min_size);
+    }
+    if (_accelerated)
+    {
+      cv::UMat synthetic_umat = synthetic.getUMat(cv::ACCESS_READ);
+      for (int i = 0; i < _iterations; ++i)
+      {
+        _classifier.detectMultiScale(synthetic_umat, faces, _scale_factor, _min_neighbors, 0, _min_size);
+      }
+    }
+  }
+} // namespace zak
+
+#endif // ZAK_CASCADE_LOADER_HPP
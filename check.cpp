@@ -0,0 +1,208 @@
+// C/C++ Libraries
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "cascade_loader.hpp"
+#include "depth_codec.hpp"
+#include "face_detector.hpp"
+#include "frame_cache.hpp"
+#include "frame_kernels.hpp"
+#include "options.hpp"
+#include "people_counter.hpp"
+#include "synthetic_frames.hpp"
+
+/*
+ * Frame-path correctness checks
+ *
+ * Checks what the optimized frame paths of `head_hunter` must not change,
+ * on the synthetic frames of `head_hunter_bench`:
+ *
+ * - packed_depth:   unpacking packed 11-bit depth gives the original depth,
+ *                   and colorizing it packed gives the 16-bit heat map
+ * - depth_codec:    every frame round-trips the lossless depth codec
+ *                   exactly (also on the `--depth-images` PNGs)
+ * - detect_umat:    the T-API (`cv::UMat`) path finds the faces the
+ *                   `cv::Mat` path does (on `--images` when given); skipped
+ *                   when the cascade is unavailable
+ * - people_count:   scenes of zero to four people count exactly
+ *
+ * Prints one line per check and exits 1 if any failed.
+ *
+ * Usage: head_hunter_check [--images="glob*"] [--depth-images="glob*"]
+ *            [--cascade=<xml>] [--opencl]
+ */
+
+namespace
+{
+  const cv::Size RESOLUTIONS[] = {cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 1024)};
+
+  std::string checkName(const std::string &_name, const cv::Size &_size)
+  {
+    return (_name + "/" + std::to_string(_size.width) + "x" + std::to_string(_size.height));
+  }
+
+  /**
+   * \brief Print the outcome of a check
+   *
+   * \return 1 if it failed
+   */
+  unsigned report(const std::string &_name, unsigned _failures, size_t _cases)
+  {
+    if (_failures)
+    {
+      std::cout << "FAILED " << _name << ": " << _failures << " of " << _cases << std::endl;
+      return 1;
+    }
+    std::cout << "ok     " << _name << " (" << _cases << ")" << std::endl;
+    return 0;
+  }
+
+  /**
+   * \brief Count frames that do not round-trip the depth codec exactly
+   */
+  unsigned codecMismatches(zak::DepthCodec &_codec, const std::vector<cv::Mat> &_frames)
+  {
+    unsigned mismatches = 0;
+    std::vector<uint8_t> encoded;
+    cv::Mat decoded;
+    for (auto &frame : _frames)
+    {
+      if (_codec.encode(frame, encoded) || _codec.decode(encoded, decoded) || cv::norm(decoded, frame, cv::NORM_INF) != 0)
+      {
+        ++mismatches;
+      }
+    }
+    return mismatches;
+  }
+
+  /**
+   * \brief Load the images matching a glob
+   *
+   * \return 0 on success (at least one image of `_type`), -1 otherwise
+   */
+  int loadImages(const std::string &_pattern, int _flags, int _type, std::vector<cv::Mat> &_images)
+  {
+    std::vector<cv::String> paths;
+    cv::glob(_pattern, paths);
+    for (auto &path : paths)
+    {
+      cv::Mat image = cv::imread(path, _flags);
+      if (!image.empty() && image.type() == _type)
+      {
+        _images.push_back(image);
+      }
+    }
+    if (_images.empty())
+    {
+      std::cerr << "No images match " << _pattern << std::endl;
+      return -1;
+    }
+    return 0;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  zak::Options options(argc, argv);
+  zak::DetectorSettings settings = zak::defaultDetectorSettings();
+
+  std::vector<cv::Mat> test_images, depth_images;
+  if ((options.has("images") && loadImages(options.get("images", ""), cv::IMREAD_COLOR, CV_8UC3, test_images)) ||
+      (options.has("depth-images") && loadImages(options.get("depth-images", ""), cv::IMREAD_ANYDEPTH, CV_16UC1, depth_images)))
+  {
+    return 1;
+  }
+
+  cv::CascadeClassifier cascade;
+  bool from_cache = false;
+  bool cascade_loaded = !zak::loadCascade(cascade, options.get("cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_frontalface_alt2.xml"), "", from_cache);
+  zak::FaceDetector detector(cascade);
+  zak::DepthColorizer colorizer;
+  zak::DepthCodec depth_codec;
+  zak::configureOpenCL(options.getBool("opencl", false), std::cout);
+
+  unsigned failed = 0;
+  for (const cv::Size &size : RESOLUTIONS)
+  {
+    cv::Mat depth_image = zak::syntheticDepth(size);
+    cv::Mat packed_depth, unpacked_depth, heat_map, packed_heat_map;
+    zak::packDepth(depth_image, packed_depth);
+    zak::unpackDepth(packed_depth, unpacked_depth);
+    colorizer.colorize(depth_image, heat_map);
+    colorizer.colorizePacked(packed_depth, packed_heat_map);
+    failed += report(checkName("packed_depth", size), ((cv::norm(unpacked_depth, depth_image, cv::NORM_INF) != 0 || cv::norm(packed_heat_map, heat_map, cv::NORM_INF) != 0) ? 1 : 0), 1);
+
+    failed += report(checkName("depth_codec", size), codecMismatches(depth_codec, std::vector<cv::Mat>(1, depth_image)), 1);
+
+    if (!cascade_loaded)
+    {
+      continue;
+    }
+    std::vector<cv::Mat> detection_frames;
+    if (test_images.empty())
+    {
+      cv::Mat bgr_image;
+      zak::convertVideoToBGR(zak::syntheticVideo(size), bgr_image);
+      detection_frames.push_back(bgr_image);
+    }
+    for (auto &image : test_images)
+    {
+      cv::Mat resized;
+      cv::resize(image, resized, size);
+      detection_frames.push_back(resized);
+    }
+    zak::FrameCache mat_cache, umat_cache;
+    umat_cache.setAccelerated(true);
+    std::vector<cv::Rect> mat_faces, umat_faces;
+    unsigned mismatches = 0;
+    for (auto &frame : detection_frames)
+    {
+      mat_cache.reset(frame);
+      umat_cache.reset(frame);
+      detector.detect(mat_cache, settings, mat_faces);
+      detector.detect(umat_cache, settings, umat_faces);
+      if (mat_faces != umat_faces)
+      {
+        std::cerr << checkName("detect_umat", size) << ": " << umat_faces.size() << " faces, cv::Mat path found " << mat_faces.size() << std::endl;
+        ++mismatches;
+      }
+    }
+    failed += report(checkName("detect_umat", size), mismatches, detection_frames.size());
+  }
+  if (!cascade_loaded)
+  {
+    std::cout << "skip   detect_umat (cascade unavailable)" << std::endl;
+  }
+
+  if (!depth_images.empty())
+  {
+    failed += report("depth_codec/recorded", codecMismatches(depth_codec, depth_images), depth_images.size());
+  }
+
+  // Depth-only people counting (depth is 640x480 at every video resolution)
+  cv::Size depth_size(640, 480);
+  zak::PeopleCounter counter;
+  std::vector<zak::PeopleCounter::Person> people;
+  cv::Mat empty_scene = zak::syntheticOverhead(depth_size, 0);
+  while (counter.learning())
+  {
+    counter.update(empty_scene, people);
+  }
+  unsigned miscounts = 0;
+  for (int expected = 0; expected <= 4; ++expected)
+  {
+    if (counter.update(zak::syntheticOverhead(depth_size, expected), people) != static_cast<size_t>(expected))
+    {
+      std::cerr << "people_count: counted " << people.size() << " of " << expected << " people" << std::endl;
+      ++miscounts;
+    }
+  }
+  failed += report("people_count", miscounts, 5);
+
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,141 @@
+#ifndef ZAK_DAY_NIGHT_SWITCH_HPP
+#define ZAK_DAY_NIGHT_SWITCH_HPP
+
+// C/C++ Libraries
+#include <cstdint>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+namespace zak
+{
+  /**
+   * \brief Thresholds of the automatic switch between color and IR video
+   */
+  struct DayNightConfig
+  {
+    double night_below;      // mean luma under which a color frame counts as dark
+    double day_above;        // mean luma a probe must reach to return to color (hysteresis)
+    int hold_frames;         // consecutive dark frames before switching to IR; frames a probe averages
+    int settle_frames;       // frames ignored after a switch (the sensor adjusts its exposure)
+    double probe_interval_s; // seconds in IR between probes of the color camera (0: never)
+
+    DayNightConfig(void) : night_below(30), day_above(60), hold_frames(30), settle_frames(15), probe_interval_s(60) {}
+  };
+
+  /**
+   * \brief Decides when to capture color ("day") or IR ("night") video
+   *
+   * In a dark room color frames are too dark for the cascade, while the IR
+   * camera still sees faces lit by the Kinect's projector. In day mode the
+   * switch watches the mean luma of the color frames and asks for IR once
+   * `hold_frames` frames in a row are darker than `night_below`.
+   *
+   * IR frames say nothing about visible light (the projector lights the
+   * scene either way), so in night mode the switch probes the color camera
+   * every `probe_interval_s`: it asks for color, averages the luma of
+   * `hold_frames` frames after the exposure settles, and stays in day mode
+   * only if the average reaches `day_above`.
+   */
+  class DayNightSwitch
+  {
+  public:
+    enum Mode
+    {
+      DAY,
+      NIGHT,
+    };
+
+    DayNightSwitch(const DayNightConfig &_config = DayNightConfig()) : _mode(DAY), _probing(false), _frames(0), _dark_frames(0), _luma_sum(0), _next_probe(0), _switches(0), config(_config) {}
+
+    /**
+     * \brief Feed the mean luma of the latest frame (captured in `mode`)
+     *
+     * \param[in] _tick `cv::getTickCount` of the frame
+     * \return true when the capture must switch to the new `mode`
+     */
+    bool update(double _mean_luma, int64 _tick)
+    {
+      if (++_frames <= config.settle_frames)
+      {
+        return false;
+      }
+
+      if (_mode == NIGHT)
+      {
+        if (config.probe_interval_s > 0 && _tick >= _next_probe)
+        {
+          enter(DAY, _tick);
+          _probing = true;
+          return true;
+        }
+        return false;
+      }
+
+      if (_probing)
+      {
+        _luma_sum += _mean_luma;
+        if ((_frames - config.settle_frames) < config.hold_frames)
+        {
+          return false;
+        }
+        if ((_luma_sum / config.hold_frames) >= config.day_above)
+        {
+          _probing = false;
+          return false;
+        }
+        enter(NIGHT, _tick);
+        return true;
+      }
+
+      _dark_frames = ((_mean_luma < config.night_below) ? (_dark_frames + 1) : 0);
+      if (_dark_frames >= config.hold_frames)
+      {
+        enter(NIGHT, _tick);
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * \brief Mean luma of a grayscale frame (any scale)
+     */
+    static double meanLuma(const cv::Mat &_grayscale)
+    {
+      return cv::mean(_grayscale)[0];
+    }
+
+    Mode mode(void) const { return _mode; }
+
+    /**
+     * \brief Whether day mode is only a probe of the color camera
+     */
+    bool probing(void) const { return _probing; }
+
+    uint64_t switches(void) const { return _switches; }
+
+  private:
+    Mode _mode;
+    bool _probing;
+    int _frames;
+    int _dark_frames;
+    double _luma_sum;
+    int64 _next_probe;
+    uint64_t _switches;
+
+    void enter(Mode _new_mode, int64 _tick)
+    {
+      _mode = _new_mode;
+      _probing = false;
+      _frames = _dark_frames = 0;
+      _luma_sum = 0;
+      _next_probe = (_tick + static_cast<int64>(config.probe_interval_s * cv::getTickFrequency()));
+      ++_switches;
+    }
+
+  public:
+    DayNightConfig config; // thresholds (may be tuned between frames)
+  };
+} // namespace zak
+
+#endif // ZAK_DAY_NIGHT_SWITCH_HPP
@@ -0,0 +1,398 @@
+#ifndef ZAK_DEPTH_CODEC_HPP
+#define ZAK_DEPTH_CODEC_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+namespace zak
+{
+  static const uint16_t DEPTH_INVALID = 2047; // Kinect "no reading"
+
+  /**
+   * \brief Lossless codec for 11-bit Kinect depth
+   *
+   * Raw 640x480 depth in 16-bit words is 18 MB/s at 30 fps. Depth is smooth
+   * along columns and has large "no reading" areas (shadows, out of range),
+   * which this codec exploits:
+   *
+   * - prediction: each pixel is predicted by the pixel above it (the row
+   *   delta), or by the last valid pixel of its row when the pixel above is
+   *   invalid (and on a strip's first row)
+   * - invalid runs: consecutive 2047 values in a row are coded as one run
+   * - entropy: residuals (zigzag mapped) and run lengths are Rice coded with
+   *   parameters that adapt to the running mean, as in LOCO-I; rare large
+   *   values escape to a fixed 16-bit field
+   *
+   * The frame is cut into independent horizontal strips, which are coded in
+   * parallel (`cv::parallel_for_`) and can be decoded in parallel.
+   *
+   * Frame layout (little-endian):
+   *
+   *     "ZKD1" | u16 width | u16 height | u16 strips | u16 reserved |
+   *     u32 strip bytes[strips] | strip payloads
+   *
+   * Input values must be 11-bit (0 - 2047).
+   */
+  class DepthCodec
+  {
+  public:
+    /**
+     * \param[in] _strips Independently coded strips per frame (1 - 64)
+     */
+    DepthCodec(int _strips = 8) : strips(_strips) {}
+
+    /**
+     * \brief Compress a depth frame (`CV_16UC1`)
+     *
+     * \param[out] _encoded Compressed frame (replaces the contents)
+     * \return 0 on success, -1 on an unsupported frame
+     */
+    int encode(const cv::Mat &_depth, std::vector<uint8_t> &_encoded)
+    {
+      if (_depth.type() != CV_16UC1 || _depth.empty() || _depth.cols > 0xFFFF || _depth.rows > 0xFFFF)
+      {
+        return -1;
+      }
+      int count = std::max(1, std::min(std::min(strips, 64), _depth.rows));
+      _strip_buffers.resize(count);
+      cv::parallel_for_(cv::Range(0, count), [&](const cv::Range &_range) {
+        for (int strip = _range.start; strip < _range.end; ++strip)
+        {
+          encodeStrip(_depth, stripBegin(strip, count, _depth.rows), stripBegin((strip + 1), count, _depth.rows), _strip_buffers[strip]);
+        }
+      });
+
+      _encoded.clear();
+      putU32(_encoded, MAGIC);
+      putU16(_encoded, static_cast<uint16_t>(_depth.cols));
+      putU16(_encoded, static_cast<uint16_t>(_depth.rows));
+      putU16(_encoded, static_cast<uint16_t>(count));
+      putU16(_encoded, 0);
+      for (auto &buffer : _strip_buffers)
+      {
+        putU32(_encoded, static_cast<uint32_t>(buffer.size()));
+      }
+      for (auto &buffer : _strip_buffers)
+      {
+        _encoded.insert(_encoded.end(), buffer.begin(), buffer.end());
+      }
+      return 0;
+    }
+
+    /**
+     * \brief Decompress a frame written by `encode`
+     *
+     * \param[out] _depth Depth frame (`CV_16UC1`)
+     * \return 0 on success, -1 on a malformed frame
+     */
+    int decode(const uint8_t *_data, size_t _size, cv::Mat &_depth)
+    {
+      if (_size < HEADER_BYTES || getU32(_data) != MAGIC)
+      {
+        return -1;
+      }
+      int width = getU16(_data + 4), height = getU16(_data + 6), count = getU16(_data + 8);
+      size_t offset = (HEADER_BYTES + (4 * static_cast<size_t>(count)));
+      if (!width || !height || !count || count > height || offset > _size)
+      {
+        return -1;
+      }
+      std::vector<size_t> begins(count + 1, offset);
+      for (int strip = 0; strip < count; ++strip)
+      {
+        begins[strip + 1] = (begins[strip] + getU32(_data + HEADER_BYTES + (4 * strip)));
+      }
+      if (begins[count] > _size)
+      {
+        return -1;
+      }
+
+      _depth.create(height, width, CV_16UC1);
+      std::atomic<bool> failed(false); // set by any strip worker
+      cv::parallel_for_(cv::Range(0, count), [&](const cv::Range &_range) {
+        for (int strip = _range.start; strip < _range.end; ++strip)
+        {
+          if (decodeStrip((_data + begins[strip]), (begins[strip + 1] - begins[strip]), stripBegin(strip, count, height), stripBegin((strip + 1), count, height), _depth))
+          {
+            failed.store(true, std::memory_order_relaxed);
+          }
+        }
+      });
+      return (failed.load() ? -1 : 0);
+    }
+
+    int decode(const std::vector<uint8_t> &_encoded, cv::Mat &_depth)
+    {
+      return decode(_encoded.data(), _encoded.size(), _depth);
+    }
+
+  private:
+    static const uint32_t MAGIC = 0x31444B5A; // "ZKD1"
+    static const size_t HEADER_BYTES = 12;
+    static const unsigned UNARY_LIMIT = 24; // longer quotients escape to a 16-bit field
+    static const unsigned ESCAPE_BITS = 16;
+    static const unsigned MAX_K = 12;
+
+    std::vector<std::vector<uint8_t> > _strip_buffers;
+
+    /**
+     * \brief Adaptive Rice parameter (running mean of the coded values)
+     */
+    struct RiceContext
+    {
+      uint32_t sum;
+      uint32_t count;
+
+      RiceContext(void) : sum(8), count(1) {}
+
+      unsigned k(void) const
+      {
+        unsigned parameter = 0;
+        while ((count << parameter) < sum && parameter < MAX_K)
+        {
+          ++parameter;
+        }
+        return parameter;
+      }
+
+      void update(uint32_t _value)
+      {
+        sum += _value;
+        if (++count == 64)
+        {
+          sum >>= 1;
+          count >>= 1;
+        }
+      }
+    };
+
+    /**
+     * \brief Most significant bit first bit packing
+     */
+    class BitWriter
+    {
+    public:
+      BitWriter(std::vector<uint8_t> &_out) : _bytes(_out), _accumulator(0), _bits(0) {}
+
+      /**
+       * \brief Append the low `_count` (<= 32) bits of `_value`
+       */
+      void put(uint32_t _value, unsigned _count)
+      {
+        _accumulator = ((_accumulator << _count) | (_value & ((_count < 32) ? ((1u << _count) - 1) : 0xFFFFFFFFu)));
+        _bits += _count;
+        while (_bits >= 8)
+        {
+          _bits -= 8;
+          _bytes.push_back(static_cast<uint8_t>(_accumulator >> _bits));
+        }
+      }
+
+      void putRice(uint32_t _value, unsigned _k)
+      {
+        uint32_t quotient = (_value >> _k);
+        if (quotient < UNARY_LIMIT)
+        {
+          put(((1u << (quotient + 1)) - 2), (quotient + 1)); // quotient ones, then a zero
+          put(_value, _k);
+        }
+        else
+        {
+          put(((1u << UNARY_LIMIT) - 1), UNARY_LIMIT);
+          put(_value, ESCAPE_BITS);
+        }
+      }
+
+      void flush(void)
+      {
+        if (_bits)
+        {
+          put(0, (8 - _bits));
+        }
+      }
+
+    private:
+      std::vector<uint8_t> &_bytes;
+      uint64_t _accumulator;
+      unsigned _bits;
+    };
+
+    class BitReader
+    {
+    public:
+      BitReader(const uint8_t *_data, size_t _size) : _next(_data), _end(_data + _size), _accumulator(0), _bits(0), _overrun(0) {}
+
+      uint32_t get(unsigned _count)
+      {
+        while (_bits < _count)
+        {
+          _accumulator = ((_accumulator << 8) | ((_next < _end) ? *_next++ : (++_overrun, 0)));
+          _bits += 8;
+        }
+        _bits -= _count;
+        return static_cast<uint32_t>((_accumulator >> _bits) & ((1ull << _count) - 1));
+      }
+
+      uint32_t getRice(unsigned _k)
+      {
+        unsigned quotient = 0;
+        while (quotient < UNARY_LIMIT && get(1))
+        {
+          ++quotient;
+        }
+        if (quotient == UNARY_LIMIT)
+        {
+          return get(ESCAPE_BITS);
+        }
+        return ((quotient << _k) | get(_k));
+      }
+
+      /**
+       * \brief Whether reads went past the end of the data (beyond the final
+       *        byte's padding)
+       */
+      bool overrun(void) const { return (_overrun > 1); }
+
+    private:
+      const uint8_t *_next;
+      const uint8_t *_end;
+      uint64_t _accumulator;
+      unsigned _bits;
+      unsigned _overrun;
+    };
+
+    static int stripBegin(int _strip, int _count, int _rows)
+    {
+      return static_cast<int>((static_cast<int64_t>(_strip) * _rows) / _count);
+    }
+
+    static uint32_t zigzag(int _residual)
+    {
+      return ((_residual < 0) ? ((static_cast<uint32_t>(-_residual) << 1) - 1) : (static_cast<uint32_t>(_residual) << 1));
+    }
+
+    static int unzigzag(uint32_t _value)
+    {
+      return ((_value & 1) ? -static_cast<int>((_value + 1) >> 1) : static_cast<int>(_value >> 1));
+    }
+
+    /**
+     * \brief Code rows [_begin, _end); symbol 0 starts an invalid run, other
+     *        symbols are zigzag residuals plus one
+     */
+    static void encodeStrip(const cv::Mat &_depth, int _begin, int _end, std::vector<uint8_t> &_out)
+    {
+      _out.clear();
+      BitWriter writer(_out);
+      RiceContext residuals, runs;
+      int last = 1024;
+      for (int r = _begin; r < _end; ++r)
+      {
+        const uint16_t *row = _depth.ptr<uint16_t>(r);
+        const uint16_t *above = ((r > _begin) ? _depth.ptr<uint16_t>(r - 1) : nullptr);
+        for (int c = 0; c < _depth.cols;)
+        {
+          int value = (row[c] & 0x7FF);
+          if (value == DEPTH_INVALID)
+          {
+            int run = 1;
+            while ((c + run) < _depth.cols && (row[c + run] & 0x7FF) == DEPTH_INVALID)
+            {
+              ++run;
+            }
+            writer.putRice(0, residuals.k());
+            residuals.update(0);
+            writer.putRice(static_cast<uint32_t>(run - 1), runs.k());
+            runs.update(static_cast<uint32_t>(run - 1));
+            c += run;
+            continue;
+          }
+          int up = (above ? (above[c] & 0x7FF) : DEPTH_INVALID);
+          int prediction = ((up != DEPTH_INVALID) ? up : last);
+          uint32_t symbol = (zigzag(value - prediction) + 1);
+          writer.putRice(symbol, residuals.k());
+          residuals.update(symbol);
+          last = value;
+          ++c;
+        }
+      }
+      writer.flush();
+    }
+
+    static int decodeStrip(const uint8_t *_data, size_t _size, int _begin, int _end, cv::Mat &_depth)
+    {
+      BitReader reader(_data, _size);
+      RiceContext residuals, runs;
+      int last = 1024;
+      for (int r = _begin; r < _end; ++r)
+      {
+        uint16_t *row = _depth.ptr<uint16_t>(r);
+        const uint16_t *above = ((r > _begin) ? _depth.ptr<uint16_t>(r - 1) : nullptr);
+        for (int c = 0; c < _depth.cols;)
+        {
+          uint32_t symbol = reader.getRice(residuals.k());
+          residuals.update(symbol);
+          if (!symbol)
+          {
+            uint32_t run = (reader.getRice(runs.k()) + 1);
+            runs.update(run - 1);
+            if (run > static_cast<uint32_t>(_depth.cols - c))
+            {
+              return -1;
+            }
+            std::fill(row + c, row + c + run, DEPTH_INVALID);
+            c += run;
+            continue;
+          }
+          int prediction = ((above && above[c] != DEPTH_INVALID) ? above[c] : last);
+          int value = (prediction + unzigzag(symbol - 1));
+          if (value < 0 || value >= DEPTH_INVALID)
+          {
+            return -1;
+          }
+          row[c++] = static_cast<uint16_t>(value);
+          last = value;
+        }
+        if (reader.overrun())
+        {
+          return -1;
+        }
+      }
+      return 0;
+    }
+
+    static void putU16(std::vector<uint8_t> &_out, uint16_t _value)
+    {
+      _out.push_back(static_cast<uint8_t>(_value));
+      _out.push_back(static_cast<uint8_t>(_value >> 8));
+    }
+
+    static void putU32(std::vector<uint8_t> &_out, uint32_t _value)
+    {
+      putU16(_out, static_cast<uint16_t>(_value));
+      putU16(_out, static_cast<uint16_t>(_value >> 16));
+    }
+
+    static uint16_t getU16(const uint8_t *_data)
+    {
+      return static_cast<uint16_t>(_data[0] | (_data[1] << 8));
+    }
+
+    static uint32_t getU32(const uint8_t *_data)
+    {
+      return (getU16(_data) | (static_cast<uint32_t>(getU16(_data + 2)) << 16));
+    }
+
+  public:
+    int strips; // independently coded strips per frame (1 - 64)
+  };
+} // namespace zak
+
+#endif // ZAK_DEPTH_CODEC_HPP
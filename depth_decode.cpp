@@ -0,0 +1,97 @@
+// C/C++ Libraries
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "depth_recorder.hpp"
+
+/*
+ * Depth recording decoder
+ *
+ * Converts a lossless depth recording or snapshot written by `head_hunter
+ * --record-depth=...` or `--depth-snapshot=zkd` into 16-bit PNG images
+ * (`<prefix>-<frame>.png`, raw 11-bit values), and lists the frames with
+ * their timestamps and compression ratio.
+ *
+ * Usage: depth_decode [--list] <recording.zkd> [output prefix (default: depth)]
+ */
+
+int main(int argc, char **argv)
+{
+  bool list_only = false;
+  std::vector<std::string> arguments;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp(argv[i], "--list"))
+    {
+      list_only = true;
+    }
+    else
+    {
+      arguments.push_back(argv[i]);
+    }
+  }
+  if (arguments.empty())
+  {
+    std::cerr << "Usage: depth_decode [--list] <recording.zkd> [output prefix]" << std::endl;
+    return 1;
+  }
+  std::string prefix = ((arguments.size() > 1) ? arguments[1] : "depth");
+
+  FILE *input = std::fopen(arguments[0].c_str(), "rb");
+  if (!input)
+  {
+    perror(arguments[0].c_str());
+    return 1;
+  }
+  if (zak::depth_file::readHeader(input))
+  {
+    std::cerr << "Not a depth recording" << std::endl;
+    return 1;
+  }
+
+  zak::DepthCodec codec;
+  std::vector<uint8_t> payload;
+  cv::Mat depth;
+  uint64_t timestamp = 0;
+  unsigned frame = 0;
+  int result;
+  while (!(result = zak::depth_file::readFrame(input, payload, timestamp)))
+  {
+    if (codec.decode(payload, depth))
+    {
+      std::cerr << "Corrupt frame " << frame << std::endl;
+      return 1;
+    }
+    std::printf("%u,%llu,%dx%d,%zu,%.2f\n",
+                frame,
+                static_cast<unsigned long long>(timestamp),
+                depth.cols,
+                depth.rows,
+                payload.size(),
+                ((2.0 * depth.total()) / payload.size()));
+    if (!list_only)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "-%06u.png", frame);
+      if (!cv::imwrite(prefix + name, depth))
+      {
+        std::cerr << "Cannot write " << prefix << name << std::endl;
+        return 1;
+      }
+    }
+    ++frame;
+  }
+  if (result < 0)
+  {
+    std::cerr << "Truncated frame " << frame << std::endl;
+  }
+  std::fclose(input);
+  return 0;
+}
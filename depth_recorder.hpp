@@ -0,0 +1,298 @@
+#ifndef ZAK_DEPTH_RECORDER_HPP
+#define ZAK_DEPTH_RECORDER_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "background_writer.hpp"
+#include "depth_codec.hpp"
+#include "spsc_ring.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Layout of depth recordings (`.zkd`)
+   *
+   *     "ZKDS" | u32 version |
+   *     per frame: u32 payload bytes | u64 timestamp (ns) | DepthCodec frame
+   *
+   * All fields are little-endian. A snapshot is a recording of one frame.
+   */
+  namespace depth_file
+  {
+    static const char MAGIC[4] = {'Z', 'K', 'D', 'S'};
+    static const uint32_t VERSION = 1;
+    static const size_t HEADER_BYTES = 8;
+    static const size_t FRAME_HEADER_BYTES = 12;
+
+    inline void putLE(uint8_t *_out, uint64_t _value, int _bytes)
+    {
+      for (int i = 0; i < _bytes; ++i)
+      {
+        _out[i] = static_cast<uint8_t>(_value >> (8 * i));
+      }
+    }
+
+    inline uint64_t getLE(const uint8_t *_data, int _bytes)
+    {
+      uint64_t value = 0;
+      for (int i = (_bytes - 1); i >= 0; --i)
+      {
+        value = ((value << 8) | _data[i]);
+      }
+      return value;
+    }
+
+    /**
+     * \return 0 on success, -1 on a write error
+     */
+    inline int writeHeader(FILE *_file)
+    {
+      uint8_t header[HEADER_BYTES];
+      std::copy(MAGIC, (MAGIC + 4), header);
+      putLE((header + 4), VERSION, 4);
+      return ((fwrite(header, 1, sizeof(header), _file) == sizeof(header)) ? 0 : -1);
+    }
+
+    /**
+     * \return 0 on success, -1 on a file that is not a depth recording
+     */
+    inline int readHeader(FILE *_file)
+    {
+      uint8_t header[HEADER_BYTES];
+      if (fread(header, 1, sizeof(header), _file) != sizeof(header) || !std::equal(MAGIC, (MAGIC + 4), header) || getLE((header + 4), 4) != VERSION)
+      {
+        return -1;
+      }
+      return 0;
+    }
+
+    inline int writeFrame(FILE *_file, const std::vector<uint8_t> &_payload, uint64_t _timestamp)
+    {
+      uint8_t header[FRAME_HEADER_BYTES];
+      putLE(header, _payload.size(), 4);
+      putLE((header + 4), _timestamp, 8);
+      if (fwrite(header, 1, sizeof(header), _file) != sizeof(header) || fwrite(_payload.data(), 1, _payload.size(), _file) != _payload.size())
+      {
+        return -1;
+      }
+      return 0;
+    }
+
+    /**
+     * \return 0 on success, 1 at the end of the file, -1 on a truncated frame
+     */
+    inline int readFrame(FILE *_file, std::vector<uint8_t> &_payload, uint64_t &_timestamp)
+    {
+      uint8_t header[FRAME_HEADER_BYTES];
+      size_t read = fread(header, 1, sizeof(header), _file);
+      if (!read)
+      {
+        return 1;
+      }
+      if (read != sizeof(header))
+      {
+        return -1;
+      }
+      _payload.resize(getLE(header, 4));
+      _timestamp = getLE((header + 4), 8);
+      return ((fread(_payload.data(), 1, _payload.size(), _file) == _payload.size()) ? 0 : -1);
+    }
+
+    /**
+     * \brief Save one depth frame as a single-frame recording
+     *
+     * \return 0 on success, -1 on failure
+     */
+    inline int writeSnapshot(const std::string &_path, const cv::Mat &_depth, uint64_t _timestamp)
+    {
+      DepthCodec codec;
+      std::vector<uint8_t> encoded;
+      if (codec.encode(_depth, encoded))
+      {
+        return -1;
+      }
+      FILE *file = fopen(_path.c_str(), "wb");
+      if (!file)
+      {
+        return -1;
+      }
+      int result = ((writeHeader(file) || writeFrame(file, encoded, _timestamp)) ? -1 : 0);
+      return ((fclose(file) || result) ? -1 : 0);
+    }
+  } // namespace depth_file
+
+  /**
+   * \brief Continuous lossless recording of raw depth
+   *
+   * Same threading as `RecordingSink`: `submit` copies the frame into one of
+   * a fixed set of slots and queues it through a wait-free ring, and a
+   * background writer compresses it with `DepthCodec` and appends it to the
+   * file. When the writer falls behind, frames are dropped and counted.
+   */
+  class DepthRecorder
+  {
+  public:
+    DepthRecorder(void) : _file(nullptr), _dropped(0), _frames(0), _raw_bytes(0), _encoded_bytes(0) {}
+
+    ~DepthRecorder(void)
+    {
+      close();
+    }
+
+    /**
+     * \brief Create the recording and start the writer thread
+     *
+     * \param[in] _path Recording file (`.zkd`; replaced if it exists)
+     * \param[in] _size Depth frame size (`CV_16UC1`)
+     * \return 0 on success, -1 on failure
+     */
+    int open(const std::string &_path, cv::Size _size)
+    {
+      close();
+      _file = fopen(_path.c_str(), "wb");
+      if (!_file || depth_file::writeHeader(_file))
+      {
+        perror(("Cannot create depth recording " + _path).c_str());
+        close();
+        return -1;
+      }
+      _frame_size = _size;
+      for (size_t i = 0; i < FRAME_SLOTS; ++i)
+      {
+        _slots[i].depth.create(_size, CV_16UC1);
+      }
+      if (!_free.size())
+      {
+        for (size_t i = 0; i < FRAME_SLOTS; ++i)
+        {
+          _free.tryPush(i);
+        }
+      }
+      _encoded.reserve(_size.area());
+
+      _writer.start([this]() { return drain(); });
+      return 0;
+    }
+
+    /**
+     * \brief Write the queued frames and close the file
+     */
+    void close(void)
+    {
+      _writer.stop();
+      if (_file)
+      {
+        fclose(_file);
+        _file = nullptr;
+      }
+    }
+
+    pthread_t writerThread(void)
+    {
+      return _writer.thread();
+    }
+
+    bool isOpen(void) const
+    {
+      return _writer.isRunning();
+    }
+
+    /**
+     * \brief Queue a raw depth frame (detection thread; never blocks)
+     *
+     * \param[in] _timestamp Capture time (ns, e.g. `detectionTimestamp()`)
+     * \return false if the writer was behind and the frame was dropped
+     */
+    bool submit(const cv::Mat &_depth, uint64_t _timestamp)
+    {
+      size_t slot;
+      if (_depth.size() != _frame_size || _depth.type() != CV_16UC1 || !_free.tryPop(slot))
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      _depth.copyTo(_slots[slot].depth);
+      _slots[slot].timestamp = _timestamp;
+      _pending.tryPush(slot);
+      _writer.notify();
+      return true;
+    }
+
+    uint64_t dropped(void) const { return _dropped.load(std::memory_order_relaxed); }
+    uint64_t frames(void) const { return _frames.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Raw over compressed size of the frames written so far
+     */
+    double ratio(void) const
+    {
+      uint64_t encoded = _encoded_bytes.load(std::memory_order_relaxed);
+      return (encoded ? (static_cast<double>(_raw_bytes.load(std::memory_order_relaxed)) / encoded) : 0);
+    }
+
+  private:
+    static const size_t FRAME_SLOTS = 4;
+
+    struct FrameSlot
+    {
+      cv::Mat depth;
+      uint64_t timestamp;
+    };
+
+    FILE *_file;
+    cv::Size _frame_size;
+    FrameSlot _slots[FRAME_SLOTS];
+    SpscRing<size_t, FRAME_SLOTS> _pending; // detection thread -> writer
+    SpscRing<size_t, FRAME_SLOTS> _free;    // writer -> detection thread
+    DepthCodec _codec;
+    std::vector<uint8_t> _encoded;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<uint64_t> _frames;
+    std::atomic<uint64_t> _raw_bytes;
+    std::atomic<uint64_t> _encoded_bytes;
+    BackgroundWriter _writer; // last: stopped before the members it drains are destroyed
+
+    /**
+     * \brief Write the queued frames (writer thread)
+     *
+     * \return Whether there were any
+     */
+    bool drain(void)
+    {
+      size_t slot;
+      bool found = false;
+      while (_pending.tryPop(slot))
+      {
+        write(_slots[slot]);
+        _free.tryPush(slot);
+        found = true;
+      }
+      return found;
+    }
+
+    void write(const FrameSlot &_frame)
+    {
+      if (_codec.encode(_frame.depth, _encoded) || depth_file::writeFrame(_file, _encoded, _frame.timestamp))
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      _frames.fetch_add(1, std::memory_order_relaxed);
+      _raw_bytes.fetch_add((_frame.depth.total() * 2), std::memory_order_relaxed);
+      _encoded_bytes.fetch_add((_encoded.size() + depth_file::FRAME_HEADER_BYTES), std::memory_order_relaxed);
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_DEPTH_RECORDER_HPP
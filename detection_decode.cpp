@@ -0,0 +1,169 @@
+// C/C++ Libraries
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Local Libraries
+#include "detection_stream.hpp"
+
+/*
+ * Detection stream decoder
+ *
+ * Converts the binary detection event stream written by `head_hunter
+ * --events=...` into CSV (one row per face, or one empty row for frames
+ * without faces) or JSON lines (one object per frame).
+ *
+ * Usage: detection_decode [--json] [stream file (default: stdin)]
+ */
+
+namespace
+{
+  void printCsv(const zak::DetectionEvent &_event)
+  {
+    if (!_event.face_count)
+    {
+      std::printf("%llu,%u,%.2f,0,,,,,,\n",
+                  static_cast<unsigned long long>(_event.timestamp_ns),
+                  _event.frame_sequence,
+                  (_event.tilt_centidegrees / 100.0));
+    }
+    for (uint8_t i = 0; i < _event.face_count; ++i)
+    {
+      const zak::DetectionFace &face = _event.faces[i];
+      std::printf("%llu,%u,%.2f,%u,%u,%d,%d,%u,%u,",
+                  static_cast<unsigned long long>(_event.timestamp_ns),
+                  _event.frame_sequence,
+                  (_event.tilt_centidegrees / 100.0),
+                  _event.face_count,
+                  face.track_id,
+                  face.x,
+                  face.y,
+                  face.width,
+                  face.height);
+      if (face.distance_mm)
+      {
+        std::printf("%u", face.distance_mm);
+      }
+      std::printf("\n");
+    }
+  }
+
+  void printJson(const zak::DetectionEvent &_event)
+  {
+    std::printf("{\"timestamp_ns\":%llu,\"frame\":%u,\"tilt_degrees\":%.2f,\"faces\":[",
+                static_cast<unsigned long long>(_event.timestamp_ns),
+                _event.frame_sequence,
+                (_event.tilt_centidegrees / 100.0));
+    for (uint8_t i = 0; i < _event.face_count; ++i)
+    {
+      const zak::DetectionFace &face = _event.faces[i];
+      std::printf("%s{\"track\":%u,\"x\":%d,\"y\":%d,\"width\":%u,\"height\":%u,\"distance_mm\":",
+                  (i ? "," : ""),
+                  face.track_id,
+                  face.x,
+                  face.y,
+                  face.width,
+                  face.height);
+      if (face.distance_mm)
+      {
+        std::printf("%u}", face.distance_mm);
+      }
+      else
+      {
+        std::printf("null}");
+      }
+    }
+    std::printf("]}\n");
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  bool json = false;
+  FILE *input = stdin;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp(argv[i], "--json"))
+    {
+      json = true;
+    }
+    else if (!(input = std::fopen(argv[i], "rb")))
+    {
+      perror(argv[i]);
+      return 1;
+    }
+  }
+
+  // Validate the stream header
+  std::vector<uint8_t> buffer(zak::DETECTION_STREAM_HEADER_BYTES);
+  size_t header_bytes = 0;
+  while (header_bytes < buffer.size())
+  {
+    ssize_t count = read(fileno(input), &buffer[header_bytes], (buffer.size() - header_bytes));
+    if (count <= 0)
+    {
+      break;
+    }
+    header_bytes += count;
+  }
+  if (header_bytes != buffer.size() || zak::decodeDetectionStreamHeader(&buffer[0], buffer.size()) < 0)
+  {
+    std::cerr << "Not a detection stream" << std::endl;
+    return 1;
+  }
+  if (!json)
+  {
+    std::printf("timestamp_ns,frame,tilt_degrees,face_count,track,x,y,width,height,distance_mm\n");
+  }
+
+  // Decode records as they arrive (works on a live pipe)
+  size_t pending = 0;
+  buffer.assign(64 * 1024, 0);
+  for (;;)
+  {
+    ssize_t count = read(fileno(input), &buffer[pending], (buffer.size() - pending));
+    if (count < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if (count <= 0)
+    {
+      break;
+    }
+    pending += count;
+
+    size_t offset = 0, consumed = 0;
+    zak::DetectionEvent event;
+    for (;;)
+    {
+      int result = zak::decodeDetectionRecord(&buffer[offset], (pending - offset), event, consumed);
+      if (result == 1)
+      {
+        break;
+      }
+      else if (result < 0)
+      {
+        std::cerr << "Corrupt record at byte offset " << offset << std::endl;
+        return 1;
+      }
+      else if (result == 0)
+      {
+        json ? printJson(event) : printCsv(event);
+      }
+      offset += consumed;
+    }
+    std::fflush(stdout);
+    std::memmove(&buffer[0], &buffer[offset], (pending - offset));
+    pending -= offset;
+  }
+
+  if (pending)
+  {
+    std::cerr << "Truncated record (" << pending << " bytes)" << std::endl;
+  }
+  return 0;
+}
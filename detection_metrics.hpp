@@ -0,0 +1,140 @@
+#ifndef ZAK_DETECTION_METRICS_HPP
+#define ZAK_DETECTION_METRICS_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "face_tracker.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Detections scored against ground truth, accumulated over frames
+   */
+  struct DetectionScore
+  {
+    uint64_t true_positives;
+    uint64_t false_positives;
+    uint64_t false_negatives;
+    double iou_sum; // over the true positives
+
+    DetectionScore(void) : true_positives(0), false_positives(0), false_negatives(0), iou_sum(0) {}
+
+    double precision(void) const
+    {
+      return ((true_positives + false_positives) ? (static_cast<double>(true_positives) / (true_positives + false_positives)) : 1.0);
+    }
+
+    double recall(void) const
+    {
+      return ((true_positives + false_negatives) ? (static_cast<double>(true_positives) / (true_positives + false_negatives)) : 1.0);
+    }
+
+    double meanIoU(void) const
+    {
+      return (true_positives ? (iou_sum / true_positives) : 0.0);
+    }
+
+    /**
+     * \brief Harmonic mean of precision and recall
+     */
+    double f1(void) const
+    {
+      double sum = (precision() + recall());
+      return ((sum > 0) ? ((2 * precision() * recall()) / sum) : 0.0);
+    }
+  };
+
+  /**
+   * \brief Score the detections of one frame
+   *
+   * Detection and ground truth pairs are matched greedily, most overlapping
+   * first; a pair overlapping less than `_min_iou` (intersection over union)
+   * is no match. Each box takes part in at most one match, so a duplicate
+   * detection of a face counts as a false positive.
+   */
+  inline void scoreDetections(const std::vector<cv::Rect> &_detections, const std::vector<cv::Rect> &_truth, double _min_iou, DetectionScore &_score)
+  {
+    std::vector<std::pair<double, std::pair<size_t, size_t> > > pairs;
+    for (size_t d = 0; d < _detections.size(); ++d)
+    {
+      for (size_t t = 0; t < _truth.size(); ++t)
+      {
+        double overlap = FaceTracker::intersectionOverUnion(_detections[d], _truth[t]);
+        if (overlap >= _min_iou)
+        {
+          pairs.push_back(std::make_pair(overlap, std::make_pair(d, t)));
+        }
+      }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const std::pair<double, std::pair<size_t, size_t> > &_a, const std::pair<double, std::pair<size_t, size_t> > &_b) { return (_a.first > _b.first); });
+
+    std::vector<bool> detection_matched(_detections.size(), false), truth_matched(_truth.size(), false);
+    uint64_t matches = 0;
+    for (auto &pair : pairs)
+    {
+      if (detection_matched[pair.second.first] || truth_matched[pair.second.second])
+      {
+        continue;
+      }
+      detection_matched[pair.second.first] = truth_matched[pair.second.second] = true;
+      _score.iou_sum += pair.first;
+      ++matches;
+    }
+    _score.true_positives += matches;
+    _score.false_positives += (_detections.size() - matches);
+    _score.false_negatives += (_truth.size() - matches);
+  }
+
+  /**
+   * \brief Accuracy and cost of one configuration
+   */
+  struct OperatingPoint
+  {
+    double cost; // e.g. median latency
+    double precision;
+    double recall;
+
+    /**
+     * \brief Whether this point is at least as good in every respect and
+     *        better in one
+     */
+    bool dominates(const OperatingPoint &_other) const
+    {
+      bool no_worse = (cost <= _other.cost && precision >= _other.precision && recall >= _other.recall);
+      bool better = (cost < _other.cost || precision > _other.precision || recall > _other.recall);
+      return (no_worse && better);
+    }
+  };
+
+  /**
+   * \brief Indices of the points no other point dominates, cheapest first
+   */
+  inline std::vector<size_t> paretoFrontier(const std::vector<OperatingPoint> &_points)
+  {
+    std::vector<size_t> frontier;
+    for (size_t i = 0; i < _points.size(); ++i)
+    {
+      bool dominated = false;
+      for (size_t j = 0; !dominated && j < _points.size(); ++j)
+      {
+        dominated = _points[j].dominates(_points[i]);
+      }
+      if (!dominated)
+      {
+        frontier.push_back(i);
+      }
+    }
+    std::sort(frontier.begin(), frontier.end(), [&](size_t _a, size_t _b) { return (_points[_a].cost < _points[_b].cost); });
+    return frontier;
+  }
+} // namespace zak
+
+#endif // ZAK_DETECTION_METRICS_HPP
@@ -0,0 +1,421 @@
+#ifndef ZAK_DETECTION_STREAM_HPP
+#define ZAK_DETECTION_STREAM_HPP
+
+// C/C++ Libraries
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Local Libraries
+#include "background_writer.hpp"
+#include "spsc_ring.hpp"
+
+/*
+ * Detection event stream
+ * ======================
+ *
+ * Every processed frame yields one `DetectionEvent`. The detection thread hands
+ * events to a background writer through a wait-free ring (a full ring drops the
+ * event and counts it, it never blocks), and the writer encodes them into the
+ * binary format below for a file, a Unix domain socket or stdout.
+ *
+ * All integers are little-endian.
+ *
+ *   stream header (8 bytes)
+ *     char[4]  magic "ZKDS"
+ *     uint8    stream version
+ *     uint8[3] reserved
+ *
+ *   record (18 + 14 * face_count bytes in version 1)
+ *     uint16   record bytes (including this field; lets readers skip records)
+ *     uint8    record version
+ *     uint8    face count
+ *     uint64   timestamp (nanoseconds since the Unix epoch)
+ *     uint32   frame sequence
+ *     int16    tilt angle (hundredths of a degree)
+ *     face[face count]
+ *       uint32 track id
+ *       int16  x, y (pixels of the video frame)
+ *       uint16 width, height
+ *       uint16 distance in millimeters (0 == unavailable)
+ */
+
+namespace zak
+{
+  static const char DETECTION_STREAM_MAGIC[4] = {'Z', 'K', 'D', 'S'};
+  static const uint8_t DETECTION_STREAM_VERSION = 1;
+  static const size_t DETECTION_STREAM_HEADER_BYTES = 8;
+  static const size_t DETECTION_RECORD_BYTES = 18;
+  static const size_t DETECTION_FACE_BYTES = 14;
+  static const uint8_t DETECTION_STREAM_MAX_FACES = 16;
+
+  struct DetectionFace
+  {
+    uint32_t track_id;
+    int16_t x;
+    int16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint16_t distance_mm;
+  };
+
+  struct DetectionEvent
+  {
+    uint64_t timestamp_ns;
+    uint32_t frame_sequence;
+    int16_t tilt_centidegrees;
+    uint8_t face_count;
+    DetectionFace faces[DETECTION_STREAM_MAX_FACES];
+  };
+
+  inline uint64_t detectionTimestamp(void)
+  {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return ((static_cast<uint64_t>(now.tv_sec) * 1000000000ull) + now.tv_nsec);
+  }
+
+  namespace wire
+  {
+    inline uint8_t *put16(uint8_t *_out, uint16_t _value)
+    {
+      _out[0] = static_cast<uint8_t>(_value);
+      _out[1] = static_cast<uint8_t>(_value >> 8);
+      return (_out + 2);
+    }
+
+    inline uint8_t *put32(uint8_t *_out, uint32_t _value)
+    {
+      return put16(put16(_out, static_cast<uint16_t>(_value)), static_cast<uint16_t>(_value >> 16));
+    }
+
+    inline uint8_t *put64(uint8_t *_out, uint64_t _value)
+    {
+      return put32(put32(_out, static_cast<uint32_t>(_value)), static_cast<uint32_t>(_value >> 32));
+    }
+
+    inline uint16_t get16(const uint8_t *_in)
+    {
+      return static_cast<uint16_t>(_in[0] | (_in[1] << 8));
+    }
+
+    inline uint32_t get32(const uint8_t *_in)
+    {
+      return (get16(_in) | (static_cast<uint32_t>(get16(_in + 2)) << 16));
+    }
+
+    inline uint64_t get64(const uint8_t *_in)
+    {
+      return (get32(_in) | (static_cast<uint64_t>(get32(_in + 4)) << 32));
+    }
+  } // namespace wire
+
+  /**
+   * \brief Serialize the stream header
+   *
+   * \return Number of bytes written (`DETECTION_STREAM_HEADER_BYTES`)
+   */
+  inline size_t encodeDetectionStreamHeader(uint8_t *_out)
+  {
+    std::memcpy(_out, DETECTION_STREAM_MAGIC, sizeof(DETECTION_STREAM_MAGIC));
+    _out[4] = DETECTION_STREAM_VERSION;
+    _out[5] = _out[6] = _out[7] = 0;
+    return DETECTION_STREAM_HEADER_BYTES;
+  }
+
+  /**
+   * \brief Validate the stream header
+   *
+   * \return Stream version, or -1 when the header is not recognized
+   */
+  inline int decodeDetectionStreamHeader(const uint8_t *_in, size_t _size)
+  {
+    if (_size < DETECTION_STREAM_HEADER_BYTES || std::memcmp(_in, DETECTION_STREAM_MAGIC, sizeof(DETECTION_STREAM_MAGIC)))
+    {
+      return -1;
+    }
+    return _in[4];
+  }
+
+  /**
+   * \brief Serialize one event
+   *
+   * \param[out] _out Destination (at least `DETECTION_RECORD_BYTES` +
+   *                  `DETECTION_FACE_BYTES` * `DETECTION_STREAM_MAX_FACES`)
+   * \return Number of bytes written
+   */
+  inline size_t encodeDetectionRecord(const DetectionEvent &_event, uint8_t *_out)
+  {
+    uint8_t face_count = ((_event.face_count > DETECTION_STREAM_MAX_FACES) ? DETECTION_STREAM_MAX_FACES : _event.face_count);
+    size_t bytes = (DETECTION_RECORD_BYTES + (face_count * DETECTION_FACE_BYTES));
+    uint8_t *cursor = wire::put16(_out, static_cast<uint16_t>(bytes));
+    *cursor++ = DETECTION_STREAM_VERSION;
+    *cursor++ = face_count;
+    cursor = wire::put64(cursor, _event.timestamp_ns);
+    cursor = wire::put32(cursor, _event.frame_sequence);
+    cursor = wire::put16(cursor, static_cast<uint16_t>(_event.tilt_centidegrees));
+    for (uint8_t i = 0; i < face_count; ++i)
+    {
+      const DetectionFace &face = _event.faces[i];
+      cursor = wire::put32(cursor, face.track_id);
+      cursor = wire::put16(cursor, static_cast<uint16_t>(face.x));
+      cursor = wire::put16(cursor, static_cast<uint16_t>(face.y));
+      cursor = wire::put16(cursor, face.width);
+      cursor = wire::put16(cursor, face.height);
+      cursor = wire::put16(cursor, face.distance_mm);
+    }
+    return bytes;
+  }
+
+  /**
+   * \brief Deserialize one event
+   *
+   * Records of an unknown (newer) version are skipped using the record size.
+   *
+   * \param[out] _consumed Bytes occupied by the record
+   * \return 0 on success, 1 if more input is needed, 2 if the record was
+   *         skipped, -1 on corrupt input
+   */
+  inline int decodeDetectionRecord(const uint8_t *_in, size_t _size, DetectionEvent &_event, size_t &_consumed)
+  {
+    if (_size < 2)
+    {
+      return 1;
+    }
+    size_t bytes = wire::get16(_in);
+    if (bytes < DETECTION_RECORD_BYTES)
+    {
+      return -1;
+    }
+    if (_size < bytes)
+    {
+      return 1;
+    }
+    _consumed = bytes;
+    if (_in[2] != DETECTION_STREAM_VERSION)
+    {
+      return 2;
+    }
+    uint8_t face_count = _in[3];
+    if (face_count > DETECTION_STREAM_MAX_FACES || bytes < (DETECTION_RECORD_BYTES + (face_count * DETECTION_FACE_BYTES)))
+    {
+      return -1;
+    }
+    _event.face_count = face_count;
+    _event.timestamp_ns = wire::get64(_in + 4);
+    _event.frame_sequence = wire::get32(_in + 12);
+    _event.tilt_centidegrees = static_cast<int16_t>(wire::get16(_in + 16));
+    const uint8_t *cursor = (_in + DETECTION_RECORD_BYTES);
+    for (uint8_t i = 0; i < face_count; ++i, cursor += DETECTION_FACE_BYTES)
+    {
+      DetectionFace &face = _event.faces[i];
+      face.track_id = wire::get32(cursor);
+      face.x = static_cast<int16_t>(wire::get16(cursor + 4));
+      face.y = static_cast<int16_t>(wire::get16(cursor + 6));
+      face.width = wire::get16(cursor + 8);
+      face.height = wire::get16(cursor + 10);
+      face.distance_mm = wire::get16(cursor + 12);
+    }
+    return 0;
+  }
+
+  /**
+   * \brief Background writer for the detection event stream
+   */
+  class DetectionStreamWriter
+  {
+  public:
+    DetectionStreamWriter(void) : _fd(-1), _is_socket(false), _failed(false), _dropped(0), _written(0) {}
+
+    ~DetectionStreamWriter(void)
+    {
+      close();
+    }
+
+    /**
+     * \brief Open the destination and start the writer thread
+     *
+     * \param[in] _target "-" for stdout, "unix:<path>" to connect to a Unix
+     *                    domain stream socket, otherwise a file path
+     * \return 0 on success, -1 on failure
+     */
+    int open(const std::string &_target)
+    {
+      close();
+      if (_target == "-")
+      {
+        _fd = STDOUT_FILENO;
+      }
+      else if (_target.compare(0, 5, "unix:") == 0)
+      {
+        struct sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, _target.c_str() + 5, (sizeof(address.sun_path) - 1));
+        if ((_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        {
+          perror("socket()");
+          return -1;
+        }
+        if (connect(_fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)))
+        {
+          perror("connect()");
+          ::close(_fd);
+          _fd = -1;
+          return -1;
+        }
+        _is_socket = true;
+      }
+      else if ((_fd = ::open(_target.c_str(), (O_WRONLY | O_CREAT | O_TRUNC), 0644)) < 0)
+      {
+        perror("open()");
+        return -1;
+      }
+
+      uint8_t header[DETECTION_STREAM_HEADER_BYTES];
+      if (writeAll(header, encodeDetectionStreamHeader(header)))
+      {
+        close();
+        return -1;
+      }
+
+      _failed = false;
+      _buffer.reserve(64 * 1024);
+      _writer.start([this]() { return drain(); });
+      return 0;
+    }
+
+    /**
+     * \brief Flush queued events, stop the writer and close the destination
+     */
+    void close(void)
+    {
+      _writer.stop();
+      if (_fd > STDOUT_FILENO && _fd != STDERR_FILENO)
+      {
+        ::close(_fd);
+      }
+      _fd = -1;
+      _is_socket = false;
+    }
+
+    /**
+     * \brief The writer thread (valid while open; for placement)
+     */
+    pthread_t writerThread(void)
+    {
+      return _writer.thread();
+    }
+
+    bool isOpen(void) const
+    {
+      return (_fd >= 0);
+    }
+
+    /**
+     * \brief Queue an event (detection thread; wait-free)
+     *
+     * \return false if the queue was full and the event was dropped
+     */
+    bool emit(const DetectionEvent &_event)
+    {
+      if (!_queue.tryPush(_event))
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      _writer.notify();
+      return true;
+    }
+
+    uint64_t dropped(void) const
+    {
+      return _dropped.load(std::memory_order_relaxed);
+    }
+
+    uint64_t written(void) const
+    {
+      return _written.load(std::memory_order_relaxed);
+    }
+
+  private:
+    int _fd;
+    bool _is_socket;
+    bool _failed; // writer thread: the destination failed, events are dropped
+    std::vector<uint8_t> _buffer;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<uint64_t> _written;
+    SpscRing<DetectionEvent, 256> _queue;
+    BackgroundWriter _writer; // last: stopped before the members it drains are destroyed
+
+    int writeAll(const uint8_t *_data, size_t _size)
+    {
+      while (_size)
+      {
+        ssize_t result = (_is_socket ? send(_fd, _data, _size, MSG_NOSIGNAL) : write(_fd, _data, _size));
+        if (result < 0)
+        {
+          if (errno == EINTR)
+          {
+            continue;
+          }
+          perror("detection stream write()");
+          return -1;
+        }
+        _data += result;
+        _size -= result;
+      }
+      return 0;
+    }
+
+    /**
+     * \brief Write everything queued so far in one write (writer thread)
+     *
+     * \return Whether anything was queued
+     */
+    bool drain(void)
+    {
+      DetectionEvent event;
+      uint64_t batch = 0;
+      while (_queue.tryPop(event))
+      {
+        size_t offset = _buffer.size();
+        _buffer.resize(offset + DETECTION_RECORD_BYTES + (DETECTION_STREAM_MAX_FACES * DETECTION_FACE_BYTES));
+        _buffer.resize(offset + encodeDetectionRecord(event, &_buffer[offset]));
+        ++batch;
+      }
+      if (!batch)
+      {
+        return false;
+      }
+      if (!_failed && writeAll(&_buffer[0], _buffer.size()))
+      {
+        // Keep draining the queue so the producer never stalls
+        _failed = true;
+      }
+      if (!_failed)
+      {
+        _written.fetch_add(batch, std::memory_order_relaxed);
+      }
+      else
+      {
+        _dropped.fetch_add(batch, std::memory_order_relaxed);
+      }
+      _buffer.clear();
+      return true;
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_DETECTION_STREAM_HPP
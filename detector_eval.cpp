@@ -0,0 +1,314 @@
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "cascade_loader.hpp"
+#include "detection_metrics.hpp"
+#include "face_detector.hpp"
+#include "frame_cache.hpp"
+#include "options.hpp"
+
+/*
+ * Detector configuration evaluation
+ *
+ * Runs the `head_hunter` detection path (frame cache, downscale, cascade)
+ * over annotated images for every combination of the configured image
+ * scales, scale factors, neighbor thresholds and minimum face sizes, and
+ * reports each configuration's precision, recall and mean IoU against the
+ * ground truth with its per-frame latency (median and 99th percentile). The
+ * configurations that no other configuration beats on latency, precision and
+ * recall at once (the Pareto frontier) are listed cheapest first, followed by
+ * the cheapest one that meets `--min-precision` and `--min-recall`.
+ *
+ * Annotations are a text file with one line per image: the image path
+ * (relative to the annotation file) followed by `x y width height` for each
+ * face, in pixels; blank lines and lines starting with `#` are skipped.
+ *
+ *     # frames at 640x480
+ *     frames/0001.png 212 140 96 96
+ *     frames/0002.png
+ *     frames/0003.png 40 60 80 80 400 90 72 72
+ *
+ * `--jobs=N` evaluates N configurations at once (one cascade each); the
+ * latencies then share the CPUs, so time a hardware tier with `--jobs=1`
+ * and `--threads` set to its core count.
+ *
+ * Usage: detector_eval <annotations> [--image-scales=1,1.5,2]
+ *            [--scale-factors=1.05,1.1,1.2] [--min-neighbors=2,3,4]
+ *            [--min-faces=24,38,60] [--iou=0.5] [--repeat=1] [--jobs=1]
+ *            [--threads=N] [--min-precision=0.9] [--min-recall=0.8]
+ *            [--cascade=<xml>] [--cascade-cache=<yml>]
+ *
+ * CSV rows (one per configuration) go to stdout, the frontier to stderr.
+ */
+
+namespace
+{
+  struct AnnotatedImage
+  {
+    cv::Mat bgr_image;
+    std::vector<cv::Rect> faces;
+  };
+
+  struct Evaluation
+  {
+    zak::DetectorSettings settings;
+    zak::DetectionScore score;
+    double p50_ms;
+    double p99_ms;
+  };
+
+  /**
+   * \brief Parse a comma separated list of numbers (empty on a malformed list)
+   */
+  std::vector<double> parseList(const std::string &_list)
+  {
+    std::vector<double> values;
+    std::istringstream in(_list);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+      char *end = nullptr;
+      double value = std::strtod(item.c_str(), &end);
+      if (item.empty() || *end)
+      {
+        return std::vector<double>();
+      }
+      values.push_back(value);
+    }
+    return values;
+  }
+
+  /**
+   * \brief Load the annotated images
+   *
+   * \return 0 on success, -1 on a malformed file or unreadable image
+   */
+  int loadAnnotations(const std::string &_path, std::vector<AnnotatedImage> &_images)
+  {
+    std::ifstream in(_path.c_str());
+    if (!in)
+    {
+      std::cerr << "Unable to read " << _path << std::endl;
+      return -1;
+    }
+    std::string directory = ((_path.find('/') == std::string::npos) ? "" : _path.substr(0, (_path.rfind('/') + 1)));
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number)
+    {
+      std::istringstream fields(line);
+      std::string image_path;
+      if (!(fields >> image_path) || image_path[0] == '#')
+      {
+        continue;
+      }
+      AnnotatedImage image;
+      image.bgr_image = cv::imread(((image_path[0] == '/') ? "" : directory) + image_path);
+      if (image.bgr_image.empty())
+      {
+        std::cerr << _path << ":" << line_number << ": unable to read " << image_path << std::endl;
+        return -1;
+      }
+      std::vector<int> values;
+      int value;
+      while (fields >> value)
+      {
+        values.push_back(value);
+      }
+      if (!fields.eof() || (values.size() % 4))
+      {
+        std::cerr << _path << ":" << line_number << ": expected x y width height" << std::endl;
+        return -1;
+      }
+      for (size_t i = 0; i < values.size(); i += 4)
+      {
+        image.faces.push_back(cv::Rect(values[i], values[i + 1], values[i + 2], values[i + 3]));
+      }
+      _images.push_back(image);
+    }
+    return 0;
+  }
+
+  double percentile(std::vector<double> &_samples, double _fraction)
+  {
+    if (_samples.empty())
+    {
+      return 0;
+    }
+    size_t rank = std::min((_samples.size() - 1), static_cast<size_t>(_fraction * _samples.size()));
+    std::nth_element(_samples.begin(), (_samples.begin() + rank), _samples.end());
+    return _samples[rank];
+  }
+
+  void printSettings(std::ostream &_out, const zak::DetectorSettings &_settings)
+  {
+    _out << "image scale " << _settings.image_scale << ", scale factor " << _settings.scale_factor << ", min neighbors " << _settings.min_neighbors << ", min face " << _settings.min_face;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  zak::Options options(argc, argv);
+  if (options.positional().empty())
+  {
+    std::cerr << "Usage: " << argv[0] << " <annotations> [--image-scales=1,1.5,2] [--scale-factors=1.05,1.1,1.2] [--min-neighbors=2,3,4] [--min-faces=24,38,60] [--jobs=1]" << std::endl;
+    return 1;
+  }
+
+  std::vector<AnnotatedImage> images;
+  if (loadAnnotations(options.positional()[0], images))
+  {
+    return 1;
+  }
+  if (images.empty())
+  {
+    std::cerr << "No annotated images" << std::endl;
+    return 1;
+  }
+
+  // Configuration grid
+  std::vector<double> image_scales = parseList(options.get("image-scales", "1,1.5,2"));
+  std::vector<double> scale_factors = parseList(options.get("scale-factors", "1.05,1.1,1.2"));
+  std::vector<double> min_neighbors = parseList(options.get("min-neighbors", "2,3,4"));
+  std::vector<double> min_faces = parseList(options.get("min-faces", "24,38,60"));
+  if (image_scales.empty() || scale_factors.empty() || min_neighbors.empty() || min_faces.empty())
+  {
+    std::cerr << "Invalid configuration list (expected e.g. 1,1.5,2)" << std::endl;
+    return 1;
+  }
+  std::vector<Evaluation> evaluations;
+  for (double image_scale : image_scales)
+  {
+    for (double scale_factor : scale_factors)
+    {
+      for (double neighbors : min_neighbors)
+      {
+        for (double min_face : min_faces)
+        {
+          Evaluation evaluation;
+          evaluation.settings = zak::defaultDetectorSettings();
+          evaluation.settings.image_scale = static_cast<float>(image_scale);
+          evaluation.settings.scale_factor = scale_factor;
+          evaluation.settings.min_neighbors = static_cast<int>(neighbors);
+          evaluation.settings.min_face = static_cast<int>(min_face);
+          evaluations.push_back(evaluation);
+        }
+      }
+    }
+  }
+
+  // Load one cascade per job (a cascade is not safe to share between threads)
+  int jobs = std::max(1, std::min(options.getInt("jobs", 1), static_cast<int>(evaluations.size())));
+  if (options.has("threads"))
+  {
+    cv::setNumThreads(options.getInt("threads", 1));
+  }
+  std::string cascade_path = options.get("cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_frontalface_alt2.xml");
+  std::vector<cv::CascadeClassifier> cascades(jobs);
+  bool from_cache;
+  for (auto &cascade : cascades)
+  {
+    if (zak::loadCascade(cascade, cascade_path, options.get("cascade-cache", ""), from_cache))
+    {
+      return 1;
+    }
+  }
+
+  // Evaluate (each job takes the next configuration)
+  double min_iou = options.getDouble("iou", 0.5);
+  int repeat = std::max(1, options.getInt("repeat", 1));
+  std::atomic<size_t> next_evaluation(0);
+  auto evaluate = [&](int _job) {
+    zak::FaceDetector detector(cascades[_job]);
+    zak::FrameCache frame_cache;
+    std::vector<cv::Rect> faces;
+    std::vector<double> latencies_ms;
+    for (size_t i = next_evaluation++; i < evaluations.size(); i = next_evaluation++)
+    {
+      Evaluation &evaluation = evaluations[i];
+      latencies_ms.clear();
+      for (int pass = 0; pass < repeat; ++pass)
+      {
+        for (auto &image : images)
+        {
+          int64 start = cv::getTickCount();
+          frame_cache.reset(image.bgr_image);
+          detector.detect(frame_cache, evaluation.settings, faces);
+          latencies_ms.push_back(((cv::getTickCount() - start) * 1000.0) / cv::getTickFrequency());
+          if (!pass)
+          {
+            zak::scoreDetections(faces, image.faces, min_iou, evaluation.score);
+          }
+        }
+      }
+      evaluation.p50_ms = percentile(latencies_ms, 0.5);
+      evaluation.p99_ms = percentile(latencies_ms, 0.99);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int job = 1; job < jobs; ++job)
+  {
+    workers.push_back(std::thread(evaluate, job));
+  }
+  evaluate(0);
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+
+  // Report every configuration
+  std::vector<zak::OperatingPoint> points;
+  std::cout << "image_scale,scale_factor,min_neighbors,min_face,precision,recall,f1,mean_iou,true_positives,false_positives,false_negatives,p50_ms,p99_ms" << std::endl;
+  for (auto &evaluation : evaluations)
+  {
+    const zak::DetectionScore &score = evaluation.score;
+    std::cout << evaluation.settings.image_scale << "," << evaluation.settings.scale_factor << "," << evaluation.settings.min_neighbors << "," << evaluation.settings.min_face
+              << "," << score.precision() << "," << score.recall() << "," << score.f1() << "," << score.meanIoU()
+              << "," << score.true_positives << "," << score.false_positives << "," << score.false_negatives
+              << "," << evaluation.p50_ms << "," << evaluation.p99_ms << std::endl;
+    zak::OperatingPoint point;
+    point.cost = evaluation.p50_ms;
+    point.precision = score.precision();
+    point.recall = score.recall();
+    points.push_back(point);
+  }
+
+  // Pareto frontier, and the cheapest configuration meeting the accuracy bar
+  double min_precision = options.getDouble("min-precision", 0), min_recall = options.getDouble("min-recall", 0);
+  int cheapest = -1;
+  std::cerr << images.size() << " images, " << evaluations.size() << " configurations; Pareto frontier (cheapest first):" << std::endl;
+  std::cerr << std::fixed << std::setprecision(3);
+  for (size_t i : zak::paretoFrontier(points))
+  {
+    const Evaluation &evaluation = evaluations[i];
+    std::cerr << "  " << evaluation.p50_ms << " ms (p99 " << evaluation.p99_ms << "), precision " << evaluation.score.precision() << ", recall " << evaluation.score.recall() << ", mean IoU " << evaluation.score.meanIoU() << ": ";
+    printSettings(std::cerr, evaluation.settings);
+    std::cerr << std::endl;
+    if (cheapest < 0 && evaluation.score.precision() >= min_precision && evaluation.score.recall() >= min_recall)
+    {
+      cheapest = static_cast<int>(i);
+    }
+  }
+  if (cheapest < 0)
+  {
+    std::cerr << "No configuration reaches precision " << min_precision << " and recall " << min_recall << std::endl;
+    return 2;
+  }
+  std::cerr << "Cheapest with precision >= " << min_precision << " and recall >= " << min_recall << ": ";
+  printSettings(std::cerr, evaluations[cheapest].settings);
+  std::cerr << " (" << evaluations[cheapest].p50_ms << " ms)" << std::endl;
+  return 0;
+}
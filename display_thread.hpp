@@ -0,0 +1,240 @@
+#ifndef ZAK_DISPLAY_THREAD_HPP
+#define ZAK_DISPLAY_THREAD_HPP
+
+// C/C++ Libraries
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "frame_kernels.hpp"
+#include "frame_signal.hpp"
+#include "spsc_ring.hpp"
+#include "triple_buffer.hpp"
+#include "trace.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Shows frames in a HighGUI window from a thread of its own
+   *
+   * `cv::imshow` and `cv::waitKey` can take tens of milliseconds (e.g. over
+   * X11 forwarding); on the detection thread they throttled detection. Here
+   * the window is created, drawn and polled for keys on the display thread
+   * only (HighGUI wants every call for a window on one thread), and the
+   * detection thread just submits frames.
+   *
+   * Submission is a `TripleBuffer`, as in `FrameExchange`'s mailbox: the
+   * frame and its overlay are copied into the back slot and published; the
+   * display thread takes the newest slot when one is fresh, so it always
+   * shows the newest frame and never waits on the detection thread (nor the
+   * reverse). With
+   * `max_fps` set, frames submitted sooner than the display rate are skipped
+   * before they are copied. The overlay is composited onto the display
+   * thread's own copy (after scaling it to `preview_scale`), never onto the
+   * submitted frame.
+   *
+   * Keys pressed in the window are queued for `key`, and `_wake` (if given)
+   * is notified, so a loop sleeping on it reacts at once.
+   */
+  class DisplayThread
+  {
+  public:
+    DisplayThread(void) : _wake(nullptr), _running(false), _back(0), _next_due(0), _front(2), _shown(0), _skipped(0), max_fps(0), preview_scale(1.0) {}
+
+    ~DisplayThread(void)
+    {
+      close();
+    }
+
+    /**
+     * \brief Start the display thread, which creates the window
+     *
+     * \param[in] _window_name Window title
+     * \param[in] _new_wake Notified when a key is pressed (nullptr: none)
+     * \return 0 on success
+     */
+    int open(const std::string &_window_name, FrameSignal *_new_wake)
+    {
+      close();
+      _name = _window_name;
+      _wake = _new_wake;
+      _next_due = 0;
+      _running.store(true, std::memory_order_release);
+      _thread = std::thread(&DisplayThread::displayLoop, this);
+      return 0;
+    }
+
+    /**
+     * \brief Stop the display thread, which destroys the window
+     */
+    void close(void)
+    {
+      _running.store(false, std::memory_order_release);
+      _signal.notify();
+      if (_thread.joinable())
+      {
+        _thread.join();
+      }
+    }
+
+    /**
+     * \brief The display thread (valid while open; for placement)
+     */
+    pthread_t displayThread(void)
+    {
+      return _thread.native_handle();
+    }
+
+    bool isOpen(void) const
+    {
+      return _thread.joinable();
+    }
+
+    /**
+     * \brief Show a frame with its overlay (detection thread; never blocks)
+     *
+     * \param[in] _sequence Frame sequence number (for traces)
+     * \return false if the frame was skipped (sooner than `max_fps` allows)
+     */
+    bool submit(const cv::Mat &_image, const FrameOverlay &_overlay, uint64_t _sequence = 0)
+    {
+      int64 now = cv::getTickCount();
+      if (max_fps > 0)
+      {
+        if (now < _next_due)
+        {
+          _skipped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        int64 period = static_cast<int64>(cv::getTickFrequency() / max_fps);
+        _next_due = (((now - _next_due) < period) ? (_next_due + period) : (now + period));
+      }
+      TraceSpan span("submit display", _sequence);
+      Slot &slot = _slots[_back];
+      _image.copyTo(slot.image);
+      slot.overlay = _overlay;
+      slot.sequence = _sequence;
+      bool overwritten;
+      _back = _mailbox.publish(_back, overwritten);
+      if (overwritten)
+      {
+        _skipped.fetch_add(1, std::memory_order_relaxed); // never shown
+      }
+      _signal.notify();
+      return true;
+    }
+
+    /**
+     * \brief Next key pressed in the window (-1: none)
+     */
+    int key(void)
+    {
+      int value;
+      return (_keys.tryPop(value) ? value : -1);
+    }
+
+    /**
+     * \brief Frames shown and skipped since the last reset
+     */
+    void report(std::ostream &_out) const
+    {
+      _out << "display shown " << _shown.load(std::memory_order_relaxed) << ", skipped " << _skipped.load(std::memory_order_relaxed);
+    }
+
+    void resetCounters(void)
+    {
+      _shown.store(0, std::memory_order_relaxed);
+      _skipped.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    static const int POLL_MS = 10; // window event latency without frames
+
+    struct Slot
+    {
+      cv::Mat image;
+      FrameOverlay overlay;
+      uint64_t sequence;
+    };
+
+    std::string _name;
+    FrameSignal *_wake;
+    FrameSignal _signal; // frame submitted (or closing)
+    std::atomic<bool> _running;
+    std::thread _thread;
+    Slot _slots[3];
+    SpscRing<int, 16> _keys; // display thread -> detection thread
+
+    // Producer state
+    alignas(CACHE_LINE_BYTES) uint32_t _back;
+    int64 _next_due;
+
+    // Shared state
+    alignas(CACHE_LINE_BYTES) TripleBuffer _mailbox;
+
+    // Consumer state
+    alignas(CACHE_LINE_BYTES) uint32_t _front;
+    cv::Mat _preview;
+    std::atomic<uint64_t> _shown;
+    std::atomic<uint64_t> _skipped;
+
+    void displayLoop(void)
+    {
+      tracer().nameThread("display");
+      cv::namedWindow(_name, cv::WINDOW_AUTOSIZE);
+      while (_running.load(std::memory_order_acquire))
+      {
+        _signal.wait(POLL_MS);
+        _signal.clear();
+        if (_mailbox.fresh())
+        {
+          _front = _mailbox.acquire(_front);
+          show(_slots[_front]);
+        }
+        int value;
+        {
+          TraceSpan span("window events");
+          value = cv::waitKey(1);
+        }
+        if (value >= 0 && _keys.tryPush(value) && _wake)
+        {
+          _wake->notify();
+        }
+      }
+      cv::destroyWindow(_name);
+    }
+
+    /**
+     * \brief Composite the overlay onto the display's copy and show it
+     */
+    void show(Slot &_slot)
+    {
+      TraceSpan span("display", _slot.sequence);
+      if (preview_scale > 0 && preview_scale != 1.0)
+      {
+        cv::resize(_slot.image, _preview, cv::Size(), preview_scale, preview_scale, cv::INTER_AREA);
+        drawOverlay(_preview, _slot.overlay, preview_scale);
+        cv::imshow(_name, _preview);
+      }
+      else
+      {
+        drawOverlay(_slot.image, _slot.overlay);
+        cv::imshow(_name, _slot.image);
+      }
+      _shown.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  public:
+    double max_fps;       // frames shown per second at most (0: every frame)
+    double preview_scale; // window size relative to the frame (set before `open`)
+  };
+} // namespace zak
+
+#endif // ZAK_DISPLAY_THREAD_HPP
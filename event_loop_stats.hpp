@@ -0,0 +1,174 @@
+#ifndef ZAK_EVENT_LOOP_STATS_HPP
+#define ZAK_EVENT_LOOP_STATS_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+namespace zak
+{
+  /**
+   * \brief Tuning of the thread that processes Kinect events
+   */
+  struct EventLoopConfig
+  {
+    int timeout_ms;             // longest wait for USB events per iteration
+    int tilt_poll_ms;           // tilt/accelerometer refresh period (0 disables)
+    int max_consecutive_errors; // the loop gives up after this many failed iterations in a row
+
+    EventLoopConfig(void) : timeout_ms(10), tilt_poll_ms(500), max_consecutive_errors(50) {}
+  };
+
+  /**
+   * \brief Event loop counters (since the previous reset) and its latest tilt reading
+   */
+  struct EventLoopStats
+  {
+    uint64_t iterations;
+    uint64_t usb_errors;
+    int last_error;         // libusb error code of the last failed iteration (0: none)
+    double mean_iteration_ms;
+    double max_iteration_ms;
+    double tilt_degrees;
+    int tilt_status;        // freenect_tilt_status_code
+    bool failed;            // the loop stopped on persistent errors
+
+    EventLoopStats(void) : iterations(0), usb_errors(0), last_error(0), mean_iteration_ms(0), max_iteration_ms(0), tilt_degrees(0), tilt_status(0), failed(false) {}
+  };
+
+  /**
+   * \brief Collects `EventLoopStats` on the event thread for other threads
+   */
+  class EventLoopMeter
+  {
+  public:
+    EventLoopMeter(void) : _total_ms(0) {}
+
+    /**
+     * \brief Record one loop iteration (event thread)
+     *
+     * \param[in] _result Return value of the event processing call (< 0: error)
+     */
+    void iteration(double _ms, int _result)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_stats.iterations;
+      _total_ms += _ms;
+      _stats.max_iteration_ms = std::max(_stats.max_iteration_ms, _ms);
+      if (_result < 0)
+      {
+        ++_stats.usb_errors;
+        _stats.last_error = _result;
+      }
+    }
+
+    void tilt(double _degrees, int _status)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stats.tilt_degrees = _degrees;
+      _stats.tilt_status = _status;
+    }
+
+    void fail(void)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stats.failed = true;
+    }
+
+    /**
+     * \brief Copy the counters (any thread)
+     *
+     * \param[in] _reset Start a new measurement window (counters and timing;
+     *                   the tilt reading and failure flag persist)
+     */
+    EventLoopStats snapshot(bool _reset)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      EventLoopStats stats = _stats;
+      stats.mean_iteration_ms = (_stats.iterations ? (_total_ms / _stats.iterations) : 0);
+      if (_reset)
+      {
+        _stats.iterations = _stats.usb_errors = 0;
+        _stats.max_iteration_ms = 0;
+        _total_ms = 0;
+      }
+      return stats;
+    }
+
+  private:
+    std::mutex _mutex;
+    EventLoopStats _stats;
+    double _total_ms;
+  };
+
+  /**
+   * \brief Arrival jitter of a periodic event (e.g. frame callbacks)
+   *
+   * `tick` runs on the arriving thread and only holds an uncontended lock for
+   * a few additions; `snapshot` reads and optionally resets from any thread.
+   */
+  class IntervalMeter
+  {
+  public:
+    IntervalMeter(void) : _count(0), _sum_ms(0), _sum_squares_ms(0), _max_ms(0), _has_previous(false) {}
+
+    void tick(void)
+    {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_has_previous)
+      {
+        double interval_ms = std::chrono::duration<double, std::milli>(now - _previous).count();
+        ++_count;
+        _sum_ms += interval_ms;
+        _sum_squares_ms += (interval_ms * interval_ms);
+        _max_ms = std::max(_max_ms, interval_ms);
+      }
+      _previous = now;
+      _has_previous = true;
+    }
+
+    /**
+     * \brief Mean, standard deviation and maximum of the intervals (ms)
+     *
+     * \return Number of intervals measured
+     */
+    uint64_t snapshot(double &_mean_ms, double &_stddev_ms, double &_max_interval_ms, bool _reset)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      uint64_t count = _count;
+      _mean_ms = (count ? (_sum_ms / count) : 0);
+      _stddev_ms = (count ? std::sqrt(std::max(0.0, ((_sum_squares_ms / count) - (_mean_ms * _mean_ms)))) : 0);
+      _max_interval_ms = _max_ms;
+      if (_reset)
+      {
+        _count = 0;
+        _sum_ms = _sum_squares_ms = _max_ms = 0;
+      }
+      return count;
+    }
+
+    /**
+     * \brief Forget the previous arrival (e.g. when the stream restarts)
+     */
+    void restart(void)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _has_previous = false;
+    }
+
+  private:
+    std::mutex _mutex;
+    uint64_t _count;
+    double _sum_ms;
+    double _sum_squares_ms;
+    double _max_ms;
+    bool _has_previous;
+    std::chrono::steady_clock::time_point _previous;
+  };
+} // namespace zak
+
+#endif // ZAK_EVENT_LOOP_STATS_HPP
@@ -0,0 +1,136 @@
+#ifndef ZAK_FACE_DETECTOR_HPP
+#define ZAK_FACE_DETECTOR_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "frame_cache.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Tunable parameters of the detection path
+   */
+  struct DetectorSettings
+  {
+    float image_scale;   // video frame is downscaled by this factor before detection
+    double scale_factor; // `detectMultiScale` pyramid step
+    int min_neighbors;   // `detectMultiScale` grouping threshold
+    int min_face;        // smallest face to report (pixels of the video frame)
+    int detect_interval; // run the detector on every Nth frame
+
+    /**
+     * \brief Smallest window handed to `detectMultiScale` (cascade pixels)
+     */
+    cv::Size cascadeMinSize(void) const
+    {
+      int side = std::max(20, cvRound(min_face / image_scale));
+      return cv::Size(side, side);
+    }
+  };
+
+  /**
+   * \brief The historical constants of `head_hunter`
+   */
+  inline DetectorSettings defaultDetectorSettings(void)
+  {
+    DetectorSettings settings;
+    settings.image_scale = 1.5f;
+    settings.scale_factor = 1.1;
+    settings.min_neighbors = 3;
+    settings.min_face = 38; // 25x25 at an image scale of 1.5
+    settings.detect_interval = 1;
+    return settings;
+  }
+
+  /**
+   * \brief Map a detection from a downscaled image back to the video frame
+   */
+  inline cv::Rect upscaleRect(const cv::Rect &_rect, float _image_scale)
+  {
+    return cv::Rect(
+        cv::Point(cvRound(_rect.x * _image_scale), cvRound(_rect.y * _image_scale)),
+        cv::Point(cvRound((_rect.x + _rect.width) * _image_scale), cvRound((_rect.y + _rect.height) * _image_scale)));
+  }
+
+  /**
+   * \brief Downscale, convert and scan a BGR frame for faces
+   */
+  class FaceDetector
+  {
+  public:
+    FaceDetector(cv::CascadeClassifier &_cascade) : _cascade(_cascade) {}
+
+    /**
+     * \brief Detect faces in a BGR video frame
+     *
+     * \param[in] _bgr_image Video frame
+     * \param[in] _settings Detection parameters
+     * \param[out] _faces Detections, in pixels of the video frame
+     */
+    void detect(const cv::Mat &_bgr_image, const DetectorSettings &_settings, std::vector<cv::Rect> &_faces)
+    {
+      detectGrayscale(preprocess(_bgr_image, _settings), _settings, _faces);
+    }
+
+    /**
+     * \brief Detect faces in a cached frame (shares preprocessing with other passes)
+     */
+    void detect(FrameCache &_frame, const DetectorSettings &_settings, std::vector<cv::Rect> &_faces)
+    {
+      if (_frame.accelerated())
+      {
+        detectGrayscale(_frame.levelUMat(_settings.image_scale), _settings, _faces);
+      }
+      else
+      {
+        detectGrayscale(_frame.level(_settings.image_scale), _settings, _faces);
+      }
+    }
+
+    /**
+     * \brief Downscale and convert a BGR video frame for the cascade
+     *
+     * \return The cascade input (valid until the next call)
+     */
+    const cv::Mat &preprocess(const cv::Mat &_bgr_image, const DetectorSettings &_settings)
+    {
+      cv::resize(_bgr_image, _cascade_bgr, cv::Size((_bgr_image.size().width / _settings.image_scale), (_bgr_image.size().height / _settings.image_scale)));
+      cv::cvtColor(_cascade_bgr, _cascade_grayscale, cv::COLOR_BGR2GRAY);
+      return _cascade_grayscale;
+    }
+
+    /**
+     * \brief Detect faces in an already downscaled grayscale image
+     *
+     * \param[in] _cascade_grayscale Image downscaled by `_settings.image_scale`
+     *                               (`cv::Mat` or `cv::UMat`)
+     * \param[out] _faces Detections, in pixels of the video frame
+     */
+    void detectGrayscale(cv::InputArray _cascade_grayscale, const DetectorSettings &_settings, std::vector<cv::Rect> &_faces)
+    {
+      _cascade.detectMultiScale(_cascade_grayscale, _faces, _settings.scale_factor, _settings.min_neighbors, 0, _settings.cascadeMinSize());
+      for (auto &face : _faces)
+      {
+        face = upscaleRect(face, _settings.image_scale);
+      }
+    }
+
+    const cv::Mat &grayscale(void) const
+    {
+      return _cascade_grayscale;
+    }
+
+  private:
+    cv::CascadeClassifier &_cascade;
+    cv::Mat _cascade_bgr;
+    cv::Mat _cascade_grayscale;
+  };
+} // namespace zak
+
+#endif // ZAK_FACE_DETECTOR_HPP
@@ -0,0 +1,148 @@
+#ifndef ZAK_FACE_EMBEDDER_HPP
+#define ZAK_FACE_EMBEDDER_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+namespace zak
+{
+  /**
+   * \brief Computes face embeddings with an OpenCV DNN model on the CPU
+   *
+   * Every face of a frame is cropped (with a small margin, since cascade
+   * rectangles are tight), resized to the model's input and stacked into one
+   * blob, so a frame costs one forward pass whatever its face count. The
+   * embeddings are L2-normalized, one row per face, ready for cosine
+   * similarity in an `IdentityIndex`.
+   *
+   * The defaults match SFace (`face_recognition_sface_2021dec.onnx` from the
+   * OpenCV model zoo: 112x112 RGB input, 128 dimensions); other models only
+   * need `input_size`, `scale`, `mean` and `swap_rb` adjusted.
+   */
+  class FaceEmbedder
+  {
+  public:
+    FaceEmbedder(void) : input_size(112, 112), scale(1.0), mean(0, 0, 0), swap_rb(true), margin(0.1) {}
+
+    /**
+     * \brief Load the model (ONNX, Torch, Caffe, ... as `cv::dnn::readNet` detects)
+     *
+     * \return 0 on success, -1 on failure
+     */
+    int load(const std::string &_model_path)
+    {
+      try
+      {
+        _net = cv::dnn::readNet(_model_path);
+      }
+      catch (const cv::Exception &e)
+      {
+        std::cerr << "Cannot load embedding model " << _model_path << ": " << e.what() << std::endl;
+        return -1;
+      }
+      if (_net.empty())
+      {
+        std::cerr << "Cannot load embedding model " << _model_path << std::endl;
+        return -1;
+      }
+      _net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+      _net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+      return 0;
+    }
+
+    bool loaded(void) const { return !_net.empty(); }
+
+    /**
+     * \brief Length of the model's embeddings (one forward pass on a blank
+     *        face)
+     *
+     * \return Dimensions, or -1 on failure
+     */
+    int dimensions(void)
+    {
+      cv::Mat blank(input_size, CV_8UC3, cv::Scalar::all(128)), embeddings;
+      if (embed(blank, std::vector<cv::Rect>(1, cv::Rect(cv::Point(0, 0), input_size)), embeddings))
+      {
+        return -1;
+      }
+      return embeddings.cols;
+    }
+
+    /**
+     * \brief Embed every face of a frame in one batch
+     *
+     * \param[in] _bgr_image Video frame (BGR)
+     * \param[in] _faces Face rectangles in `_bgr_image`
+     * \param[out] _embeddings One normalized row (`CV_32F`) per face
+     * \return 0 on success, -1 on failure
+     */
+    int embed(const cv::Mat &_bgr_image, const std::vector<cv::Rect> &_faces, cv::Mat &_embeddings)
+    {
+      _embeddings.release();
+      if (_faces.empty())
+      {
+        return 0;
+      }
+      if (_net.empty())
+      {
+        return -1;
+      }
+
+      _crops.resize(_faces.size());
+      cv::Rect frame(0, 0, _bgr_image.cols, _bgr_image.rows);
+      for (size_t i = 0; i < _faces.size(); ++i)
+      {
+        const cv::Rect &face = _faces[i];
+        int pad_x = static_cast<int>(face.width * margin), pad_y = static_cast<int>(face.height * margin);
+        cv::Rect crop = (cv::Rect((face.x - pad_x), (face.y - pad_y), (face.width + (2 * pad_x)), (face.height + (2 * pad_y))) & frame);
+        if (crop.empty())
+        {
+          return -1;
+        }
+        cv::resize(_bgr_image(crop), _crops[i], input_size, 0, 0, cv::INTER_AREA);
+      }
+
+      try
+      {
+        _blob = cv::dnn::blobFromImages(_crops, scale, input_size, mean, swap_rb, false);
+        _net.setInput(_blob);
+        _output = _net.forward();
+      }
+      catch (const cv::Exception &e)
+      {
+        std::cerr << "Embedding failed: " << e.what() << std::endl;
+        return -1;
+      }
+
+      // One row per face, normalized for cosine similarity
+      _embeddings = _output.reshape(1, static_cast<int>(_faces.size()));
+      for (int row = 0; row < _embeddings.rows; ++row)
+      {
+        cv::Mat embedding = _embeddings.row(row);
+        cv::normalize(embedding, embedding);
+      }
+      return 0;
+    }
+
+  private:
+    cv::dnn::Net _net;
+    std::vector<cv::Mat> _crops;
+    cv::Mat _blob;
+    cv::Mat _output;
+
+  public:
+    cv::Size input_size; // model input (pixels)
+    double scale;        // pixel scale factor of the blob
+    cv::Scalar mean;     // subtracted from each pixel (after `swap_rb`)
+    bool swap_rb;        // feed RGB rather than BGR
+    double margin;       // crop margin around each face (fraction of its size)
+  };
+} // namespace zak
+
+#endif // ZAK_FACE_EMBEDDER_HPP
@@ -0,0 +1,162 @@
+#ifndef ZAK_FACE_IDENTIFIER_HPP
+#define ZAK_FACE_IDENTIFIER_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "face_embedder.hpp"
+#include "identity_index.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Names tracked faces from their embeddings
+   *
+   * A tracked face keeps its identity between detections, so only faces
+   * whose track is new, or was last identified `refresh_detections`
+   * detections ago, are embedded; they are embedded in one batch per frame
+   * and looked up in the index. A face whose best match is less similar than
+   * `threshold` is unknown (an empty name).
+   */
+  class FaceIdentifier
+  {
+  public:
+    FaceIdentifier(FaceEmbedder &_embedder, IdentityIndex &_index) : _embedder(_embedder), _index(_index), _embedded(0), _lookups(0), _embed_ticks(0), _lookup_ticks(0), threshold(0.4f), refresh_detections(15) {}
+
+    /**
+     * \brief Name the faces of a frame
+     *
+     * \param[in] _bgr_image Video frame (BGR)
+     * \param[in] _faces Detections of the frame
+     * \param[in] _track_ids `FaceTracker` identifier of each detection
+     * \param[out] _names Identity of each detection (empty: unknown)
+     * \return 0 on success, -1 if embedding failed
+     */
+    int identify(const cv::Mat &_bgr_image, const std::vector<cv::Rect> &_faces, const std::vector<uint32_t> &_track_ids, std::vector<std::string> &_names)
+    {
+      // Faces to (re)identify
+      _pending_faces.clear();
+      _pending_tracks.clear();
+      for (size_t i = 0; i < _faces.size(); ++i)
+      {
+        std::map<uint32_t, Track>::iterator track = _tracks.find(_track_ids[i]);
+        if (track == _tracks.end() || ++track->second.age >= refresh_detections)
+        {
+          _pending_faces.push_back(_faces[i]);
+          _pending_tracks.push_back(_track_ids[i]);
+        }
+      }
+
+      int result = 0;
+      if (!_pending_faces.empty())
+      {
+        int64 start = cv::getTickCount();
+        result = _embedder.embed(_bgr_image, _pending_faces, _embeddings);
+        _embed_ticks += (cv::getTickCount() - start);
+        _embedded += (result ? 0 : _pending_faces.size());
+
+        start = cv::getTickCount();
+        for (size_t i = 0; !result && i < _pending_tracks.size(); ++i)
+        {
+          IdentityIndex::Match match;
+          Track &track = _tracks[_pending_tracks[i]];
+          track.age = 0;
+          track.name.clear();
+          track.similarity = 0;
+          if (_index.search(_embeddings.ptr<float>(static_cast<int>(i)), _embeddings.cols, match) && match.similarity >= threshold)
+          {
+            track.name = _index.name(match.identity);
+            track.similarity = match.similarity;
+          }
+          ++_lookups;
+        }
+        _lookup_ticks += (cv::getTickCount() - start);
+      }
+
+      // Forget tracks that ended
+      _names.assign(_faces.size(), std::string());
+      for (std::map<uint32_t, Track>::iterator track = _tracks.begin(); track != _tracks.end();)
+      {
+        std::vector<uint32_t>::const_iterator face = std::find(_track_ids.begin(), _track_ids.end(), track->first);
+        if (face == _track_ids.end())
+        {
+          track = _tracks.erase(track);
+          continue;
+        }
+        _names[face - _track_ids.begin()] = track->second.name;
+        ++track;
+      }
+      return result;
+    }
+
+    /**
+     * \brief Enroll the largest face of a frame under a name
+     *
+     * \return 0 on success, 1 without a face, -1 on failure
+     */
+    int enroll(const cv::Mat &_bgr_image, const std::vector<cv::Rect> &_faces, const std::string &_name)
+    {
+      if (_faces.empty())
+      {
+        return 1;
+      }
+      _pending_faces.assign(1, *std::max_element(_faces.begin(), _faces.end(), [](const cv::Rect &_a, const cv::Rect &_b) { return (_a.area() < _b.area()); }));
+      if (_embedder.embed(_bgr_image, _pending_faces, _embeddings) || _index.add(_embeddings.ptr<float>(0), _embeddings.cols, _name))
+      {
+        return -1;
+      }
+      _tracks.clear(); // Known faces may now match better
+      return 0;
+    }
+
+    /**
+     * \brief Faces embedded, mean embedding time per face (ms) and mean
+     *        lookup time (us) since the last reset
+     */
+    void report(std::ostream &_out) const
+    {
+      double frequency = cv::getTickFrequency();
+      _out << "embedded " << _embedded << " faces (" << (_embedded ? ((_embed_ticks * 1e3) / frequency / _embedded) : 0) << " ms/face), lookup " << (_lookups ? ((_lookup_ticks * 1e6) / frequency / _lookups) : 0) << " us";
+    }
+
+    void resetCounters(void)
+    {
+      _embedded = _lookups = 0;
+      _embed_ticks = _lookup_ticks = 0;
+    }
+
+  private:
+    struct Track
+    {
+      std::string name;
+      float similarity;
+      unsigned age; // detections since the track was identified
+    };
+
+    FaceEmbedder &_embedder;
+    IdentityIndex &_index;
+    std::map<uint32_t, Track> _tracks;
+    std::vector<cv::Rect> _pending_faces;
+    std::vector<uint32_t> _pending_tracks;
+    cv::Mat _embeddings;
+    uint64_t _embedded;
+    uint64_t _lookups;
+    int64 _embed_ticks;
+    int64 _lookup_ticks;
+
+  public:
+    float threshold;             // least cosine similarity of a known face
+    unsigned refresh_detections; // detections before a tracked face is identified again
+  };
+} // namespace zak
+
+#endif // ZAK_FACE_IDENTIFIER_HPP
@@ -0,0 +1,83 @@
+#ifndef ZAK_FACE_TRACKER_HPP
+#define ZAK_FACE_TRACKER_HPP
+
+// C/C++ Libraries
+#include <cstdint>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+namespace zak
+{
+  /**
+   * \brief Assigns stable identifiers to faces across consecutive frames
+   *
+   * Each detection is greedily matched to the unclaimed face from the previous
+   * frame with the highest overlap (intersection over union). Unmatched
+   * detections receive a new identifier.
+   */
+  class FaceTracker
+  {
+  public:
+    FaceTracker(double _min_overlap = 0.3) : _min_overlap(_min_overlap), _next_id(1) {}
+
+    /**
+     * \brief Associate the detections of a new frame with known faces
+     *
+     * \param[in] _faces Detections of the current frame
+     * \param[out] _ids Track identifier for each detection
+     */
+    void update(const std::vector<cv::Rect> &_faces, std::vector<uint32_t> &_ids)
+    {
+      std::vector<bool> claimed(_previous.size(), false);
+      _ids.resize(_faces.size());
+
+      for (size_t i = 0; i < _faces.size(); ++i)
+      {
+        double best_overlap = _min_overlap;
+        int best = -1;
+        for (size_t j = 0; j < _previous.size(); ++j)
+        {
+          if (claimed[j])
+          {
+            continue;
+          }
+          double overlap = intersectionOverUnion(_faces[i], _previous[j]);
+          if (overlap >= best_overlap)
+          {
+            best_overlap = overlap;
+            best = static_cast<int>(j);
+          }
+        }
+        if (best < 0)
+        {
+          _ids[i] = _next_id++;
+        }
+        else
+        {
+          claimed[best] = true;
+          _ids[i] = _previous_ids[best];
+        }
+      }
+
+      _previous = _faces;
+      _previous_ids = _ids;
+    }
+
+    static double intersectionOverUnion(const cv::Rect &_a, const cv::Rect &_b)
+    {
+      double intersection = (_a & _b).area();
+      double combined = (_a.area() + _b.area() - intersection);
+      return ((combined > 0) ? (intersection / combined) : 0.0);
+    }
+
+  private:
+    double _min_overlap;
+    uint32_t _next_id;
+    std::vector<cv::Rect> _previous;
+    std::vector<uint32_t> _previous_ids;
+  };
+} // namespace zak
+
+#endif // ZAK_FACE_TRACKER_HPP
@@ -0,0 +1,569 @@
+#ifndef ZAK_FRAME_BUS_HPP
+#define ZAK_FRAME_BUS_HPP
+
+// C/C++ Libraries
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <string>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Shared memory frame bus
+ * =======================
+ *
+ * `head_hunter` publishes every video frame, depth frame and detection result
+ * into a POSIX shared memory object (`shm_open`). Each channel is a ring of
+ * fixed size slots guarded by a seqlock:
+ *
+ * - the producer bumps the slot sequence to an odd value, copies the payload,
+ *   then bumps the sequence to the next even value; it never waits on readers
+ * - a reader samples the (even) sequence, uses the payload in place, then
+ *   re-checks the sequence; a changed value means the slot was overwritten
+ *   while it was being read and the data must be discarded
+ *
+ * Any number of readers may map the bus read-only. With `slot_count` slots a
+ * reader has `slot_count - 1` frame periods to consume a frame before the
+ * producer can reuse its slot.
+ *
+ * The header records the producer's pid. A new producer only replaces a bus
+ * whose producer is gone (crashed without unlinking it); a restarted producer
+ * creates a new object, which readers pick up after `replaced`.
+ */
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "frame bus requires lock-free 64-bit atomics"
+#endif
+
+namespace zak
+{
+  enum FrameBusChannel
+  {
+    FRAME_BUS_VIDEO = 0,
+    FRAME_BUS_DEPTH,
+    FRAME_BUS_DETECTIONS,
+    FRAME_BUS_CHANNEL_COUNT,
+  };
+
+  static const uint32_t FRAME_BUS_MAGIC = 0x5a414b42; // "ZAKB"
+  static const uint32_t FRAME_BUS_VERSION = 2;
+  static const size_t FRAME_BUS_ALIGNMENT = 64;
+  static const uint32_t FRAME_BUS_MAX_DETECTIONS = 64;
+
+  /**
+   * \brief Detection rectangle as stored in the detection channel
+   *
+   * Coordinates are in pixels of the published video frame.
+   */
+  struct FrameBusRect
+  {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+  };
+
+  /**
+   * \brief Per-slot metadata, immediately followed by the payload
+   */
+  struct alignas(FRAME_BUS_ALIGNMENT) FrameBusSlot
+  {
+    std::atomic<uint64_t> sequence; // seqlock (odd while being written)
+    uint64_t frame_sequence;        // producer frame counter
+    uint64_t timestamp_ns;          // CLOCK_MONOTONIC at publication
+    uint32_t width;                 // columns (rectangle count for detections)
+    uint32_t height;                // rows (1 for detections)
+    uint32_t type;                  // OpenCV matrix type (e.g. CV_8UC3)
+    uint32_t step;                  // bytes per row
+    uint32_t bytes;                 // valid payload bytes
+    uint32_t reserved;
+
+    uint8_t *payload(void) { return reinterpret_cast<uint8_t *>(this + 1); }
+    const uint8_t *payload(void) const { return reinterpret_cast<const uint8_t *>(this + 1); }
+  };
+
+  struct FrameBusChannelHeader
+  {
+    uint32_t slot_count;
+    uint32_t capacity;    // maximum payload bytes per slot
+    uint64_t slot_stride; // bytes between consecutive slots
+    uint64_t offset;      // byte offset of the first slot from the bus base
+    std::atomic<uint64_t> published; // count of complete publications (0 == none)
+  };
+
+  struct alignas(FRAME_BUS_ALIGNMENT) FrameBusHeader
+  {
+    std::atomic<uint32_t> magic; // written last by the producer
+    uint32_t version;
+    uint64_t total_bytes;
+    int32_t producer_pid;        // process that created the bus
+    uint32_t reserved;
+    FrameBusChannelHeader channels[FRAME_BUS_CHANNEL_COUNT];
+  };
+
+  inline uint64_t frameBusTimestamp(void)
+  {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((static_cast<uint64_t>(now.tv_sec) * 1000000000ull) + now.tv_nsec);
+  }
+
+  inline uint64_t frameBusAlign(uint64_t _bytes)
+  {
+    return ((_bytes + (FRAME_BUS_ALIGNMENT - 1)) & ~static_cast<uint64_t>(FRAME_BUS_ALIGNMENT - 1));
+  }
+
+  /**
+   * \brief Producer side of the frame bus (single writer)
+   */
+  class FrameBusWriter
+  {
+  public:
+    FrameBusWriter(void) : _base(nullptr), _bytes(0), _frame_sequences() {}
+
+    ~FrameBusWriter(void)
+    {
+      close();
+    }
+
+    /**
+     * \brief Create the shared memory object and size the rings
+     *
+     * An existing object is only replaced when its producer no longer runs.
+     *
+     * \param[in] _name POSIX shared memory name (e.g. "/head_hunter")
+     * \param[in] _capacities Maximum payload bytes for each channel
+     * \param[in] _slot_count Number of slots per channel ring
+     * \return 0 on success, -1 on failure
+     */
+    int open(
+        const std::string &_name,
+        const uint32_t (&_capacities)[FRAME_BUS_CHANNEL_COUNT],
+        uint32_t _slot_count)
+    {
+      close();
+      if (_slot_count < 2)
+      {
+        std::cerr << "Frame bus requires at least two slots per channel" << std::endl;
+        return -1;
+      }
+
+      // Compute the layout
+      uint64_t offset = frameBusAlign(sizeof(FrameBusHeader));
+      uint64_t strides[FRAME_BUS_CHANNEL_COUNT], offsets[FRAME_BUS_CHANNEL_COUNT];
+      for (int channel = 0; channel < FRAME_BUS_CHANNEL_COUNT; ++channel)
+      {
+        strides[channel] = frameBusAlign(sizeof(FrameBusSlot) + _capacities[channel]);
+        offsets[channel] = offset;
+        offset += (strides[channel] * _slot_count);
+      }
+
+      // Replace a stale object left behind by a crashed producer, never a live one
+      int fd = shm_open(_name.c_str(), (O_CREAT | O_EXCL | O_RDWR), 0644);
+      if (fd < 0 && errno == EEXIST)
+      {
+        pid_t producer = 0;
+        if (!stale(_name, producer))
+        {
+          if (producer)
+          {
+            std::cerr << "Frame bus " << _name << " is in use by process " << producer << std::endl;
+          }
+          else
+          {
+            std::cerr << "Frame bus " << _name << " exists and its producer is unknown (remove /dev/shm" << _name << " if none runs)" << std::endl;
+          }
+          return -1;
+        }
+        shm_unlink(_name.c_str());
+        fd = shm_open(_name.c_str(), (O_CREAT | O_EXCL | O_RDWR), 0644);
+      }
+      if (fd < 0)
+      {
+        perror("shm_open()");
+        return -1;
+      }
+      if (ftruncate(fd, offset))
+      {
+        perror("ftruncate()");
+        ::close(fd);
+        shm_unlink(_name.c_str());
+        return -1;
+      }
+      void *base = mmap(nullptr, offset, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (base == MAP_FAILED)
+      {
+        perror("mmap()");
+        shm_unlink(_name.c_str());
+        return -1;
+      }
+      _base = static_cast<uint8_t *>(base);
+      _bytes = offset;
+      _bus_name = _name;
+
+      // Initialize the header (the mapping is zero filled by `ftruncate`)
+      FrameBusHeader *header = new (_base) FrameBusHeader;
+      header->version = FRAME_BUS_VERSION;
+      header->total_bytes = offset;
+      header->producer_pid = getpid();
+      for (int channel = 0; channel < FRAME_BUS_CHANNEL_COUNT; ++channel)
+      {
+        header->channels[channel].slot_count = _slot_count;
+        header->channels[channel].capacity = _capacities[channel];
+        header->channels[channel].slot_stride = strides[channel];
+        header->channels[channel].offset = offsets[channel];
+        header->channels[channel].published.store(0, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < _slot_count; ++i)
+        {
+          new (slot(static_cast<FrameBusChannel>(channel), i)) FrameBusSlot;
+          slot(static_cast<FrameBusChannel>(channel), i)->sequence.store(0, std::memory_order_relaxed);
+        }
+      }
+      _frame_sequences[FRAME_BUS_VIDEO] = _frame_sequences[FRAME_BUS_DEPTH] = _frame_sequences[FRAME_BUS_DETECTIONS] = 0;
+      header->magic.store(FRAME_BUS_MAGIC, std::memory_order_release);
+
+      return 0;
+    }
+
+    void close(void)
+    {
+      if (_base)
+      {
+        munmap(_base, _bytes);
+        shm_unlink(_bus_name.c_str());
+        _base = nullptr;
+        _bytes = 0;
+      }
+    }
+
+    bool isOpen(void) const
+    {
+      return _base;
+    }
+
+    /**
+     * \brief Publish a frame on a channel (never blocks)
+     *
+     * \param[in] _channel Destination channel
+     * \param[in] _frame_sequence Producer frame counter
+     * \param[in] _data Payload (`_height` rows of `_step` bytes)
+     * \param[in] _width Columns
+     * \param[in] _height Rows
+     * \param[in] _type OpenCV matrix type
+     * \param[in] _step Bytes per source row
+     * \param[in] _row_bytes Bytes to copy from each row
+     * \return 0 on success, -1 when the payload exceeds the slot capacity
+     */
+    int publish(
+        FrameBusChannel _channel,
+        uint64_t _frame_sequence,
+        const uint8_t *_data,
+        uint32_t _width,
+        uint32_t _height,
+        uint32_t _type,
+        size_t _step,
+        size_t _row_bytes)
+    {
+      FrameBusChannelHeader &channel = header()->channels[_channel];
+      size_t bytes = (_row_bytes * _height);
+      if (!_base || bytes > channel.capacity)
+      {
+        return -1;
+      }
+
+      // Enter the write side of the seqlock
+      uint64_t index = _frame_sequences[_channel]++;
+      FrameBusSlot *target = slot(_channel, (index % channel.slot_count));
+      uint64_t sequence = target->sequence.load(std::memory_order_relaxed);
+      target->sequence.store((sequence + 1), std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      target->frame_sequence = _frame_sequence;
+      target->timestamp_ns = frameBusTimestamp();
+      target->width = _width;
+      target->height = _height;
+      target->type = _type;
+      target->step = static_cast<uint32_t>(_row_bytes);
+      target->bytes = static_cast<uint32_t>(bytes);
+      if (_step == _row_bytes)
+      {
+        std::memcpy(target->payload(), _data, bytes);
+      }
+      else
+      {
+        for (uint32_t row = 0; row < _height; ++row)
+        {
+          std::memcpy((target->payload() + (row * _row_bytes)), (_data + (row * _step)), _row_bytes);
+        }
+      }
+
+      // Leave the write side of the seqlock and advertise the slot
+      target->sequence.store((sequence + 2), std::memory_order_release);
+      channel.published.store((index + 1), std::memory_order_release);
+
+      return 0;
+    }
+
+    int publishDetections(
+        uint64_t _frame_sequence,
+        const FrameBusRect *_rects,
+        uint32_t _count)
+    {
+      if (_count > FRAME_BUS_MAX_DETECTIONS)
+      {
+        _count = FRAME_BUS_MAX_DETECTIONS;
+      }
+      return publish(
+          FRAME_BUS_DETECTIONS,
+          _frame_sequence,
+          reinterpret_cast<const uint8_t *>(_rects),
+          _count,
+          1,
+          0,
+          (sizeof(FrameBusRect) * _count),
+          (sizeof(FrameBusRect) * _count));
+    }
+
+  private:
+    uint8_t *_base;
+    uint64_t _bytes;
+    std::string _bus_name;
+    uint64_t _frame_sequences[FRAME_BUS_CHANNEL_COUNT];
+
+    FrameBusHeader *header(void)
+    {
+      return reinterpret_cast<FrameBusHeader *>(_base);
+    }
+
+    /**
+     * \brief Whether an existing bus was left behind by a producer that is gone
+     *
+     * \param[out] _producer Its producer (0 if the bus is not a complete bus of
+     *                       this version, whose producer cannot be told)
+     */
+    static bool stale(const std::string &_name, pid_t &_producer)
+    {
+      _producer = 0;
+      int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+      if (fd < 0)
+      {
+        return (errno == ENOENT);
+      }
+      struct stat info;
+      void *base = MAP_FAILED;
+      if (!fstat(fd, &info) && info.st_size >= static_cast<off_t>(sizeof(FrameBusHeader)))
+      {
+        base = mmap(nullptr, sizeof(FrameBusHeader), PROT_READ, MAP_SHARED, fd, 0);
+      }
+      ::close(fd);
+      if (base == MAP_FAILED)
+      {
+        return false;
+      }
+      const FrameBusHeader *bus = static_cast<const FrameBusHeader *>(base);
+      if (bus->magic.load(std::memory_order_acquire) == FRAME_BUS_MAGIC && bus->version == FRAME_BUS_VERSION)
+      {
+        _producer = bus->producer_pid;
+      }
+      munmap(base, sizeof(FrameBusHeader));
+      return (_producer > 0 && kill(_producer, 0) && errno == ESRCH);
+    }
+
+    FrameBusSlot *slot(FrameBusChannel _channel, uint64_t _index)
+    {
+      const FrameBusChannelHeader &channel = header()->channels[_channel];
+      return reinterpret_cast<FrameBusSlot *>(_base + channel.offset + (_index * channel.slot_stride));
+    }
+  };
+
+  /**
+   * \brief A zero-copy view of a published slot
+   *
+   * The payload pointer aliases shared memory. It is only trustworthy if
+   * `FrameBusReader::validate` still returns true after the data was used.
+   */
+  struct FrameBusView
+  {
+    const FrameBusSlot *slot;
+    uint64_t sequence;
+    uint64_t frame_sequence;
+    uint64_t timestamp_ns;
+    uint32_t width;
+    uint32_t height;
+    uint32_t type;
+    uint32_t step;
+    uint32_t bytes;
+    const uint8_t *data;
+  };
+
+  /**
+   * \brief Consumer side of the frame bus (any number of readers)
+   */
+  class FrameBusReader
+  {
+  public:
+    FrameBusReader(void) : _base(nullptr), _bytes(0), _device(0), _inode(0) {}
+
+    ~FrameBusReader(void)
+    {
+      close();
+    }
+
+    /**
+     * \brief Map an existing bus read-only
+     *
+     * \return 0 on success, -1 if the bus does not exist or is incompatible
+     */
+    int open(const std::string &_name)
+    {
+      close();
+      int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+      if (fd < 0)
+      {
+        return -1;
+      }
+      struct stat info;
+      if (fstat(fd, &info) || info.st_size < static_cast<off_t>(sizeof(FrameBusHeader)))
+      {
+        ::close(fd);
+        return -1;
+      }
+      void *base = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (base == MAP_FAILED)
+      {
+        perror("mmap()");
+        return -1;
+      }
+      _base = static_cast<const uint8_t *>(base);
+      _bytes = info.st_size;
+      _bus_name = _name;
+      _device = info.st_dev;
+      _inode = info.st_ino;
+
+      const FrameBusHeader *bus = header();
+      if (bus->magic.load(std::memory_order_acquire) != FRAME_BUS_MAGIC || bus->version != FRAME_BUS_VERSION || bus->total_bytes != _bytes)
+      {
+        std::cerr << "Incompatible frame bus " << _name << std::endl;
+        close();
+        return -1;
+      }
+
+      return 0;
+    }
+
+    void close(void)
+    {
+      if (_base)
+      {
+        munmap(const_cast<uint8_t *>(_base), _bytes);
+        _base = nullptr;
+        _bytes = 0;
+      }
+    }
+
+    bool isOpen(void) const
+    {
+      return _base;
+    }
+
+    /**
+     * \brief Whether the mapped bus was removed or replaced (the producer exited
+     *        or restarted); `open` again to follow it
+     */
+    bool replaced(void) const
+    {
+      int fd = shm_open(_bus_name.c_str(), O_RDONLY, 0);
+      if (fd < 0)
+      {
+        return true;
+      }
+      struct stat info;
+      bool same = (!fstat(fd, &info) && info.st_dev == _device && info.st_ino == _inode);
+      ::close(fd);
+      return !same;
+    }
+
+    /**
+     * \brief Number of frames published so far on a channel
+     */
+    uint64_t published(FrameBusChannel _channel) const
+    {
+      return header()->channels[_channel].published.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief Acquire a view of the most recent frame on a channel
+     *
+     * \return true when a consistent snapshot of the metadata was taken
+     */
+    bool latest(FrameBusChannel _channel, FrameBusView &_view) const
+    {
+      uint64_t count = published(_channel);
+      return (count && at(_channel, (count - 1), _view));
+    }
+
+    /**
+     * \brief Acquire a view of a specific publication (0 based)
+     *
+     * Fails once the publication has been overwritten by the producer.
+     */
+    bool at(FrameBusChannel _channel, uint64_t _index, FrameBusView &_view) const
+    {
+      const FrameBusChannelHeader &channel = header()->channels[_channel];
+      const FrameBusSlot *source = reinterpret_cast<const FrameBusSlot *>(_base + channel.offset + ((_index % channel.slot_count) * channel.slot_stride));
+
+      uint64_t sequence = source->sequence.load(std::memory_order_acquire);
+      if (sequence & 1)
+      {
+        return false;
+      }
+      _view.slot = source;
+      _view.sequence = sequence;
+      _view.frame_sequence = source->frame_sequence;
+      _view.timestamp_ns = source->timestamp_ns;
+      _view.width = source->width;
+      _view.height = source->height;
+      _view.type = source->type;
+      _view.step = source->step;
+      _view.bytes = source->bytes;
+      _view.data = source->payload();
+
+      // The slot must still hold the requested publication
+      return (validate(_view) && (_view.bytes <= channel.capacity) && ((published(_channel) - _index) <= channel.slot_count));
+    }
+
+    /**
+     * \brief Confirm the producer has not touched the slot since `latest`/`at`
+     */
+    bool validate(const FrameBusView &_view) const
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return (_view.slot->sequence.load(std::memory_order_relaxed) == _view.sequence);
+    }
+
+  private:
+    const uint8_t *_base;
+    uint64_t _bytes;
+    std::string _bus_name;
+    dev_t _device;
+    ino_t _inode;
+
+    const FrameBusHeader *header(void) const
+    {
+      return reinterpret_cast<const FrameBusHeader *>(_base);
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_FRAME_BUS_HPP
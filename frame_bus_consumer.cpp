@@ -0,0 +1,119 @@
+// C/C++ Libraries
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "frame_bus.hpp"
+
+/*
+ * Sample frame bus consumer
+ *
+ * Maps the `head_hunter` frame bus read-only and reports each new video,
+ * depth and detection publication. Frames are inspected in place (zero-copy)
+ * by wrapping the shared memory in a `cv::Mat` header, then validated against
+ * the slot seqlock to discard any frame the producer overwrote mid-read.
+ * When the producer exits or restarts, the consumer waits for and maps the
+ * new bus.
+ *
+ * Usage: frame_bus_consumer [bus name (default: /head_hunter)]
+ */
+int main(int argc, char **argv)
+{
+  std::string bus_name("/head_hunter");
+  if (argc > 1)
+  {
+    bus_name = argv[1];
+  }
+
+  zak::FrameBusReader bus;
+  uint64_t consumed[zak::FRAME_BUS_CHANNEL_COUNT] = {0, 0, 0};
+  uint64_t torn(0), missed(0);
+  int idle_ms = 0;
+  for (;;)
+  {
+    // Map the bus once the producer creates it, and again after it restarts
+    if (idle_ms >= 1000)
+    {
+      if (bus.replaced())
+      {
+        std::cerr << "Frame bus " << bus_name << " was closed" << std::endl;
+        bus.close();
+      }
+      idle_ms = 0;
+    }
+    if (!bus.isOpen())
+    {
+      while (bus.open(bus_name))
+      {
+        std::cerr << "Waiting for frame bus " << bus_name << "..." << std::endl;
+        sleep(1);
+      }
+      consumed[zak::FRAME_BUS_VIDEO] = consumed[zak::FRAME_BUS_DEPTH] = consumed[zak::FRAME_BUS_DETECTIONS] = 0;
+    }
+
+    bool idle = true;
+    for (int channel = 0; channel < zak::FRAME_BUS_CHANNEL_COUNT; ++channel)
+    {
+      zak::FrameBusChannel bus_channel = static_cast<zak::FrameBusChannel>(channel);
+      uint64_t published = bus.published(bus_channel);
+      if (published == consumed[channel])
+      {
+        continue;
+      }
+      idle = false;
+      missed += (published - consumed[channel] - 1);
+      consumed[channel] = published;
+
+      zak::FrameBusView view;
+      if (!bus.latest(bus_channel, view))
+      {
+        ++torn;
+        continue;
+      }
+
+      // Use the payload in place
+      std::ostringstream report;
+      double age_ms = ((zak::frameBusTimestamp() - view.timestamp_ns) / 1e6);
+      if (bus_channel == zak::FRAME_BUS_DETECTIONS)
+      {
+        const zak::FrameBusRect *rects = reinterpret_cast<const zak::FrameBusRect *>(view.data);
+        report << "faces #" << view.frame_sequence << " count " << view.width;
+        for (uint32_t i = 0; i < view.width; ++i)
+        {
+          report << " [" << rects[i].x << "," << rects[i].y << " " << rects[i].width << "x" << rects[i].height << "]";
+        }
+      }
+      else
+      {
+        cv::Mat frame(view.height, view.width, view.type, const_cast<uint8_t *>(view.data), view.step);
+        cv::Scalar average = cv::mean(frame);
+        report << ((bus_channel == zak::FRAME_BUS_VIDEO) ? "video" : "depth") << " #" << view.frame_sequence
+               << " " << view.width << "x" << view.height << " mean " << average[0];
+      }
+      report << " (age " << age_ms << " ms, torn " << torn << ", missed " << missed << ")";
+
+      // Discard the result if the producer reused the slot while we read it
+      if (!bus.validate(view))
+      {
+        ++torn;
+        continue;
+      }
+      std::cout << report.str() << std::endl;
+    }
+
+    if (idle)
+    {
+      usleep(1000);
+      ++idle_ms;
+    }
+    else
+    {
+      idle_ms = 0;
+    }
+  }
+}
@@ -0,0 +1,406 @@
+#ifndef ZAK_FRAME_CACHE_HPP
+#define ZAK_FRAME_CACHE_HPP
+
+// C/C++ Libraries
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "frame_kernels.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Recycles image buffers from frame to frame
+   *
+   * Buffers are handed out by `acquire` and all become free again on
+   * `recycle`, so steady state processing allocates nothing even when the
+   * requested sizes vary (e.g. as the quality controller changes scale).
+   */
+  class MatPool
+  {
+  public:
+    /**
+     * \brief A buffer of the given geometry (valid until `recycle`)
+     */
+    cv::Mat acquire(cv::Size _size, int _type)
+    {
+      for (size_t i = 0; i < _buffers.size(); ++i)
+      {
+        if (!_in_use[i] && _buffers[i].size() == _size && _buffers[i].type() == _type)
+        {
+          _in_use[i] = true;
+          return _buffers[i];
+        }
+      }
+      _buffers.push_back(cv::Mat(_size, _type));
+      _in_use.push_back(true);
+      return _buffers.back();
+    }
+
+    void recycle(void)
+    {
+      _in_use.assign(_in_use.size(), false);
+    }
+
+    size_t size(void) const { return _buffers.size(); }
+
+  private:
+    std::vector<cv::Mat> _buffers;
+    std::vector<bool> _in_use;
+  };
+
+  /**
+   * \brief Route T-API (`cv::UMat`) work to OpenCL when a device exists
+   *
+   * Without a device (or when not requested) OpenCL stays off and `cv::UMat`
+   * operations run on the CPU, so the accelerated code path still works.
+   *
+   * \return true when OpenCL is in use
+   */
+  inline bool configureOpenCL(bool _requested, std::ostream &_log)
+  {
+    if (!_requested)
+    {
+      cv::ocl::setUseOpenCL(false);
+      return false;
+    }
+    if (!cv::ocl::haveOpenCL())
+    {
+      _log << "OpenCL unavailable; accelerated path falls back to the CPU" << std::endl;
+      cv::ocl::setUseOpenCL(false);
+      return false;
+    }
+    cv::ocl::setUseOpenCL(true);
+    if (!cv::ocl::useOpenCL() || !cv::ocl::Device::getDefault().available())
+    {
+      _log << "No usable OpenCL device; accelerated path falls back to the CPU" << std::endl;
+      cv::ocl::setUseOpenCL(false);
+      return false;
+    }
+    _log << "OpenCL device: " << cv::ocl::Device::getDefault().name() << " (" << cv::ocl::Device::getDefault().vendorName() << ", " << cv::ocl::Device::getDefault().version() << ")" << std::endl;
+    return true;
+  }
+
+  /**
+   * \brief Per-frame cache of the images detection passes scan
+   *
+   * Every detection pass used to downscale and convert the frame itself, so a
+   * frame scanned by several cascades or regions was preprocessed several
+   * times. The cache computes each pyramid level (frame downscaled by an image
+   * scale, in grayscale) once, on first use, and shares it with every pass on
+   * that frame. Levels are produced exactly as `FaceDetector::preprocess`
+   * produces them, so cached and uncached detection agree.
+   *
+   * The frame passed to `reset` is referenced, not copied; it must not change
+   * until the next `reset`.
+   *
+   * When accelerated, the frame is uploaded once and levels are also offered
+   * as `cv::UMat` (`levelUMat`), so downscaling, conversion and the cascade
+   * run through OpenCV's T-API (see `configureOpenCL`).
+   *
+   * A Bayer frame (`resetBayer`) is never demosaiced for detection: levels
+   * of at least half scale come from the half resolution luma, finer ones
+   * from a direct Bayer to grayscale conversion. The color frame is only
+   * demosaiced when `bgr` is asked for (display, recording).
+   *
+   * A YUV frame (`resetUYVY`) is handled the same way: detection only reads
+   * its Y samples, and chroma is only converted when `bgr` is asked for. An
+   * 8-bit IR frame (`resetGrayscale`) is the full resolution grayscale as is.
+   */
+  class FrameCache
+  {
+  public:
+    FrameCache(void) : _raw_format(RAW_NONE), _accelerated(false), _uploaded(false), _hits(0), _misses(0) {}
+
+    void setAccelerated(bool _enable) { _accelerated = _enable; }
+    bool accelerated(void) const { return _accelerated; }
+
+    /**
+     * \brief Start a new frame (previous levels are recycled)
+     */
+    void reset(const cv::Mat &_bgr_image)
+    {
+      _frame_bgr = _bgr_image;
+      _frame_raw = cv::Mat();
+      _raw_format = RAW_NONE;
+      clear();
+    }
+
+    /**
+     * \brief Start a new frame from Bayer video (GRBG, `CV_8UC1`)
+     */
+    void resetBayer(const cv::Mat &_bayer_image)
+    {
+      resetRaw(_bayer_image, RAW_BAYER);
+    }
+
+    /**
+     * \brief Start a new frame from YUV video (UYVY, `CV_8UC2`)
+     */
+    void resetUYVY(const cv::Mat &_uyvy_image)
+    {
+      resetRaw(_uyvy_image, RAW_UYVY);
+    }
+
+    /**
+     * \brief Start a new frame from grayscale video (8-bit IR, `CV_8UC1`)
+     */
+    void resetGrayscale(const cv::Mat &_grayscale_image)
+    {
+      resetRaw(_grayscale_image, RAW_GRAY);
+      _grayscale = _frame_raw;
+    }
+
+    bool bayer(void) const { return (_raw_format == RAW_BAYER); }
+    bool uyvy(void) const { return (_raw_format == RAW_UYVY); }
+
+    /**
+     * \brief Whether the frame is sensor data that is only converted to BGR on demand
+     */
+    bool raw(void) const { return (_raw_format != RAW_NONE); }
+
+    cv::Size size(void) const { return (raw() ? _frame_raw.size() : _frame_bgr.size()); }
+
+    /**
+     * \brief The frame in BGR (raw frames are converted on first use)
+     */
+    const cv::Mat &bgr(void)
+    {
+      if (_frame_bgr.empty() && raw())
+      {
+        ++_misses;
+        _frame_bgr = _pool.acquire(_frame_raw.size(), CV_8UC3);
+        if (bayer())
+        {
+          convertBayerToBGR(_frame_raw, _frame_bgr);
+        }
+        else if (uyvy())
+        {
+          convertUYVYToBGR(_frame_raw, _frame_bgr);
+        }
+        else
+        {
+          convertGrayToBGR(_frame_raw, _frame_bgr);
+        }
+      }
+      return _frame_bgr;
+    }
+
+    /**
+     * \brief The frame in grayscale, at full resolution
+     */
+    const cv::Mat &grayscale(void)
+    {
+      if (_grayscale.empty())
+      {
+        ++_misses;
+        _grayscale = _pool.acquire(size(), CV_8UC1);
+        if (bayer())
+        {
+          convertBayerToGray(_frame_raw, _grayscale);
+        }
+        else if (uyvy())
+        {
+          extractUYVYLuma(_frame_raw, _grayscale);
+        }
+        else
+        {
+          cv::cvtColor(_frame_bgr, _grayscale, cv::COLOR_BGR2GRAY);
+        }
+      }
+      else
+      {
+        ++_hits;
+      }
+      return _grayscale;
+    }
+
+    bool hasGrayscale(void) const { return !_grayscale.empty(); }
+
+    /**
+     * \brief The frame downscaled by `_image_scale`, in grayscale
+     */
+    cv::Mat level(float _image_scale, int _interpolation = cv::INTER_LINEAR)
+    {
+      if (_image_scale == 1.0f)
+      {
+        return grayscale();
+      }
+      for (auto &level : _levels)
+      {
+        if (level.scale == _image_scale && level.interpolation == _interpolation)
+        {
+          ++_hits;
+          return level.image;
+        }
+      }
+
+      ++_misses;
+      Level level;
+      level.scale = _image_scale;
+      level.interpolation = _interpolation;
+      cv::Size size((this->size().width / _image_scale), (this->size().height / _image_scale));
+      if (raw())
+      {
+        // Downscale luma rather than convert color
+        const cv::Mat &source = ((bayer() && _image_scale >= 2.0f) ? halfLuma() : grayscale());
+        if (source.size() == size)
+        {
+          level.image = source;
+        }
+        else
+        {
+          level.image = _pool.acquire(size, CV_8UC1);
+          cv::resize(source, level.image, size, 0, 0, _interpolation);
+        }
+      }
+      else
+      {
+        cv::Mat downscaled = _pool.acquire(size, _frame_bgr.type());
+        level.image = _pool.acquire(size, CV_8UC1);
+        cv::resize(_frame_bgr, downscaled, size, 0, 0, _interpolation);
+        cv::cvtColor(downscaled, level.image, cv::COLOR_BGR2GRAY);
+      }
+      _levels.push_back(level);
+      return level.image;
+    }
+
+    /**
+     * \brief `level` as a T-API image (buffers persist across frames)
+     *
+     * Levels of raw frames are computed on the CPU and uploaded.
+     */
+    cv::UMat levelUMat(float _image_scale, int _interpolation = cv::INTER_LINEAR)
+    {
+      if (!_uploaded && !raw())
+      {
+        _frame_bgr.copyTo(_frame_umat);
+        _uploaded = true;
+      }
+
+      UMatLevel *level = nullptr;
+      for (auto &candidate : _umat_levels)
+      {
+        if (candidate.scale == _image_scale && candidate.interpolation == _interpolation)
+        {
+          level = &candidate;
+          break;
+        }
+      }
+      if (!level)
+      {
+        _umat_levels.push_back(UMatLevel());
+        level = &_umat_levels.back();
+        level->scale = _image_scale;
+        level->interpolation = _interpolation;
+        level->valid = false;
+      }
+      if (level->valid)
+      {
+        ++_hits;
+        return level->image;
+      }
+
+      ++_misses;
+      if (raw())
+      {
+        this->level(_image_scale, _interpolation).copyTo(level->image);
+      }
+      else if (_image_scale == 1.0f)
+      {
+        cv::cvtColor(_frame_umat, level->image, cv::COLOR_BGR2GRAY);
+      }
+      else
+      {
+        cv::Size size((_frame_bgr.size().width / _image_scale), (_frame_bgr.size().height / _image_scale));
+        cv::resize(_frame_umat, level->downscaled, size, 0, 0, _interpolation);
+        cv::cvtColor(level->downscaled, level->image, cv::COLOR_BGR2GRAY);
+      }
+      level->valid = true;
+      return level->image;
+    }
+
+    uint64_t hits(void) const { return _hits; }
+    uint64_t misses(void) const { return _misses; }
+
+  private:
+    enum RawFormat
+    {
+      RAW_NONE,
+      RAW_BAYER,
+      RAW_UYVY,
+      RAW_GRAY
+    };
+
+    struct Level
+    {
+      float scale;
+      int interpolation;
+      cv::Mat image;
+    };
+
+    struct UMatLevel
+    {
+      float scale;
+      int interpolation;
+      bool valid;
+      cv::UMat downscaled;
+      cv::UMat image;
+    };
+
+    cv::Mat _frame_bgr;
+    cv::Mat _frame_raw;
+    RawFormat _raw_format;
+    cv::Mat _grayscale;
+    cv::Mat _half_luma;
+    std::vector<Level> _levels;
+    MatPool _pool;
+    bool _accelerated;
+    bool _uploaded;
+    cv::UMat _frame_umat;
+    std::vector<UMatLevel> _umat_levels;
+    uint64_t _hits;
+    uint64_t _misses;
+
+    void resetRaw(const cv::Mat &_raw_image, RawFormat _format)
+    {
+      _frame_bgr = cv::Mat();
+      _frame_raw = _raw_image;
+      _raw_format = _format;
+      clear();
+    }
+
+    /**
+     * \brief Forget the previous frame's images
+     */
+    void clear(void)
+    {
+      _grayscale = cv::Mat();
+      _half_luma = cv::Mat();
+      _levels.clear();
+      _pool.recycle();
+      _uploaded = false;
+      for (auto &level : _umat_levels)
+      {
+        level.valid = false;
+      }
+    }
+
+    const cv::Mat &halfLuma(void)
+    {
+      if (_half_luma.empty())
+      {
+        _half_luma = _pool.acquire(cv::Size((_frame_raw.cols / 2), (_frame_raw.rows / 2)), CV_8UC1);
+        convertBayerToHalfLuma(_frame_raw, _half_luma);
+      }
+      return _half_luma;
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_FRAME_CACHE_HPP
@@ -0,0 +1,140 @@
+#ifndef ZAK_FRAME_DEDUP_HPP
+#define ZAK_FRAME_DEDUP_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+namespace zak
+{
+  /**
+   * \brief Detects near-duplicate video frames so detection can be skipped
+   *
+   * A static scene still arrives at 30 frames per second, and every frame used
+   * to run the full detection chain. Each frame is reduced to a block-mean
+   * signature (the frame area-averaged down to `grid` blocks, in grayscale),
+   * which costs one pass over the frame. Sensor noise averages out within a
+   * block, while a moving face changes the blocks it covers.
+   *
+   * A frame is a duplicate when no block differs from the reference signature
+   * (the last frame that was processed) by more than `threshold` gray levels.
+   * Comparing with the reference rather than the previous frame keeps slow
+   * drift from accumulating unnoticed, and after `max_reuse` consecutive
+   * duplicates a frame is processed anyway, which bounds staleness.
+   */
+  class FrameDeduplicator
+  {
+  public:
+    /**
+     * \param[in] _threshold Largest block difference of a duplicate (gray levels)
+     * \param[in] _max_reuse Consecutive duplicates before a frame is processed anyway
+     */
+    FrameDeduplicator(double _threshold = 6, unsigned _max_reuse = 15)
+        : _reuse_count(0),
+          _distance(0),
+          _frames(0),
+          _skipped(0),
+          threshold(_threshold),
+          max_reuse(_max_reuse),
+          grid(16, 12) {}
+
+    /**
+     * \brief Sign a frame and compare it with the reference
+     *
+     * \param[in] _bgr_image Video frame (BGR, or single channel luma / Bayer)
+     * \return true when the frame is a duplicate (reuse the previous results);
+     *         false when it must be processed (it becomes the reference)
+     */
+    bool duplicate(const cv::Mat &_bgr_image)
+    {
+      ++_frames;
+      if (_bgr_image.channels() == 1)
+      {
+        // Grayscale or Bayer video: block means are already luma
+        cv::resize(_bgr_image, _signature, grid, 0, 0, cv::INTER_AREA);
+      }
+      else
+      {
+        cv::resize(_bgr_image, _blocks, grid, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(_blocks, _signature, cv::COLOR_BGR2GRAY);
+      }
+
+      _distance = distance(_signature, _reference);
+      if (_distance > threshold || _reuse_count >= max_reuse)
+      {
+        std::swap(_signature, _reference);
+        _reuse_count = 0;
+        return false;
+      }
+      ++_reuse_count;
+      ++_skipped;
+      return true;
+    }
+
+    /**
+     * \brief Process the next frame regardless of its signature
+     */
+    void invalidate(void)
+    {
+      _reference = cv::Mat();
+      _reuse_count = 0;
+    }
+
+    /**
+     * \brief Largest block difference of the last frame (gray levels)
+     */
+    double lastDistance(void) const { return _distance; }
+
+    uint64_t frames(void) const { return _frames; }
+    uint64_t skipped(void) const { return _skipped; }
+    double skipRate(void) const { return (_frames ? (static_cast<double>(_skipped) / _frames) : 0); }
+
+    void resetCounters(void)
+    {
+      _frames = _skipped = 0;
+    }
+
+  private:
+    cv::Mat _blocks;
+    cv::Mat _signature;
+    cv::Mat _reference;
+    unsigned _reuse_count;
+    double _distance;
+    uint64_t _frames;
+    uint64_t _skipped;
+
+    /**
+     * \brief Largest per-block difference (infinite without a comparable reference)
+     */
+    static double distance(const cv::Mat &_signature, const cv::Mat &_reference)
+    {
+      if (_reference.size() != _signature.size())
+      {
+        return HUGE_VAL;
+      }
+      int largest = 0;
+      for (int row = 0; row < _signature.rows; ++row)
+      {
+        const uint8_t *signature = _signature.ptr<uint8_t>(row);
+        const uint8_t *reference = _reference.ptr<uint8_t>(row);
+        for (int column = 0; column < _signature.cols; ++column)
+        {
+          largest = std::max(largest, std::abs(signature[column] - reference[column]));
+        }
+      }
+      return largest;
+    }
+
+  public:
+    double threshold;   // largest block difference of a duplicate (gray levels)
+    unsigned max_reuse; // consecutive duplicates before a frame is processed anyway
+    cv::Size grid;      // signature blocks (columns x rows)
+  };
+} // namespace zak
+
+#endif // ZAK_FRAME_DEDUP_HPP
@@ -0,0 +1,231 @@
+#ifndef ZAK_FRAME_EXCHANGE_HPP
+#define ZAK_FRAME_EXCHANGE_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "frame_signal.hpp"
+#include "spsc_ring.hpp"
+#include "triple_buffer.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Wait-free hand-off of frames from one producer to one consumer
+   *
+   * The producer (libfreenect event thread) always owns one "back" frame to
+   * fill and publishes it without waiting; the consumer (main loop) acquires a
+   * published frame, reads it at leisure, then releases it. Frame buffers are
+   * allocated once and only their ownership moves between threads.
+   *
+   * Two policies are available:
+   *
+   * - `FRAME_EXCHANGE_MAILBOX` (latest only): a triple buffer. Publishing
+   *   swaps the back frame with the shared "middle" frame; acquiring swaps the
+   *   consumer's frame with the middle frame if it is fresh. The consumer always
+   *   sees the newest frame; frames it never looked at count as dropped.
+   * - `FRAME_EXCHANGE_QUEUE` (FIFO): published frames wait in an SPSC ring
+   *   and are consumed in order. When every frame is queued or in use the
+   *   producer overwrites its back frame, dropping the newest frame.
+   *
+   * An optional `FrameSignal` is notified on every publication, so the
+   * consumer can sleep until a frame arrives instead of polling `acquire`.
+   */
+  class FrameExchange
+  {
+  public:
+    enum Mode
+    {
+      FRAME_EXCHANGE_MAILBOX,
+      FRAME_EXCHANGE_QUEUE,
+    };
+
+    struct Frame
+    {
+      cv::Mat image;
+      uint32_t timestamp; // libfreenect timestamp
+      uint64_t sequence;  // 1 based publication counter
+    };
+
+    static const size_t MAX_QUEUE_FRAMES = 16;
+
+    FrameExchange(void) : _mode(FRAME_EXCHANGE_MAILBOX), _back(0), _sequence(0), _signal(nullptr), _published(0), _dropped(0), _front(2), _holding(false) {}
+
+    /**
+     * \brief Allocate frames (call only while neither thread uses the exchange)
+     *
+     * \param[in] _queue_frames Frames in queue mode (3 - 16; mailbox uses 3)
+     */
+    void configure(Mode _new_mode, cv::Size _size, int _type, size_t _queue_frames = 4)
+    {
+      _mode = _new_mode;
+      size_t count = ((_mode == FRAME_EXCHANGE_MAILBOX) ? 3 : std::max<size_t>(3, std::min(_queue_frames, MAX_QUEUE_FRAMES)));
+      _frames.assign(count, Frame());
+      for (auto &frame : _frames)
+      {
+        frame.image.create(_size, _type);
+        frame.timestamp = 0;
+        frame.sequence = 0;
+      }
+
+      uint8_t index;
+      while (_filled.tryPop(index)) {}
+      while (_free.tryPop(index)) {}
+      _back = 0;
+      _front = 2;
+      _mailbox.reset(1);
+      if (_mode == FRAME_EXCHANGE_QUEUE)
+      {
+        for (size_t i = 1; i < count; ++i)
+        {
+          _free.tryPush(static_cast<uint8_t>(i));
+        }
+      }
+      _holding = false;
+      _sequence = 0;
+      _published.store(0, std::memory_order_relaxed);
+      _dropped.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Notify `_signal` of publications (nullptr: none; set while the
+     *        producer is idle)
+     */
+    void setSignal(FrameSignal *_new_signal)
+    {
+      _signal = _new_signal;
+    }
+
+    // ---- Producer ----
+
+    /**
+     * \brief The frame the producer is free to fill
+     */
+    Frame &back(void)
+    {
+      return _frames[_back];
+    }
+
+    /**
+     * \brief Hand the back frame to the consumer (wait-free)
+     *
+     * \return The frame's sequence number
+     */
+    uint64_t publish(uint32_t _timestamp)
+    {
+      uint64_t sequence = ++_sequence;
+      Frame &frame = _frames[_back];
+      frame.timestamp = _timestamp;
+      frame.sequence = sequence;
+
+      if (_mode == FRAME_EXCHANGE_MAILBOX)
+      {
+        bool overwritten;
+        _back = _mailbox.publish(_back, overwritten);
+        if (overwritten)
+        {
+          _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      else
+      {
+        uint8_t next;
+        if (!_free.tryPop(next))
+        {
+          // Consumer is behind; reuse the back frame
+          _dropped.fetch_add(1, std::memory_order_relaxed);
+          return sequence;
+        }
+        _filled.tryPush(static_cast<uint8_t>(_back));
+        _back = next;
+      }
+      _published.fetch_add(1, std::memory_order_relaxed);
+      if (_signal)
+      {
+        _signal->notify();
+      }
+      return sequence;
+    }
+
+    // ---- Consumer ----
+
+    /**
+     * \brief Take ownership of the next frame (wait-free)
+     *
+     * The previously acquired frame must be released first and may no longer
+     * be read.
+     *
+     * \return The newest (mailbox) or oldest (queue) unseen frame, or nullptr
+     */
+    const Frame *acquire(void)
+    {
+      if (_mode == FRAME_EXCHANGE_MAILBOX)
+      {
+        if (!_mailbox.fresh())
+        {
+          return nullptr;
+        }
+        _front = _mailbox.acquire(_front);
+        return &_frames[_front];
+      }
+      else
+      {
+        uint8_t index;
+        if (!_filled.tryPop(index))
+        {
+          return nullptr;
+        }
+        _front = index;
+        _holding = true;
+        return &_frames[_front];
+      }
+    }
+
+    /**
+     * \brief Return the acquired frame to the producer
+     */
+    void release(void)
+    {
+      if (_mode == FRAME_EXCHANGE_QUEUE && _holding)
+      {
+        _free.tryPush(static_cast<uint8_t>(_front));
+        _holding = false;
+      }
+    }
+
+    uint64_t published(void) const { return _published.load(std::memory_order_relaxed); }
+    uint64_t dropped(void) const { return _dropped.load(std::memory_order_relaxed); }
+    Mode mode(void) const { return _mode; }
+
+  private:
+    Mode _mode;
+    std::vector<Frame> _frames;
+
+    // Producer state
+    alignas(CACHE_LINE_BYTES) uint32_t _back;
+    uint64_t _sequence;
+    FrameSignal *_signal;
+    std::atomic<uint64_t> _published;
+    std::atomic<uint64_t> _dropped;
+
+    // Shared state (mailbox)
+    alignas(CACHE_LINE_BYTES) TripleBuffer _mailbox;
+
+    // Consumer state
+    alignas(CACHE_LINE_BYTES) uint32_t _front;
+    bool _holding;
+
+    // Queue mode: published frames and frames returned by the consumer
+    SpscRing<uint8_t, MAX_QUEUE_FRAMES> _filled;
+    SpscRing<uint8_t, MAX_QUEUE_FRAMES> _free;
+  };
+} // namespace zak
+
+#endif // ZAK_FRAME_EXCHANGE_HPP
@@ -0,0 +1,224 @@
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "frame_exchange.hpp"
+#include "options.hpp"
+
+/*
+ * Frame exchange stress test and contention benchmark
+ *
+ * A producer thread emulates the libfreenect event thread: it renders a frame
+ * (every byte equal to the low byte of the frame sequence) and then invokes
+ * the "callback", whose duration is measured. A consumer thread emulates the
+ * main loop: it takes the newest frame, converts it with `cv::cvtColor` and
+ * checks that the result is uniform; a non-uniform result is a torn frame.
+ *
+ * - mutex:   the historical design. libfreenect renders into its one internal
+ *            buffer, the callback takes `_rgb_mutex` to raise a flag, and the
+ *            consumer holds the mutex for the whole conversion.
+ * - mailbox: `zak::FrameExchange` latest-only triple buffer
+ * - queue:   `zak::FrameExchange` FIFO mode
+ *
+ * Usage: frame_exchange_bench [--frames=3000] [--rate=30 (0 = unthrottled)]
+ *            [--width=640] [--height=480]
+ * Exits non-zero if a `FrameExchange` mode tears or reorders frames.
+ */
+
+namespace
+{
+  struct Result
+  {
+    std::vector<double> callback_ns;
+    uint64_t consumed;
+    uint64_t dropped;
+    uint64_t torn;
+    uint64_t reordered;
+    double convert_ms;
+  };
+
+  typedef std::chrono::steady_clock Clock;
+
+  double nanoseconds(Clock::time_point _start, Clock::time_point _end)
+  {
+    return std::chrono::duration<double, std::nano>(_end - _start).count();
+  }
+
+  bool uniform(const cv::Mat &_image)
+  {
+    double min_value, max_value;
+    cv::minMaxLoc(_image.reshape(1), &min_value, &max_value);
+    return (min_value == max_value);
+  }
+
+  void pace(Clock::time_point _start, int _frame, double _rate)
+  {
+    if (_rate > 0)
+    {
+      std::this_thread::sleep_until(_start + std::chrono::microseconds(static_cast<int64_t>((_frame * 1e6) / _rate)));
+    }
+  }
+
+  Result runMutex(cv::Size _size, int _frames, double _rate)
+  {
+    Result result = Result();
+    std::mutex rgb_mutex;
+    bool rgb_frame_available = false;
+    std::atomic<bool> done(false);
+    cv::Mat live_rgb_feed(_size, CV_8UC3); // libfreenect's internal buffer
+
+    std::thread consumer([&]() {
+      cv::Mat bgr_image;
+      while (!done.load(std::memory_order_acquire))
+      {
+        bool converted = false;
+        Clock::time_point start = Clock::now();
+        {
+          std::lock_guard<std::mutex> rgb_lock(rgb_mutex);
+          if (rgb_frame_available)
+          {
+            cv::cvtColor(live_rgb_feed, bgr_image, cv::COLOR_RGB2BGR);
+            rgb_frame_available = false;
+            converted = true;
+          }
+        }
+        if (converted)
+        {
+          result.convert_ms += (nanoseconds(start, Clock::now()) / 1e6);
+          ++result.consumed;
+          result.torn += !uniform(bgr_image);
+        }
+        else
+        {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+    Clock::time_point start = Clock::now();
+    for (int frame = 1; frame <= _frames; ++frame)
+    {
+      pace(start, frame, _rate);
+      std::memset(live_rgb_feed.data, (frame & 0xFF), (live_rgb_feed.total() * live_rgb_feed.elemSize()));
+
+      Clock::time_point callback_start = Clock::now();
+      {
+        std::lock_guard<std::mutex> rgb_lock(rgb_mutex);
+        result.dropped += rgb_frame_available;
+        rgb_frame_available = true;
+      }
+      result.callback_ns.push_back(nanoseconds(callback_start, Clock::now()));
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    return result;
+  }
+
+  Result runExchange(zak::FrameExchange::Mode _mode, cv::Size _size, int _frames, double _rate)
+  {
+    Result result = Result();
+    zak::FrameExchange exchange;
+    exchange.configure(_mode, _size, CV_8UC3, 4);
+    std::atomic<bool> done(false);
+
+    std::thread consumer([&]() {
+      cv::Mat bgr_image;
+      uint64_t last_sequence = 0;
+      for (;;)
+      {
+        bool finished = done.load(std::memory_order_acquire);
+        const zak::FrameExchange::Frame *frame = exchange.acquire();
+        if (frame)
+        {
+          Clock::time_point start = Clock::now();
+          cv::cvtColor(frame->image, bgr_image, cv::COLOR_RGB2BGR);
+          result.convert_ms += (nanoseconds(start, Clock::now()) / 1e6);
+          result.reordered += (frame->sequence <= last_sequence);
+          result.torn += (!uniform(bgr_image) || (bgr_image.data[0] != (frame->sequence & 0xFF)));
+          last_sequence = frame->sequence;
+          exchange.release();
+          ++result.consumed;
+        }
+        else if (finished)
+        {
+          break;
+        }
+        else
+        {
+          std::this_thread::yield();
+        }
+      }
+    });
+
+    Clock::time_point start = Clock::now();
+    for (int frame = 1; frame <= _frames; ++frame)
+    {
+      pace(start, frame, _rate);
+      // libfreenect renders straight into the back frame (`freenect_set_video_buffer`)
+      cv::Mat &back = exchange.back().image;
+      std::memset(back.data, (frame & 0xFF), (back.total() * back.elemSize()));
+
+      Clock::time_point callback_start = Clock::now();
+      exchange.publish(0);
+      result.callback_ns.push_back(nanoseconds(callback_start, Clock::now()));
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    result.dropped = exchange.dropped();
+    return result;
+  }
+
+  void report(const std::string &_name, Result &_result, int _frames)
+  {
+    std::sort(_result.callback_ns.begin(), _result.callback_ns.end());
+    size_t count = _result.callback_ns.size();
+    std::cout << std::left << std::setw(8) << _name << std::right << std::fixed << std::setprecision(0)
+              << " callback p50 " << std::setw(7) << _result.callback_ns[count / 2] << " ns"
+              << "  p99 " << std::setw(7) << _result.callback_ns[(count * 99) / 100] << " ns"
+              << "  max " << std::setw(9) << _result.callback_ns[count - 1] << " ns"
+              << std::setprecision(2)
+              << " | consumed " << _result.consumed << "/" << _frames
+              << ", dropped " << _result.dropped
+              << ", torn " << _result.torn
+              << ", reordered " << _result.reordered
+              << ", convert " << (_result.consumed ? (_result.convert_ms / _result.consumed) : 0) << " ms/frame"
+              << std::endl;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  zak::Options options(argc, argv);
+  int frames = options.getInt("frames", 3000);
+  double rate = options.getDouble("rate", 30);
+  cv::Size size(options.getInt("width", 640), options.getInt("height", 480));
+
+  std::cout << frames << " frames of " << size.width << "x" << size.height << " RGB at " << (rate > 0 ? std::to_string(rate) + " Hz" : std::string("full speed")) << std::endl;
+
+  Result mutex_result = runMutex(size, frames, rate);
+  report("mutex", mutex_result, frames);
+  Result mailbox_result = runExchange(zak::FrameExchange::FRAME_EXCHANGE_MAILBOX, size, frames, rate);
+  report("mailbox", mailbox_result, frames);
+  Result queue_result = runExchange(zak::FrameExchange::FRAME_EXCHANGE_QUEUE, size, frames, rate);
+  report("queue", queue_result, frames);
+
+  // The mutex design is expected to tear (it never owned the buffer); the exchange must not
+  bool failed = (mailbox_result.torn || mailbox_result.reordered || queue_result.torn || queue_result.reordered);
+  if (failed)
+  {
+    std::cerr << "FAILED: frame exchange delivered torn or out of order frames" << std::endl;
+  }
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,401 @@
+#ifndef ZAK_FRAME_KERNELS_HPP
+#define ZAK_FRAME_KERNELS_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+/*
+ * Per-frame image kernels shared by `head_hunter` and the benchmarks
+ */
+
+namespace zak
+{
+  /**
+   * \brief Convert a libfreenect RGB video frame to OpenCV's BGR order
+   */
+  inline void convertVideoToBGR(const cv::Mat &_rgb_image, cv::Mat &_bgr_image)
+  {
+    cv::cvtColor(_rgb_image, _bgr_image, cv::COLOR_RGB2BGR);
+  }
+
+  /**
+   * \brief Demosaic a libfreenect Bayer video frame (GRBG) to BGR
+   *
+   * OpenCV names Bayer patterns by the second row, so the Kinect's GRBG
+   * sensor is `BayerGB`.
+   */
+  inline void convertBayerToBGR(const cv::Mat &_bayer_image, cv::Mat &_bgr_image)
+  {
+    cv::cvtColor(_bayer_image, _bgr_image, cv::COLOR_BayerGB2BGR);
+  }
+
+  /**
+   * \brief Demosaic a Bayer video frame straight to grayscale (full resolution)
+   */
+  inline void convertBayerToGray(const cv::Mat &_bayer_image, cv::Mat &_grayscale)
+  {
+    cv::cvtColor(_bayer_image, _grayscale, cv::COLOR_BayerGB2GRAY);
+  }
+
+  /**
+   * \brief Half resolution luma of a Bayer video frame
+   *
+   * Each 2x2 cell (G R / B G) is averaged into one pixel, (R + 2G + B) / 4: a
+   * luma close to BT.601's, read from the sensor data in one vectorized pass
+   * (`INTER_AREA` at exactly half size) without demosaicing.
+   */
+  inline void convertBayerToHalfLuma(const cv::Mat &_bayer_image, cv::Mat &_luma)
+  {
+    cv::resize(_bayer_image, _luma, cv::Size((_bayer_image.cols / 2), (_bayer_image.rows / 2)), 0, 0, cv::INTER_AREA);
+  }
+
+  /**
+   * \brief Sample an RGB frame through the Kinect's GRBG color filter
+   *        (simulated Bayer video)
+   */
+  inline void mosaicBayer(const cv::Mat &_rgb_image, cv::Mat &_bayer_image)
+  {
+    _bayer_image.create(_rgb_image.size(), CV_8UC1);
+    for (int r = 0; r < _rgb_image.rows; ++r)
+    {
+      const cv::Vec3b *rgb = _rgb_image.ptr<cv::Vec3b>(r);
+      uint8_t *bayer = _bayer_image.ptr<uint8_t>(r);
+      for (int c = 0; c < _rgb_image.cols; ++c)
+      {
+        // Even rows: G R G R ..., odd rows: B G B G ...
+        bayer[c] = rgb[c][((r & 1) ? ((c & 1) ? 1 : 2) : ((c & 1) ? 0 : 1))];
+      }
+    }
+  }
+
+  /**
+   * \brief Y plane of a libfreenect YUV video frame (UYVY, `CV_8UC2`)
+   *
+   * UYVY interleaves luma with chroma (U Y0 V Y1), so the Y plane cannot be a
+   * strided view; it is copied out of the second channel, with no arithmetic.
+   */
+  inline void extractUYVYLuma(const cv::Mat &_uyvy_image, cv::Mat &_luma)
+  {
+    cv::extractChannel(_uyvy_image, _luma, 1);
+  }
+
+  /**
+   * \brief Convert a YUV video frame (UYVY) to BGR
+   */
+  inline void convertUYVYToBGR(const cv::Mat &_uyvy_image, cv::Mat &_bgr_image)
+  {
+    cv::cvtColor(_uyvy_image, _bgr_image, cv::COLOR_YUV2BGR_UYVY);
+  }
+
+  /**
+   * \brief Render an 8-bit IR (or other grayscale) video frame in BGR
+   */
+  inline void convertGrayToBGR(const cv::Mat &_grayscale, cv::Mat &_bgr_image)
+  {
+    cv::cvtColor(_grayscale, _bgr_image, cv::COLOR_GRAY2BGR);
+  }
+
+  /**
+   * \brief Encode an RGB frame as UYVY with BT.601 coefficients, chroma
+   *        averaged over each pixel pair (simulated YUV video)
+   */
+  inline void packUYVY(const cv::Mat &_rgb_image, cv::Mat &_uyvy_image)
+  {
+    _uyvy_image.create(_rgb_image.size(), CV_8UC2);
+    for (int r = 0; r < _rgb_image.rows; ++r)
+    {
+      const cv::Vec3b *rgb = _rgb_image.ptr<cv::Vec3b>(r);
+      cv::Vec2b *uyvy = _uyvy_image.ptr<cv::Vec2b>(r);
+      for (int c = 0; (c + 1) < _rgb_image.cols; c += 2)
+      {
+        const cv::Vec3b &left = rgb[c];
+        const cv::Vec3b &right = rgb[c + 1];
+        int red = ((left[0] + right[0] + 1) / 2), green = ((left[1] + right[1] + 1) / 2), blue = ((left[2] + right[2] + 1) / 2);
+        uyvy[c][0] = static_cast<uint8_t>((((-38 * red) - (74 * green) + (112 * blue) + 128) >> 8) + 128);
+        uyvy[c][1] = static_cast<uint8_t>((((66 * left[0]) + (129 * left[1]) + (25 * left[2]) + 128) >> 8) + 16);
+        uyvy[c + 1][0] = static_cast<uint8_t>((((112 * red) - (94 * green) - (18 * blue) + 128) >> 8) + 128);
+        uyvy[c + 1][1] = static_cast<uint8_t>((((66 * right[0]) + (129 * right[1]) + (25 * right[2]) + 128) >> 8) + 16);
+      }
+    }
+  }
+
+  /**
+   * \brief Outline detected faces
+   */
+  inline void annotateFaces(cv::Mat &_bgr_image, const std::vector<cv::Rect> &_faces)
+  {
+    for (auto &face : _faces)
+    {
+      cv::rectangle(_bgr_image, face, cv::Scalar(0, 0, 255)); // Red line
+    }
+  }
+
+  /**
+   * \brief Label faces with their identities (empty names are skipped)
+   */
+  inline void annotateNames(cv::Mat &_bgr_image, const std::vector<cv::Rect> &_faces, const std::vector<std::string> &_names)
+  {
+    for (size_t i = 0; i < std::min(_faces.size(), _names.size()); ++i)
+    {
+      if (!_names[i].empty())
+      {
+        cv::putText(_bgr_image, _names[i], cv::Point(_faces[i].x, std::max((_faces[i].y - 4), 12)), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 255));
+      }
+    }
+  }
+
+  /**
+   * \brief Annotations of a frame, kept apart from its pixels
+   *
+   * Detection reads the frame buffer; annotations are composited onto a copy
+   * where the frame is shown, recorded or saved.
+   */
+  struct FrameOverlay
+  {
+    std::vector<cv::Rect> faces;    // frame pixels
+    std::vector<std::string> names; // identity of each face (empty: unknown)
+
+    void clear(void)
+    {
+      faces.clear();
+      names.clear();
+    }
+  };
+
+  /**
+   * \brief Draw an overlay onto an image `_scale` times the size of its frame
+   */
+  inline void drawOverlay(cv::Mat &_image, const FrameOverlay &_overlay, double _scale = 1.0)
+  {
+    if (_scale == 1.0)
+    {
+      annotateFaces(_image, _overlay.faces);
+      annotateNames(_image, _overlay.faces, _overlay.names);
+      return;
+    }
+    std::vector<cv::Rect> faces;
+    for (auto &face : _overlay.faces)
+    {
+      faces.push_back(cv::Rect(cvRound(face.x * _scale), cvRound(face.y * _scale), cvRound(face.width * _scale), cvRound(face.height * _scale)));
+    }
+    annotateFaces(_image, faces);
+    annotateNames(_image, faces, _overlay.names);
+  }
+
+  /**
+   * \brief Bytes of one row of packed 11-bit depth (`FREENECT_DEPTH_11BIT_PACKED`)
+   */
+  inline int packedDepthRowBytes(int _columns)
+  {
+    return ((_columns * 11) / 8);
+  }
+
+  /**
+   * \brief Unpack one group of 8 packed 11-bit depth values
+   *
+   * libfreenect packs depth most significant bit first, so 8 values fill
+   * exactly 11 bytes. The group is read as one 64-bit and one 24-bit
+   * big-endian word and every value is extracted with a fixed shift and mask,
+   * with none of the per-bit bookkeeping (and branches) of libfreenect's own
+   * unpacker; groups are independent, which leaves the compiler free to
+   * vectorize.
+   */
+  inline void unpackDepthGroup(const uint8_t *_packed, uint16_t *_depth)
+  {
+    uint64_t high = ((static_cast<uint64_t>(_packed[0]) << 56) | (static_cast<uint64_t>(_packed[1]) << 48) | (static_cast<uint64_t>(_packed[2]) << 40) | (static_cast<uint64_t>(_packed[3]) << 32) |
+                     (static_cast<uint64_t>(_packed[4]) << 24) | (static_cast<uint64_t>(_packed[5]) << 16) | (static_cast<uint64_t>(_packed[6]) << 8) | static_cast<uint64_t>(_packed[7]));
+    uint32_t low = ((static_cast<uint32_t>(_packed[8]) << 16) | (static_cast<uint32_t>(_packed[9]) << 8) | static_cast<uint32_t>(_packed[10]));
+    _depth[0] = static_cast<uint16_t>((high >> 53) & 0x7FF);
+    _depth[1] = static_cast<uint16_t>((high >> 42) & 0x7FF);
+    _depth[2] = static_cast<uint16_t>((high >> 31) & 0x7FF);
+    _depth[3] = static_cast<uint16_t>((high >> 20) & 0x7FF);
+    _depth[4] = static_cast<uint16_t>((high >> 9) & 0x7FF);
+    _depth[5] = static_cast<uint16_t>(((high & 0x1FF) << 2) | (low >> 22));
+    _depth[6] = static_cast<uint16_t>((low >> 11) & 0x7FF);
+    _depth[7] = static_cast<uint16_t>(low & 0x7FF);
+  }
+
+  /**
+   * \brief Unpack packed 11-bit depth (`CV_8UC1`, `packedDepthRowBytes` per
+   *        row) to 16-bit words (`CV_16UC1`); the width must be a multiple of 8
+   */
+  inline void unpackDepth(const cv::Mat &_packed, cv::Mat &_depth)
+  {
+    _depth.create(_packed.rows, ((_packed.cols * 8) / 11), CV_16UC1);
+    for (int r = 0; r < _packed.rows; ++r)
+    {
+      const uint8_t *packed = _packed.ptr<uint8_t>(r);
+      uint16_t *depth = _depth.ptr<uint16_t>(r);
+      for (int c = 0; c < _depth.cols; c += 8, packed += 11)
+      {
+        unpackDepthGroup(packed, (depth + c));
+      }
+    }
+  }
+
+  /**
+   * \brief Pack 11-bit depth as libfreenect does (simulated packed depth)
+   */
+  inline void packDepth(const cv::Mat &_depth, cv::Mat &_packed)
+  {
+    _packed.create(_depth.rows, packedDepthRowBytes(_depth.cols), CV_8UC1);
+    for (int r = 0; r < _depth.rows; ++r)
+    {
+      const uint16_t *depth = _depth.ptr<uint16_t>(r);
+      uint8_t *packed = _packed.ptr<uint8_t>(r);
+      uint32_t buffer = 0;
+      int bits = 0;
+      for (int c = 0; c < _depth.cols; ++c)
+      {
+        buffer = ((buffer << 11) | (depth[c] & 0x7FF));
+        bits += 11;
+        while (bits >= 8)
+        {
+          bits -= 8;
+          *packed++ = static_cast<uint8_t>(buffer >> bits);
+        }
+      }
+    }
+  }
+
+  /**
+   * \brief Renders 11-bit Kinect depth as a heat map
+   *
+   * Every depth value maps to one color, so the colors are computed once
+   * into a 2048 entry palette and colorizing is a table lookup per pixel.
+   */
+  class DepthColorizer
+  {
+  public:
+    DepthColorizer(void)
+    {
+      static const size_t B(0), G(1), R(2);
+
+      // Load the gamma array with color values to represent 11-bit
+      // (2^11 or 0 - 2047) depth data capture by the Microsoft Kinect
+      // (enables later heat map visualization)
+      for (unsigned int i = 0; i < 2048; ++i)
+      {
+        float v = i / 2048.0f;
+        v = std::pow(v, 3) * 6;
+        uint16_t heat_value = v * 6 * 256;
+        uint8_t fine_heat = static_cast<uint8_t>(heat_value & 0xFF);
+        uint8_t coarse_heat = static_cast<uint8_t>(heat_value >> 8);
+        cv::Vec3b &color = _palette[i];
+
+        // Examine the pval with the low byte removed
+        switch (coarse_heat)
+        {
+        // white fading to red
+        case 0:
+          color[B] = (255 - fine_heat);
+          color[G] = (255 - fine_heat);
+          color[R] = 255;
+          break;
+        // red fading to yellow
+        case 1:
+          color[B] = 0;
+          color[G] = fine_heat;
+          color[R] = 255;
+          break;
+        // yellow fading to green
+        case 2:
+          color[B] = 0;
+          color[G] = 255;
+          color[R] = (255 - fine_heat);
+          break;
+        // green fading to cyan
+        case 3:
+          color[B] = fine_heat;
+          color[G] = 255;
+          color[R] = 0;
+          break;
+        // cyan fading to blue
+        case 4:
+          color[B] = 255;
+          color[G] = (255 - fine_heat);
+          color[R] = 0;
+          break;
+        // blue fading to magenta
+        case 5:
+          color[B] = 255;
+          color[G] = 0;
+          color[R] = fine_heat;
+          break;
+        // magenta fading to black
+        case 6:
+          color[B] = (255 - fine_heat);
+          color[G] = 0;
+          color[R] = (255 - fine_heat);
+          break;
+        // uncategorized values are rendered gray
+        default:
+          color[B] = 128;
+          color[G] = 128;
+          color[R] = 128;
+          break;
+        }
+      }
+    }
+
+    /**
+     * \brief Colorize a depth frame
+     *
+     * \param[in] _depth 11-bit depth (CV_16UC1)
+     * \param[out] _heat_map BGR heat map of the same size (CV_8UC3)
+     */
+    void colorize(const cv::Mat &_depth, cv::Mat &_heat_map) const
+    {
+      _heat_map.create(_depth.size(), CV_8UC3);
+      for (int r = 0; r < _depth.rows; ++r)
+      {
+        const uint16_t *depth = _depth.ptr<uint16_t>(r);
+        cv::Vec3b *heat_map = _heat_map.ptr<cv::Vec3b>(r);
+        for (int c = 0; c < _depth.cols; ++c)
+        {
+          heat_map[c] = _palette[depth[c] & 0x7FF];
+        }
+      }
+    }
+
+    /**
+     * \brief Colorize a packed depth frame, unpacking on the fly
+     *
+     * Each group of 8 values is unpacked into registers and colorized at
+     * once, so the 16-bit frame is never written or read back.
+     *
+     * \param[in] _packed Packed 11-bit depth (see `unpackDepth`)
+     * \param[out] _heat_map BGR heat map of the unpacked size (CV_8UC3)
+     */
+    void colorizePacked(const cv::Mat &_packed, cv::Mat &_heat_map) const
+    {
+      _heat_map.create(_packed.rows, ((_packed.cols * 8) / 11), CV_8UC3);
+      uint16_t depth[8];
+      for (int r = 0; r < _packed.rows; ++r)
+      {
+        const uint8_t *packed = _packed.ptr<uint8_t>(r);
+        cv::Vec3b *heat_map = _heat_map.ptr<cv::Vec3b>(r);
+        for (int c = 0; c < _heat_map.cols; c += 8, packed += 11)
+        {
+          unpackDepthGroup(packed, depth);
+          for (int i = 0; i < 8; ++i)
+          {
+            heat_map[c + i] = _palette[depth[i]];
+          }
+        }
+      }
+    }
+
+  private:
+    cv::Vec3b _palette[2048];
+  };
+} // namespace zak
+
+#endif // ZAK_FRAME_KERNELS_HPP
@@ -0,0 +1,105 @@
+#ifndef ZAK_FRAME_SIGNAL_HPP
+#define ZAK_FRAME_SIGNAL_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace zak
+{
+  /**
+   * \brief Wakes the consumer of a `FrameExchange` when a frame is published
+   *
+   * The consumer used to poll for frames every few milliseconds, which at
+   * 15 Hz (YUV video) or 10 Hz (HIGH resolution) mostly found nothing. The
+   * signal is an eventfd: `notify` adds to its counter with one non-blocking
+   * write, so publishing stays wait-free, and the consumer sleeps in `wait`
+   * (or in its own `select`/`poll` on `fd`, e.g. together with stdin) until a
+   * frame arrives or a timeout expires.
+   *
+   * The consumer `clear`s the signal before it acquires frames, so a frame
+   * published in between wakes the next `wait` at once instead of being
+   * missed. A spurious wake-up only costs an empty `acquire`.
+   */
+  class FrameSignal
+  {
+  public:
+    FrameSignal(void) : _fd(eventfd(0, (EFD_NONBLOCK | EFD_CLOEXEC)))
+    {
+      if (_fd < 0)
+      {
+        perror("eventfd()");
+      }
+    }
+
+    ~FrameSignal(void)
+    {
+      if (_fd >= 0)
+      {
+        close(_fd);
+      }
+    }
+
+    FrameSignal(const FrameSignal &) = delete;
+    FrameSignal &operator=(const FrameSignal &) = delete;
+
+    /**
+     * \brief Readable while a frame is pending (-1 without eventfd support)
+     */
+    int fd(void) const { return _fd; }
+
+    /**
+     * \brief Signal a published frame (producer; never blocks)
+     */
+    void notify(void)
+    {
+      uint64_t one = 1;
+      if (_fd >= 0 && ::write(_fd, &one, sizeof(one)) < 0)
+      {
+        // EAGAIN: the counter is saturated, so the consumer wakes anyway
+      }
+    }
+
+    /**
+     * \brief Sleep until a frame is signaled or `_timeout_ms` expires
+     *
+     * Without eventfd support this degrades to a short sleep (polling).
+     *
+     * \return true when a frame was signaled
+     */
+    bool wait(int _timeout_ms)
+    {
+      if (_fd < 0)
+      {
+        usleep(std::min(_timeout_ms, 5) * 1000);
+        return false;
+      }
+      struct pollfd descriptor;
+      descriptor.fd = _fd;
+      descriptor.events = POLLIN;
+      descriptor.revents = 0;
+      return (poll(&descriptor, 1, _timeout_ms) > 0);
+    }
+
+    /**
+     * \brief Reset the signal (consumer; before acquiring frames)
+     */
+    void clear(void)
+    {
+      uint64_t count;
+      if (_fd >= 0 && ::read(_fd, &count, sizeof(count)) < 0)
+      {
+        // EAGAIN: nothing was pending
+      }
+    }
+
+  private:
+    int _fd;
+  };
+} // namespace zak
+
+#endif // ZAK_FRAME_SIGNAL_HPP
@@ -0,0 +1,183 @@
+#ifndef ZAK_FREENECT_EVENT_LOOP_HPP
+#define ZAK_FREENECT_EVENT_LOOP_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <sys/time.h>
+#include <thread>
+
+// 3rd Party Libraries
+#include <libfreenect.hpp>
+
+// Local Libraries
+#include "event_loop_stats.hpp"
+#include "trace.hpp"
+
+namespace zak
+{
+  static const int FREENECT_EVENTS_INTERRUPTED = -10; // LIBUSB_ERROR_INTERRUPTED
+
+  /**
+   * \brief libfreenect context whose event loop `head_hunter` owns
+   *
+   * A drop-in replacement for `Freenect::Freenect` (`createDevice`,
+   * `deleteDevice`, `deviceCount`). `Freenect::Freenect` spins
+   * `freenect_process_events` on a private thread that cannot be tuned or
+   * observed; this loop waits at most `timeout_ms` per iteration with
+   * `freenect_process_events_timeout`, which bounds shutdown latency, and
+   * between iterations:
+   *
+   * - refreshes the tilt state every `tilt_poll_ms` (the control transfer
+   *   `glview` issues every 2000 iterations, at a fixed period instead)
+   * - counts USB errors and stops after `max_consecutive_errors` failures in
+   *   a row (e.g. when the Kinect is unplugged) rather than throwing
+   * - times every iteration
+   *
+   * Shutdown stops the loop before devices are deleted, so no callback can
+   * run on a device being destroyed.
+   */
+  class FreenectEventLoop
+  {
+  public:
+    FreenectEventLoop(void) : _context(nullptr), _stop(false), _timeout_ms(EventLoopConfig().timeout_ms), _tilt_poll_ms(EventLoopConfig().tilt_poll_ms), _max_consecutive_errors(EventLoopConfig().max_consecutive_errors)
+    {
+      if (freenect_init(&_context, nullptr) < 0)
+      {
+        throw std::runtime_error("Cannot initialize freenect library");
+      }
+      // Claim the motor (tilt, LED, accelerometer) and the camera
+      freenect_select_subdevices(_context, static_cast<freenect_device_flags>(FREENECT_DEVICE_MOTOR | FREENECT_DEVICE_CAMERA));
+      _thread = std::thread(&FreenectEventLoop::run, this);
+    }
+
+    ~FreenectEventLoop()
+    {
+      _stop.store(true, std::memory_order_release);
+      _thread.join();
+      for (auto &device : _devices)
+      {
+        delete device.second;
+      }
+      freenect_shutdown(_context);
+    }
+
+    /**
+     * \brief Apply loop tuning (takes effect on the next iteration)
+     */
+    void configure(const EventLoopConfig &_config)
+    {
+      _timeout_ms.store(std::max(1, _config.timeout_ms), std::memory_order_relaxed);
+      _tilt_poll_ms.store(_config.tilt_poll_ms, std::memory_order_relaxed);
+      _max_consecutive_errors.store(std::max(1, _config.max_consecutive_errors), std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Loop counters (see `EventLoopMeter::snapshot`)
+     */
+    EventLoopStats stats(bool _reset)
+    {
+      return _meter.snapshot(_reset);
+    }
+
+    template <typename ConcreteDevice>
+    ConcreteDevice &createDevice(int _index)
+    {
+      ConcreteDevice *device = new ConcreteDevice(_context, _index);
+      std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+      Freenect::FreenectDevice *&slot = _devices[_index];
+      delete slot;
+      slot = device;
+      return *device;
+    }
+
+    void deleteDevice(int _index)
+    {
+      std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+      std::map<int, Freenect::FreenectDevice *>::iterator it = _devices.find(_index);
+      if (it != _devices.end())
+      {
+        delete it->second;
+        _devices.erase(it);
+      }
+    }
+
+    int deviceCount(void)
+    {
+      std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+      return static_cast<int>(_devices.size());
+    }
+
+  private:
+    freenect_context *_context;
+    std::atomic<bool> _stop;
+    std::atomic<int> _timeout_ms;
+    std::atomic<int> _tilt_poll_ms;
+    std::atomic<int> _max_consecutive_errors;
+    std::mutex _devices_mutex;
+    std::map<int, Freenect::FreenectDevice *> _devices;
+    EventLoopMeter _meter;
+    std::thread _thread;
+
+    void run(void)
+    {
+      int consecutive_errors = 0;
+      std::chrono::steady_clock::time_point next_tilt_poll = std::chrono::steady_clock::now();
+      while (!_stop.load(std::memory_order_acquire))
+      {
+        int timeout_ms = _timeout_ms.load(std::memory_order_relaxed);
+        struct timeval timeout;
+        timeout.tv_sec = (timeout_ms / 1000);
+        timeout.tv_usec = ((timeout_ms % 1000) * 1000);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int result = freenect_process_events_timeout(_context, &timeout);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        _meter.iteration(std::chrono::duration<double, std::milli>(now - start).count(), ((result == FREENECT_EVENTS_INTERRUPTED) ? 0 : result));
+
+        if (result < 0 && result != FREENECT_EVENTS_INTERRUPTED)
+        {
+          if (++consecutive_errors >= _max_consecutive_errors.load(std::memory_order_relaxed))
+          {
+            std::cerr << "libfreenect event processing failed " << consecutive_errors << " times in a row (error " << result << "); stopping the event loop" << std::endl;
+            _meter.fail();
+            break;
+          }
+          continue;
+        }
+        consecutive_errors = 0;
+
+        int tilt_poll_ms = _tilt_poll_ms.load(std::memory_order_relaxed);
+        if (tilt_poll_ms > 0 && now >= next_tilt_poll)
+        {
+          next_tilt_poll = (now + std::chrono::milliseconds(tilt_poll_ms));
+          pollTilt();
+        }
+      }
+    }
+
+    /**
+     * \brief Refresh the first device's tilt state (a USB control transfer)
+     */
+    void pollTilt(void)
+    {
+      std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+      if (_devices.empty())
+      {
+        return;
+      }
+      Freenect::FreenectDevice *device = _devices.begin()->second;
+      TraceSpan span("tilt poll");
+      device->updateState();
+      Freenect::FreenectTiltState state = device->getState();
+      _meter.tilt(state.getTiltDegs(), state.m_code);
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_FREENECT_EVENT_LOOP_HPP
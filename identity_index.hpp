@@ -0,0 +1,496 @@
+#ifndef ZAK_IDENTITY_INDEX_HPP
+#define ZAK_IDENTITY_INDEX_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace zak
+{
+  /**
+   * \brief Inner product of two embeddings
+   *
+   * Eight independent partial sums let the compiler keep one vector register
+   * of products per step (NEON on the Raspberry Pi, SSE/AVX on x86) without
+   * reassociating a single floating point sum, which it may not do on its
+   * own.
+   */
+  inline float dotProduct(const float *_a, const float *_b, int _dimensions)
+  {
+    float sums[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    int i = 0;
+    for (; (i + 8) <= _dimensions; i += 8)
+    {
+      for (int lane = 0; lane < 8; ++lane)
+      {
+        sums[lane] += (_a[i + lane] * _b[i + lane]);
+      }
+    }
+    for (; i < _dimensions; ++i)
+    {
+      sums[0] += (_a[i] * _b[i]);
+    }
+    return (((sums[0] + sums[4]) + (sums[1] + sums[5])) + ((sums[2] + sums[6]) + (sums[3] + sums[7])));
+  }
+
+  /**
+   * \brief Nearest-neighbour index of enrolled face embeddings
+   *
+   * Embeddings are L2-normalized, so the nearest neighbour is the entry with
+   * the largest inner product (cosine similarity). Each entry belongs to an
+   * identity (a name); a person is usually enrolled with several entries.
+   *
+   * Small galleries are searched exhaustively. Once `build` sees at least
+   * `ivf_threshold` entries it clusters them into about sqrt(n) inverted
+   * lists (spherical k-means), and a search only scans the `probes` lists
+   * whose centroids are nearest the query: a few hundred inner products
+   * instead of one per entry. Entries added after `build` are kept in an
+   * unindexed tail that is always scanned, until the next `build`.
+   *
+   * `save` writes the index in its in-memory layout and `open` maps that file
+   * read-only, so loading a large gallery costs no parsing or copying and the
+   * pages are shared between processes. Adding to a mapped index copies it
+   * into memory first. File layout (host byte order):
+   *
+   *     64 byte header (magic "ZKID", version, dimensions, entries, lists,
+   *     indexed entries, identities, name bytes) | f32 centroids[lists][dim] |
+   *     u32 list offsets[lists + 1] | f32 entries[entries][dim] |
+   *     u32 identity of each entry[entries] | NUL-terminated names
+   */
+  class IdentityIndex
+  {
+  public:
+    /**
+     * \brief Best entry of a search
+     */
+    struct Match
+    {
+      int entry;         // -1 when the index is empty
+      uint32_t identity; // index into the names
+      float similarity;  // cosine similarity (-1 to 1)
+    };
+
+    IdentityIndex(void) : _dimensions(0), _count(0), _lists(0), _indexed(0), _vectors(nullptr), _labels(nullptr), _centroids(nullptr), _offsets(nullptr), _mapping(nullptr), _mapping_bytes(0), ivf_threshold(1024), probes(4), iterations(10)
+    {
+      _own_offsets.assign(1, 0);
+      attach();
+    }
+
+    ~IdentityIndex(void)
+    {
+      unmap();
+    }
+
+    IdentityIndex(const IdentityIndex &) = delete;
+    IdentityIndex &operator=(const IdentityIndex &) = delete;
+
+    /**
+     * \brief Enroll an embedding (normalized here) under a name
+     *
+     * \return 0 on success, -1 on a dimension mismatch
+     */
+    int add(const float *_embedding, int _embedding_dimensions, const std::string &_name)
+    {
+      if (_embedding_dimensions <= 0 || (_count && _embedding_dimensions != _dimensions))
+      {
+        std::cerr << "Embedding has " << _embedding_dimensions << " dimensions, the index " << _dimensions << std::endl;
+        return -1;
+      }
+      detach();
+      _dimensions = _embedding_dimensions;
+      uint32_t identity = static_cast<uint32_t>(std::find(_names.begin(), _names.end(), _name) - _names.begin());
+      if (identity == _names.size())
+      {
+        _names.push_back(_name);
+      }
+
+      float norm = std::sqrt(dotProduct(_embedding, _embedding, _dimensions));
+      for (int i = 0; i < _dimensions; ++i)
+      {
+        _own_vectors.push_back((norm > 0) ? (_embedding[i] / norm) : 0);
+      }
+      _own_labels.push_back(identity);
+      ++_count;
+      attach();
+      return 0;
+    }
+
+    /**
+     * \brief Rebuild the inverted lists over every entry (or drop them below
+     *        `ivf_threshold` entries)
+     */
+    void build(void)
+    {
+      detach();
+      _own_centroids.clear();
+      _own_offsets.assign(1, 0);
+      _lists = 0;
+      _indexed = 0;
+      if (_count >= ivf_threshold && _count > 1)
+      {
+        cluster();
+      }
+      attach();
+    }
+
+    /**
+     * \brief Find the enrolled entry most similar to an embedding (normalized)
+     *
+     * \param[in] _embedding_dimensions Length of `_embedding`
+     * \return false when the index is empty or has other dimensions (e.g.
+     *         it was enrolled with another embedding model)
+     */
+    bool search(const float *_embedding, int _embedding_dimensions, Match &_match) const
+    {
+      _match.entry = -1;
+      _match.identity = 0;
+      _match.similarity = -2;
+      if (!_count || _embedding_dimensions != _dimensions)
+      {
+        return false;
+      }
+
+      if (_lists)
+      {
+        // Nearest centroids first (`probes` is small; partial selection)
+        std::vector<std::pair<float, uint32_t> > &nearest = _probe_scratch;
+        nearest.resize(_lists);
+        for (uint32_t list = 0; list < _lists; ++list)
+        {
+          nearest[list] = std::make_pair(-dotProduct(_embedding, (_centroids + (static_cast<size_t>(list) * _dimensions)), _dimensions), list);
+        }
+        uint32_t probe_count = std::min(static_cast<uint32_t>(std::max(probes, 1)), _lists);
+        std::partial_sort(nearest.begin(), (nearest.begin() + probe_count), nearest.end());
+        for (uint32_t i = 0; i < probe_count; ++i)
+        {
+          uint32_t list = nearest[i].second;
+          scan(_embedding, _offsets[list], _offsets[list + 1], _match);
+        }
+      }
+      scan(_embedding, _indexed, _count, _match);
+      _match.identity = _labels[_match.entry];
+      return true;
+    }
+
+    /**
+     * \brief Write the index (0 on success, -1 on failure)
+     */
+    int save(const std::string &_path) const
+    {
+      std::string temporary = (_path + ".tmp");
+      FILE *file = fopen(temporary.c_str(), "wb");
+      if (!file)
+      {
+        perror(temporary.c_str());
+        return -1;
+      }
+      std::string names;
+      for (auto &name : _names)
+      {
+        names.append(name.c_str(), (name.size() + 1));
+      }
+      names.resize(((names.size() + 3) / 4) * 4, '\0');
+
+      uint32_t header[HEADER_WORDS] = {MAGIC, VERSION, static_cast<uint32_t>(_dimensions), _count, _lists, _indexed, static_cast<uint32_t>(_names.size()), static_cast<uint32_t>(names.size())};
+      bool written = (fwrite(header, sizeof(header), 1, file) == 1);
+      written = (written && write(file, _centroids, (static_cast<size_t>(_lists) * _dimensions * sizeof(float))));
+      written = (written && write(file, _offsets, ((_lists + 1) * sizeof(uint32_t))));
+      written = (written && write(file, _vectors, (static_cast<size_t>(_count) * _dimensions * sizeof(float))));
+      written = (written && write(file, _labels, (_count * sizeof(uint32_t))));
+      written = (written && write(file, names.data(), names.size()));
+      if ((fclose(file) != 0) || !written || rename(temporary.c_str(), _path.c_str()))
+      {
+        perror(_path.c_str());
+        unlink(temporary.c_str());
+        return -1;
+      }
+      return 0;
+    }
+
+    /**
+     * \brief Map an index written by `save` (0 on success, -1 on failure)
+     */
+    int open(const std::string &_path)
+    {
+      int fd = ::open(_path.c_str(), (O_RDONLY | O_CLOEXEC));
+      struct stat status;
+      if (fd < 0 || fstat(fd, &status))
+      {
+        perror(_path.c_str());
+        if (fd >= 0)
+        {
+          ::close(fd);
+        }
+        return -1;
+      }
+      size_t bytes = static_cast<size_t>(status.st_size);
+      void *mapping = ((bytes >= sizeof(uint32_t) * HEADER_WORDS) ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED);
+      ::close(fd);
+      if (mapping == MAP_FAILED)
+      {
+        std::cerr << "Cannot map identity index " << _path << std::endl;
+        return -1;
+      }
+
+      const uint32_t *header = static_cast<const uint32_t *>(mapping);
+      uint64_t dimensions = header[2], count = header[3], lists = header[4], names_bytes = header[7];
+      uint64_t expected = ((sizeof(uint32_t) * HEADER_WORDS) + (4 * ((lists * dimensions) + (lists + 1) + (count * dimensions) + count)) + names_bytes);
+      if (header[0] != MAGIC || header[1] != VERSION || expected != bytes || header[5] > count)
+      {
+        std::cerr << "Not an identity index: " << _path << std::endl;
+        munmap(mapping, bytes);
+        return -1;
+      }
+
+      unmap();
+      _mapping = mapping;
+      _mapping_bytes = bytes;
+      _dimensions = static_cast<int>(dimensions);
+      _count = static_cast<uint32_t>(count);
+      _lists = static_cast<uint32_t>(lists);
+      _indexed = header[5];
+      const uint8_t *next = (static_cast<const uint8_t *>(mapping) + (sizeof(uint32_t) * HEADER_WORDS));
+      _centroids = reinterpret_cast<const float *>(next);
+      next += (4 * lists * dimensions);
+      _offsets = reinterpret_cast<const uint32_t *>(next);
+      next += (4 * (lists + 1));
+      _vectors = reinterpret_cast<const float *>(next);
+      next += (4 * count * dimensions);
+      _labels = reinterpret_cast<const uint32_t *>(next);
+      next += (4 * count);
+
+      _names.clear();
+      const char *names = reinterpret_cast<const char *>(next);
+      for (uint32_t i = 0, offset = 0; i < header[6] && offset < names_bytes; ++i)
+      {
+        _names.push_back(std::string(names + offset, strnlen((names + offset), (names_bytes - offset))));
+        offset += static_cast<uint32_t>(_names.back().size() + 1);
+      }
+      bool valid = (_offsets[0] == 0 && _offsets[_lists] == _indexed);
+      for (uint32_t list = 0; list < _lists; ++list)
+      {
+        valid = (valid && _offsets[list] <= _offsets[list + 1]);
+      }
+      for (uint32_t entry = 0; entry < _count; ++entry)
+      {
+        valid = (valid && _labels[entry] < _names.size());
+      }
+      if (!valid)
+      {
+        std::cerr << "Corrupt identity index: " << _path << std::endl;
+        clear();
+        return -1;
+      }
+      return 0;
+    }
+
+    /**
+     * \brief Forget every entry (and unmap the file)
+     */
+    void clear(void)
+    {
+      unmap();
+      _own_vectors.clear();
+      _own_labels.clear();
+      _own_centroids.clear();
+      _own_offsets.assign(1, 0);
+      _names.clear();
+      _dimensions = 0;
+      _count = _lists = _indexed = 0;
+      attach();
+    }
+
+    const std::string &name(uint32_t _identity) const { return _names[_identity]; }
+
+    int dimensions(void) const { return _dimensions; }
+    uint32_t size(void) const { return _count; }
+    uint32_t identities(void) const { return static_cast<uint32_t>(_names.size()); }
+    uint32_t lists(void) const { return _lists; }
+    bool mapped(void) const { return (_mapping != nullptr); }
+
+  private:
+    static const uint32_t MAGIC = 0x44494B5A; // "ZKID"
+    static const uint32_t VERSION = 1;
+    static const size_t HEADER_WORDS = 16; // 64 bytes
+
+    int _dimensions;
+    uint32_t _count;
+    uint32_t _lists;
+    uint32_t _indexed; // entries in the lists; the rest is the unindexed tail
+
+    // Views of the entries, in `_own_*` or in the mapped file
+    const float *_vectors;
+    const uint32_t *_labels;
+    const float *_centroids;
+    const uint32_t *_offsets;
+
+    std::vector<float> _own_vectors;
+    std::vector<uint32_t> _own_labels;
+    std::vector<float> _own_centroids;
+    std::vector<uint32_t> _own_offsets;
+    std::vector<std::string> _names;
+    void *_mapping;
+    size_t _mapping_bytes;
+    mutable std::vector<std::pair<float, uint32_t> > _probe_scratch;
+
+    void scan(const float *_embedding, uint32_t _begin, uint32_t _end, Match &_match) const
+    {
+      for (uint32_t entry = _begin; entry < _end; ++entry)
+      {
+        float similarity = dotProduct(_embedding, (_vectors + (static_cast<size_t>(entry) * _dimensions)), _dimensions);
+        if (similarity > _match.similarity)
+        {
+          _match.similarity = similarity;
+          _match.entry = static_cast<int>(entry);
+        }
+      }
+    }
+
+    /**
+     * \brief Spherical k-means over every entry, then regroup the entries by list
+     */
+    void cluster(void)
+    {
+      uint32_t lists = std::max<uint32_t>(1, static_cast<uint32_t>(std::sqrt(static_cast<double>(_count))));
+      size_t dimensions = static_cast<size_t>(_dimensions);
+
+      // Evenly spaced entries seed the centroids (deterministic)
+      _own_centroids.resize(lists * dimensions);
+      for (uint32_t list = 0; list < lists; ++list)
+      {
+        std::copy((_own_vectors.begin() + (((static_cast<size_t>(list) * _count) / lists) * dimensions)), (_own_vectors.begin() + ((((static_cast<size_t>(list) * _count) / lists) + 1) * dimensions)), (_own_centroids.begin() + (list * dimensions)));
+      }
+
+      std::vector<uint32_t> assignment(_count, 0);
+      std::vector<double> sums(lists * dimensions);
+      for (int iteration = 0; iteration < iterations; ++iteration)
+      {
+        for (uint32_t entry = 0; entry < _count; ++entry)
+        {
+          const float *vector = &_own_vectors[entry * dimensions];
+          float best = -2;
+          for (uint32_t list = 0; list < lists; ++list)
+          {
+            float similarity = dotProduct(vector, &_own_centroids[list * dimensions], _dimensions);
+            if (similarity > best)
+            {
+              best = similarity;
+              assignment[entry] = list;
+            }
+          }
+        }
+        std::fill(sums.begin(), sums.end(), 0.0);
+        for (uint32_t entry = 0; entry < _count; ++entry)
+        {
+          for (size_t i = 0; i < dimensions; ++i)
+          {
+            sums[(assignment[entry] * dimensions) + i] += _own_vectors[(entry * dimensions) + i];
+          }
+        }
+        for (uint32_t list = 0; list < lists; ++list)
+        {
+          double norm = 0;
+          for (size_t i = 0; i < dimensions; ++i)
+          {
+            norm += (sums[(list * dimensions) + i] * sums[(list * dimensions) + i]);
+          }
+          if (norm > 0) // An empty list keeps its centroid
+          {
+            norm = std::sqrt(norm);
+            for (size_t i = 0; i < dimensions; ++i)
+            {
+              _own_centroids[(list * dimensions) + i] = static_cast<float>(sums[(list * dimensions) + i] / norm);
+            }
+          }
+        }
+      }
+
+      // Store the entries list by list (stable, so enrollment order is kept within a list)
+      std::vector<uint32_t> order(_count);
+      for (uint32_t entry = 0; entry < _count; ++entry)
+      {
+        order[entry] = entry;
+      }
+      std::stable_sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b) { return (assignment[_a] < assignment[_b]); });
+      std::vector<float> vectors(_own_vectors.size());
+      std::vector<uint32_t> labels(_count);
+      _own_offsets.assign((lists + 1), 0);
+      for (uint32_t i = 0; i < _count; ++i)
+      {
+        std::copy((_own_vectors.begin() + (order[i] * dimensions)), (_own_vectors.begin() + ((order[i] + 1) * dimensions)), (vectors.begin() + (i * dimensions)));
+        labels[i] = _own_labels[order[i]];
+        ++_own_offsets[assignment[order[i]] + 1];
+      }
+      for (uint32_t list = 0; list < lists; ++list)
+      {
+        _own_offsets[list + 1] += _own_offsets[list];
+      }
+      _own_vectors.swap(vectors);
+      _own_labels.swap(labels);
+      _lists = lists;
+      _indexed = _count;
+    }
+
+    /**
+     * \brief Copy a mapped index into memory (before it changes)
+     */
+    void detach(void)
+    {
+      if (!_mapping)
+      {
+        return;
+      }
+      _own_vectors.assign(_vectors, (_vectors + (static_cast<size_t>(_count) * _dimensions)));
+      _own_labels.assign(_labels, (_labels + _count));
+      _own_centroids.assign(_centroids, (_centroids + (static_cast<size_t>(_lists) * _dimensions)));
+      _own_offsets.assign(_offsets, (_offsets + _lists + 1));
+      munmap(_mapping, _mapping_bytes);
+      _mapping = nullptr;
+      _mapping_bytes = 0;
+    }
+
+    /**
+     * \brief Point the views at the in-memory entries
+     */
+    void attach(void)
+    {
+      _vectors = _own_vectors.data();
+      _labels = _own_labels.data();
+      _centroids = _own_centroids.data();
+      _offsets = _own_offsets.data();
+    }
+
+    void unmap(void)
+    {
+      if (_mapping)
+      {
+        munmap(_mapping, _mapping_bytes);
+        _mapping = nullptr;
+        _mapping_bytes = 0;
+      }
+    }
+
+    static bool write(FILE *_file, const void *_data, size_t _bytes)
+    {
+      return (!_bytes || fwrite(_data, 1, _bytes, _file) == _bytes);
+    }
+
+  public:
+    uint32_t ivf_threshold; // entries from which `build` creates inverted lists
+    int probes;             // inverted lists scanned per search
+    int iterations;         // k-means iterations of `build`
+  };
+} // namespace zak
+
+#endif // ZAK_IDENTITY_INDEX_HPP
@@ -1,7 +1,11 @@
 // C/C++ Libraries
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <mutex>
 #include <sys/select.h>
 #include <termios.h>
 #include <vector>
@@ -11,6 +15,34 @@
 #include <libfreenect.hpp>
 #include <opencv2/opencv.hpp>
 
+// Local Libraries
+#include "cascade_loader.hpp"
+#include "day_night_switch.hpp"
+#include "depth_recorder.hpp"
+#include "detection_stream.hpp"
+#include "display_thread.hpp"
+#include "face_detector.hpp"
+#include "face_embedder.hpp"
+#include "face_identifier.hpp"
+#include "face_tracker.hpp"
+#include "frame_exchange.hpp"
+#include "frame_kernels.hpp"
+#include "frame_signal.hpp"
+#include "frame_bus.hpp"
+#include "frame_dedup.hpp"
+#include "freenect_event_loop.hpp"
+#include "identity_index.hpp"
+#include "kinect_simulator.hpp"
+#include "multi_cascade_detector.hpp"
+#include "options.hpp"
+#include "people_counter.hpp"
+#include "phase_timer.hpp"
+#include "quality_controller.hpp"
+#include "recording_sink.hpp"
+#include "roi_detector.hpp"
+#include "thread_placement.hpp"
+#include "trace.hpp"
+
 namespace zak
 {
   /**
@@ -20,9 +52,11 @@ namespace zak
    * cv::Window object to capture the input; enabling headless input.
    *
    * \param[in] time_out_ms Time out value in milliseconds
+   * \param[in] wake_fd Also return (with 0) when this descriptor becomes
+   *                    readable, e.g. a `FrameSignal` (-1: none)
    * \return Key stroke recorded from user input
    */
-  int waitKey(int time_out_ms)
+  int waitKey(int time_out_ms, int wake_fd = -1)
   {
     struct termios original_termios, raw_termios;
     struct timeval tv;
@@ -38,13 +72,17 @@ namespace zak
     // Watch stdin (fd 0) to see when it has input.
     FD_ZERO(&rfds);
     FD_SET(STDIN_FILENO, &rfds);
+    if (wake_fd >= 0)
+    {
+      FD_SET(wake_fd, &rfds);
+    }
 
-    // Wait up to five milliseconds.
-    tv.tv_sec = 0;
-    tv.tv_usec = (time_out_ms * 1000);
+    // Wait up to the timeout.
+    tv.tv_sec = (time_out_ms / 1000);
+    tv.tv_usec = ((time_out_ms % 1000) * 1000);
 
     // Await user input until user specified timeout
-    result = select(1, &rfds, NULL, NULL, &tv);
+    result = select((std::max(STDIN_FILENO, wake_fd) + 1), &rfds, NULL, NULL, &tv);
     // Cannot rely on the value of tv now!
 
     // Prepare result
@@ -53,9 +91,8 @@ namespace zak
       perror("select()");
       result = 27;
     }
-    else if (result)
+    else if (result && FD_ISSET(STDIN_FILENO, &rfds))
     {
-      /* FD_ISSET(stdin, &rfds) will be true. */
       result = getchar();
     }
     else
@@ -68,45 +105,113 @@ namespace zak
 
     return result;
   }
+
+  /**
+   * \brief Hand libfreenect the buffer for the next frame
+   */
+  inline void setVideoBuffer(Freenect::FreenectDevice &_device, void *_buffer)
+  {
+    freenect_set_video_buffer(const_cast<freenect_device *>(_device.getDevice()), _buffer);
+  }
+
+  inline void setDepthBuffer(Freenect::FreenectDevice &_device, void *_buffer)
+  {
+    freenect_set_depth_buffer(const_cast<freenect_device *>(_device.getDevice()), _buffer);
+  }
+
+  inline void setVideoBuffer(SimulatedKinect &_device, void *_buffer)
+  {
+    _device.setVideoBuffer(_buffer);
+  }
+
+  inline void setDepthBuffer(SimulatedKinect &_device, void *_buffer)
+  {
+    _device.setDepthBuffer(_buffer);
+  }
+
+  /**
+   * \brief Set the IR projector brightness (1 - 50)
+   */
+  inline int setIRBrightness(Freenect::FreenectDevice &_device, int _brightness)
+  {
+    return freenect_set_ir_brightness(const_cast<freenect_device *>(_device.getDevice()), static_cast<uint16_t>(_brightness));
+  }
+
+  inline int setIRBrightness(SimulatedKinect &_device, int _brightness)
+  {
+    return _device.setIRBrightness(_brightness);
+  }
+
+  /**
+   * \brief Apply `--simulate-*` options (real devices take none)
+   */
+  inline int configureDevice(Freenect::FreenectDevice &, const Options &)
+  {
+    return 0;
+  }
+
+  inline int configureDevice(SimulatedKinect &_device, const Options &_options)
+  {
+    SimulatorConfig config;
+    std::string source = _options.get("simulate", "1");
+    config.video_source = ((source == "1") ? "" : source);
+    config.depth_source = _options.get("simulate-depth", "");
+    config.ir_source = _options.get("simulate-ir", "");
+    config.ambient = _options.getDouble("simulate-ambient", config.ambient);
+    config.fps = _options.getDouble("simulate-fps", config.fps);
+    config.jitter_ms = _options.getDouble("simulate-jitter-ms", config.jitter_ms);
+    config.drop_rate = _options.getDouble("simulate-drop", config.drop_rate);
+    return _device.simulate(config);
+  }
 } // namespace zak
 
-class MicrosoftKinect : public Freenect::FreenectDevice
+/**
+ * \brief `head_hunter`'s view of the Kinect
+ *
+ * `Device` is `Freenect::FreenectDevice` for hardware (driven by
+ * `zak::FreenectEventLoop`) or `zak::SimulatedKinect` to run without a Kinect
+ * attached (driven by `zak::SimulatedFreenect`).
+ */
+template <typename Device>
+class MicrosoftKinect : public Device
 {
 public:
   MicrosoftKinect(
       freenect_context *_ctx,
-      int _index) : Freenect::FreenectDevice(_ctx, _index),
-                    _rgb_frame_available(false),
-                    _depth_frame_available(false)
+      int _index) : Device(_ctx, _index),
+                    _capture_format(FREENECT_VIDEO_RGB),
+                    _depth_capture_format(FREENECT_DEPTH_11BIT),
+                    _exchange_mode(zak::FrameExchange::FRAME_EXCHANGE_MAILBOX),
+                    _exchange_queue_frames(4),
+                    _thread_registry(nullptr),
+                    _capture_fifo_priority(0),
+                    _capture_placed(false),
+                    _video_sequence(0),
+                    _depth_sequence(0)
   {
+    _video_exchange.setSignal(&_frame_signal);
+    _depth_exchange.setSignal(&_frame_signal);
     setVideoResolution(FREENECT_RESOLUTION_MEDIUM);
-
-    // Load the gamma array with color values to represent 11-bit
-    // (2^11 or 0 - 2047) depth data capture by the Microsoft Kinect
-    // (enables later heat map visualization)
-    for (unsigned int i = 0; i < 2048; ++i)
-    {
-      float v = i / 2048.0f;
-      v = std::pow(v, 3) * 6;
-      _gamma[i] = v * 6 * 256;
-    }
-    setLed(LED_GREEN);
-    setTiltDegrees(0);
+    this->setLed(LED_GREEN);
+    this->setTiltDegrees(0);
   }
 
   virtual ~MicrosoftKinect() override
   {
-    setTiltDegrees(0);
-    setLed(LED_OFF);
+    this->setTiltDegrees(0);
+    this->setLed(LED_OFF);
   }
 
   bool getBGRVideo(cv::Mat &bgr_image)
   {
-    std::lock_guard<std::mutex> rgb_lock(_rgb_mutex);
-    if (_rgb_frame_available)
+    // Conversion runs on a frame owned by this thread (no lock is held)
+    const zak::FrameExchange::Frame *frame = _video_exchange.acquire();
+    if (frame)
     {
-      cv::cvtColor(_live_rgb_feed, bgr_image, cv::COLOR_RGB2BGR);
-      _rgb_frame_available = false;
+      zak::TraceSpan span("convert video", frame->sequence);
+      _video_sequence = frame->sequence;
+      zak::convertVideoToBGR(frame->image, bgr_image);
+      _video_exchange.release();
       return true;
     }
     else
@@ -115,80 +220,97 @@ public:
     }
   }
 
-  bool getDepthHeatMap(cv::Mat &heat_map)
+  /**
+   * \brief Copy the latest video frame as captured (Bayer GRBG `CV_8UC1`,
+   *        YUV UYVY `CV_8UC2` or 8-bit IR `CV_8UC1`; raw capture formats only)
+   *
+   * IR frames have 8 more rows than the window at MEDIUM resolution; they
+   * are cropped so every consumer sees one video frame size.
+   */
+  bool getRawVideo(cv::Mat &raw_image)
   {
-    std::lock_guard<std::mutex> depth_lock(_depth_mutex);
+    const zak::FrameExchange::Frame *frame = _video_exchange.acquire();
+    if (frame)
+    {
+      zak::TraceSpan span("copy video", frame->sequence);
+      _video_sequence = frame->sequence;
+      frame->image(cv::Rect(cv::Point(0, 0), _video_size)).copyTo(raw_image);
+      _video_exchange.release();
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
 
-    static const size_t B(0), G(1), R(2);
-    if (_depth_frame_available)
+  /**
+   * \brief Colorize the latest depth frame
+   *
+   * \param[out] raw_depth 11-bit depth in 16-bit words for other consumers
+   *                       (nullptr: not needed; packed depth is then never
+   *                       unpacked, only colorized on the fly)
+   */
+  bool getDepthHeatMap(cv::Mat &heat_map, cv::Mat *raw_depth = nullptr)
+  {
+    // Colorization runs on a frame owned by this thread (no lock is held)
+    const zak::FrameExchange::Frame *frame = _depth_exchange.acquire();
+    if (frame)
     {
-      // Loop through depth array data
-      for (int r = 0; r < _live_depth_feed.rows; ++r)
+      zak::TraceSpan span("depth heat map", frame->sequence);
+      _depth_sequence = frame->sequence;
+      const cv::Mat &depth = frame->image;
+      if (_depth_capture_format == FREENECT_DEPTH_11BIT_PACKED)
       {
-        for (int c = 0; c < _live_depth_feed.cols; ++c)
+        if (raw_depth)
         {
-          auto depth_value = _live_depth_feed.at<uint16_t>(r, c);
+          zak::unpackDepth(depth, *raw_depth);
+          _depth_colorizer.colorize(*raw_depth, heat_map);
+        }
+        else
+        {
+          _depth_colorizer.colorizePacked(depth, heat_map);
+        }
+        _depth_exchange.release();
+        return true;
+      }
+
+      // Preserve the 11-bit depth values for other consumers
+      if (raw_depth)
+      {
+        depth.copyTo(*raw_depth);
+      }
 
-          // Map the depth value to _gamma values
-          uint16_t heat_value = _gamma[depth_value];
-          uint8_t fine_heat = static_cast<uint8_t>(heat_value & 0xFF);
-          uint8_t coarse_heat = static_cast<uint8_t>(heat_value >> 8);
+      _depth_colorizer.colorize(depth, heat_map);
+      _depth_exchange.release();
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
 
-          // Examine the pval with the low byte removed
-          switch (coarse_heat)
-          {
-          // white fading to red
-          case 0:
-            heat_map.at<cv::Vec3b>(r, c)[B] = (255 - fine_heat);
-            heat_map.at<cv::Vec3b>(r, c)[G] = (255 - fine_heat);
-            heat_map.at<cv::Vec3b>(r, c)[R] = 255;
-            break;
-          // red fading to yellow
-          case 1:
-            heat_map.at<cv::Vec3b>(r, c)[B] = 0;
-            heat_map.at<cv::Vec3b>(r, c)[G] = fine_heat;
-            heat_map.at<cv::Vec3b>(r, c)[R] = 255;
-            break;
-          // yellow fading to green
-          case 2:
-            heat_map.at<cv::Vec3b>(r, c)[B] = 0;
-            heat_map.at<cv::Vec3b>(r, c)[G] = 255;
-            heat_map.at<cv::Vec3b>(r, c)[R] = (255 - fine_heat);
-            break;
-          // green fading to cyan
-          case 3:
-            heat_map.at<cv::Vec3b>(r, c)[B] = fine_heat;
-            heat_map.at<cv::Vec3b>(r, c)[G] = 255;
-            heat_map.at<cv::Vec3b>(r, c)[R] = 0;
-            break;
-          // cyan fading to blue
-          case 4:
-            heat_map.at<cv::Vec3b>(r, c)[B] = 255;
-            heat_map.at<cv::Vec3b>(r, c)[G] = (255 - fine_heat);
-            heat_map.at<cv::Vec3b>(r, c)[R] = 0;
-            break;
-          // blue fading to magenta
-          case 5:
-            heat_map.at<cv::Vec3b>(r, c)[B] = 255;
-            heat_map.at<cv::Vec3b>(r, c)[G] = 0;
-            heat_map.at<cv::Vec3b>(r, c)[R] = fine_heat;
-            break;
-          // magenta fading to black
-          case 6:
-            heat_map.at<cv::Vec3b>(r, c)[B] = (255 - fine_heat);
-            heat_map.at<cv::Vec3b>(r, c)[G] = 0;
-            heat_map.at<cv::Vec3b>(r, c)[R] = (255 - fine_heat);
-            break;
-          // uncategorized values are rendered gray
-          default:
-            heat_map.at<cv::Vec3b>(r, c)[B] = 128;
-            heat_map.at<cv::Vec3b>(r, c)[G] = 128;
-            heat_map.at<cv::Vec3b>(r, c)[R] = 128;
-            break;
-          }
-        }
+  /**
+   * \brief Copy the latest depth frame as 11-bit depth in 16-bit words,
+   *        without colorizing it (for consumers that never display it)
+   */
+  bool getRawDepth(cv::Mat &raw_depth)
+  {
+    const zak::FrameExchange::Frame *frame = _depth_exchange.acquire();
+    if (frame)
+    {
+      zak::TraceSpan span("copy depth", frame->sequence);
+      _depth_sequence = frame->sequence;
+      if (_depth_capture_format == FREENECT_DEPTH_11BIT_PACKED)
+      {
+        zak::unpackDepth(frame->image, raw_depth);
+      }
+      else
+      {
+        frame->image.copyTo(raw_depth);
       }
-      _depth_frame_available = false;
+      _depth_exchange.release();
       return true;
     }
     else
@@ -197,42 +319,246 @@ public:
     }
   }
 
-  int getWindowColumnAndRowCount(int &_cols, int &_rows)
+  /**
+   * \brief Capture sequence number of the last video or depth frame acquired
+   *        (gaps are frames the consumer never saw)
+   */
+  uint64_t videoSequence(void) const { return _video_sequence; }
+  uint64_t depthSequence(void) const { return _depth_sequence; }
+
+  /**
+   * \brief Tilt the Kinect (a USB control transfer, traced as an actuator
+   *        command)
+   */
+  void setTiltDegrees(double _degrees)
   {
-    // Check resolution and create image canvas
-    return videoResolutionToColumnsAndRows(getVideoResolution(), _cols, _rows);
+    zak::TraceSpan span("set tilt");
+    Device::setTiltDegrees(_degrees);
   }
 
-private:
-  uint16_t _gamma[2048];
-  std::mutex _rgb_mutex;
-  std::mutex _depth_mutex;
-  bool _rgb_frame_available;
-  bool _depth_frame_available;
-  cv::Mat _live_depth_feed;
-  cv::Mat _live_rgb_feed;
+  /**
+   * \brief Set the LED (a USB control transfer, traced as an actuator command)
+   */
+  void setLed(freenect_led_options _option)
+  {
+    zak::TraceSpan span("set led");
+    Device::setLed(_option);
+  }
 
+  /**
+   * \brief Select how frames are handed from the libfreenect thread
+   *
+   * Must be called while video and depth are stopped.
+   *
+   * \param[in] _mode Latest frame only (mailbox) or every frame (queue)
+   * \param[in] _queue_frames Frames buffered in queue mode
+   */
+  int setFrameExchange(zak::FrameExchange::Mode _mode, size_t _queue_frames)
+  {
+    _exchange_mode = _mode;
+    _exchange_queue_frames = _queue_frames;
+    return setVideoResolution(this->getVideoResolution());
+  }
+
+  /**
+   * \brief Place the libfreenect event thread (applied from its first callback)
+   *
+   * Must be called while video and depth are stopped.
+   *
+   * \param[in] _registry Registers the thread (for reports)
+   * \param[in] _cpus CPUs the thread may run on (empty: unchanged)
+   * \param[in] _fifo_priority SCHED_FIFO priority (0: unchanged)
+   */
+  void setCaptureThreadPlacement(zak::ThreadRegistry *_registry, const std::vector<int> &_cpus, int _fifo_priority)
+  {
+    _thread_registry = _registry;
+    _capture_cpus = _cpus;
+    _capture_fifo_priority = _fifo_priority;
+  }
+
+  /**
+   * \brief Notified whenever a video or depth frame is published
+   */
+  zak::FrameSignal &frameSignal(void) { return _frame_signal; }
+
+  /**
+   * \brief Frame arrival intervals (callback to callback)
+   */
+  zak::IntervalMeter &videoIntervals(void) { return _video_intervals; }
+  zak::IntervalMeter &depthIntervals(void) { return _depth_intervals; }
+
+  /**
+   * \brief Capture RGB (demosaiced by libfreenect), raw Bayer, YUV or IR video
+   *
+   * YUV (UYVY, `FREENECT_VIDEO_YUV_RAW`) is only available at MEDIUM
+   * resolution and arrives at 15 Hz; 8-bit IR (`FREENECT_VIDEO_IR_8BIT`) is
+   * not available at LOW resolution.
+   *
+   * Must be called while video and depth are stopped (it may be called
+   * between streams, e.g. to switch between color and IR).
+   */
+  int setVideoCaptureFormat(freenect_video_format _format)
+  {
+    if (_format != FREENECT_VIDEO_RGB && _format != FREENECT_VIDEO_BAYER && _format != FREENECT_VIDEO_YUV_RAW && _format != FREENECT_VIDEO_IR_8BIT)
+    {
+      std::cerr << "Unsupported video capture format (" << _format << ")" << std::endl;
+      return -1;
+    }
+    if (!videoModeAvailable(this->getVideoResolution(), _format))
+    {
+      return -1;
+    }
+    _capture_format = _format;
+    return setVideoResolution(this->getVideoResolution());
+  }
+
+  freenect_video_format getVideoCaptureFormat(void) const
+  {
+    return _capture_format;
+  }
+
+  /**
+   * \brief Capture depth unpacked to 16-bit words by libfreenect
+   *        (`FREENECT_DEPTH_11BIT`) or packed (`FREENECT_DEPTH_11BIT_PACKED`)
+   *
+   * Packed depth skips the unpacking libfreenect otherwise does on its event
+   * thread and moves 11 bits per pixel instead of 16; `getDepthHeatMap`
+   * unpacks (or colorizes straight from the packed data) on the caller's
+   * thread.
+   *
+   * Must be called while video and depth are stopped.
+   */
+  int setDepthCaptureFormat(freenect_depth_format _format)
+  {
+    if (_format != FREENECT_DEPTH_11BIT && _format != FREENECT_DEPTH_11BIT_PACKED)
+    {
+      std::cerr << "Unsupported depth capture format (" << _format << ")" << std::endl;
+      return -1;
+    }
+    _depth_capture_format = _format;
+    return setVideoResolution(this->getVideoResolution());
+  }
+
+  freenect_depth_format getDepthCaptureFormat(void) const
+  {
+    return _depth_capture_format;
+  }
+
+  /**
+   * \brief Set the IR projector brightness (1 - 50; lights IR video)
+   */
+  int setIRBrightness(int _brightness)
+  {
+    if (_brightness < 1 || _brightness > 50 || zak::setIRBrightness(*this, _brightness) < 0)
+    {
+      std::cerr << "Cannot set IR brightness " << _brightness << " (1 - 50)" << std::endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  uint64_t getVideoFramesDropped(void) const
+  {
+    return _video_exchange.dropped();
+  }
+
+  uint64_t getDepthFramesDropped(void) const
+  {
+    return _depth_exchange.dropped();
+  }
+
+  /**
+   * \brief Select the video resolution (depth is only available at MEDIUM)
+   *
+   * Must be called while video and depth are stopped.
+   */
   int setVideoResolution(freenect_resolution _resolution)
   {
     int result;
-    int cols, rows;
+    int cols, rows, depth_cols, depth_rows;
 
-    setVideoFormat(FREENECT_VIDEO_RGB, _resolution);
-    setDepthFormat(FREENECT_DEPTH_11BIT, _resolution);
-    if ((result = videoResolutionToColumnsAndRows(_resolution, cols, rows)))
+    if (!videoModeAvailable(_resolution, _capture_format))
+    {
+      return -1;
+    }
+    this->setVideoFormat(_capture_format, _resolution);
+    this->setDepthFormat(_depth_capture_format, FREENECT_RESOLUTION_MEDIUM);
+    if ((result = videoResolutionToColumnsAndRows(_resolution, cols, rows)) || (result = getDepthColumnAndRowCount(depth_cols, depth_rows)))
     {
       // forward error and exit
     }
     else
     {
-      _live_depth_feed = cv::Mat(cv::Size(cols, rows), CV_16UC1);
-      _live_rgb_feed = cv::Mat(cv::Size(cols, rows), CV_8UC3, cv::Scalar(0));
+      _video_size = cv::Size(cols, rows);
+      if (_capture_format == FREENECT_VIDEO_IR_8BIT && _resolution == FREENECT_RESOLUTION_MEDIUM)
+      {
+        rows = 488;
+      }
+      if (_depth_capture_format == FREENECT_DEPTH_11BIT_PACKED)
+      {
+        _depth_exchange.configure(_exchange_mode, cv::Size(zak::packedDepthRowBytes(depth_cols), depth_rows), CV_8UC1, _exchange_queue_frames);
+      }
+      else
+      {
+        _depth_exchange.configure(_exchange_mode, cv::Size(depth_cols, depth_rows), CV_16UC1, _exchange_queue_frames);
+      }
+      _video_exchange.configure(_exchange_mode, cv::Size(cols, rows), videoFrameType(_capture_format), _exchange_queue_frames);
+
+      // The previous buffers were released; the next stream fills the new ones
+      zak::setVideoBuffer(*this, _video_exchange.back().image.data);
+      zak::setDepthBuffer(*this, _depth_exchange.back().image.data);
     }
 
     return result;
   }
 
-  int videoResolutionToColumnsAndRows(
+  /**
+   * \brief OpenCV type of a video frame in a capture format
+   */
+  static int videoFrameType(freenect_video_format _format)
+  {
+    switch (_format)
+    {
+    case FREENECT_VIDEO_BAYER:
+    case FREENECT_VIDEO_IR_8BIT:
+      return CV_8UC1;
+    case FREENECT_VIDEO_YUV_RAW:
+      return CV_8UC2;
+    default:
+      return CV_8UC3;
+    }
+  }
+
+  /**
+   * \brief Whether libfreenect offers a capture format at a resolution
+   */
+  static bool videoModeAvailable(freenect_resolution _resolution, freenect_video_format _format)
+  {
+    if (_format == FREENECT_VIDEO_YUV_RAW && _resolution != FREENECT_RESOLUTION_MEDIUM)
+    {
+      std::cerr << "YUV video is only available at medium resolution" << std::endl;
+      return false;
+    }
+    if (_format == FREENECT_VIDEO_IR_8BIT && _resolution == FREENECT_RESOLUTION_LOW)
+    {
+      std::cerr << "IR video is not available at low resolution" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  int getDepthColumnAndRowCount(int &_cols, int &_rows)
+  {
+    return videoResolutionToColumnsAndRows(FREENECT_RESOLUTION_MEDIUM, _cols, _rows);
+  }
+
+  int getWindowColumnAndRowCount(int &_cols, int &_rows)
+  {
+    // Check resolution and create image canvas
+    return videoResolutionToColumnsAndRows(this->getVideoResolution(), _cols, _rows);
+  }
+
+  static int videoResolutionToColumnsAndRows(
       freenect_resolution _resolution,
       int &_cols,
       int &_rows)
@@ -264,17 +590,60 @@ private:
     return result;
   }
 
+private:
+  zak::DepthColorizer _depth_colorizer;
+  freenect_video_format _capture_format;
+  freenect_depth_format _depth_capture_format;
+  cv::Size _video_size;
+  zak::FrameExchange::Mode _exchange_mode;
+  size_t _exchange_queue_frames;
+  zak::FrameSignal _frame_signal;
+  zak::FrameExchange _video_exchange;
+  zak::FrameExchange _depth_exchange;
+  zak::ThreadRegistry *_thread_registry;
+  std::vector<int> _capture_cpus;
+  int _capture_fifo_priority;
+  std::atomic<bool> _capture_placed;
+  zak::IntervalMeter _video_intervals;
+  zak::IntervalMeter _depth_intervals;
+  uint64_t _video_sequence; // consumer side
+  uint64_t _depth_sequence; // consumer side
+
+  /**
+   * \brief Place (and name for traces) the calling (libfreenect event)
+   *        thread once
+   */
+  void placeCaptureThread(void)
+  {
+    if (!_capture_placed.exchange(true))
+    {
+      zak::tracer().nameThread("capture");
+      if (_thread_registry)
+      {
+        _thread_registry->placeCurrent("capture", _capture_cpus, _capture_fifo_priority);
+      }
+    }
+  }
+
   // Do not call directly (even in child)
   virtual void VideoCallback(
       void *_rgb,
       uint32_t timestamp) override
   {
-    (void)timestamp;
-    std::lock_guard<std::mutex> rgb_lock(_rgb_mutex);
+    placeCaptureThread();
+    zak::TraceSpan span("video callback");
+    _video_intervals.tick();
+    cv::Mat &back = _video_exchange.back().image;
 
-    // Load data into CV compatible `Mat` (matrix) object
-    _live_rgb_feed.data = static_cast<uint8_t *>(_rgb);
-    _rgb_frame_available = true;
+    // libfreenect delivers into its own buffer until ours is installed
+    if (_rgb != back.data)
+    {
+      std::memcpy(back.data, _rgb, (back.total() * back.elemSize()));
+    }
+    span.setSequence(_video_exchange.publish(timestamp));
+
+    // Have libfreenect write the next frame straight into the new back frame
+    zak::setVideoBuffer(*this, _video_exchange.back().image.data);
   };
 
   // Do not call directly (even in child)
@@ -282,53 +651,393 @@ private:
       void *_depth,
       uint32_t timestamp) override
   {
-    (void)timestamp;
-    std::lock_guard<std::mutex> depth_lock(_depth_mutex);
+    placeCaptureThread();
+    zak::TraceSpan span("depth callback");
+    _depth_intervals.tick();
+    cv::Mat &back = _depth_exchange.back().image;
 
-    // Load data into CV compatible `Mat` (matrix) object
-    _live_depth_feed.data = static_cast<uint8_t *>(_depth);
-    _depth_frame_available = true;
+    // libfreenect delivers into its own buffer until ours is installed
+    if (_depth != back.data)
+    {
+      std::memcpy(back.data, _depth, (back.total() * back.elemSize()));
+    }
+    span.setSequence(_depth_exchange.publish(timestamp));
+
+    // Have libfreenect write the next frame straight into the new back frame
+    zak::setDepthBuffer(*this, _depth_exchange.back().image.data);
   }
 };
 
-int main(int argc, char **argv)
+/**
+ * \brief Run `head_hunter` on a Kinect from `Context`
+ *
+ * \param[in] _options Command line options
+ * \return Process exit code
+ */
+template <typename Context, typename Device>
+int headHunter(const zak::Options &options)
 {
+  zak::PhaseTimer startup;
+  bool startup_reported(false);
+
+  // Messages go to stderr when detection events take stdout (`--events=-` or a bare `--events`)
+  std::string events_target = options.get("events", "-");
+  events_target = ((events_target == "1") ? "-" : events_target);
+  std::ostream &console = ((options.has("events") && events_target == "-") ? std::cerr : console);
+
   // Parse headless parameter (default: false)
   bool headless = false;
-  if (argc > 1)
+  if (!options.positional().empty())
   {
-    headless = std::stoi(argv[1]);
+    headless = std::stoi(options.positional()[0]);
   }
 
-  // Loop control variables
+  // Loop control variables (`--duration=<seconds>` quits unattended runs)
   bool quit(false);
   int key_value(-1);
+  double duration_s = options.getDouble("duration", 0);
+  int64 run_start = cv::getTickCount();
 
   // Windowing variables
   bool enable_facial_recognition = false, enable_depth_heat_map = false;
-  int window_columns, window_rows;
+  int window_columns, window_rows, depth_columns, depth_rows;
+  freenect_resolution video_resolution = FREENECT_RESOLUTION_MEDIUM;
+  if (options.get("resolution", "medium") == "low")
+  {
+    video_resolution = FREENECT_RESOLUTION_LOW;
+  }
+  else if (options.get("resolution", "medium") == "high")
+  {
+    video_resolution = FREENECT_RESOLUTION_HIGH;
+  }
+
+  // Thread placement variables (`--cpu-capture`, `--cpu-detect` and `--cpu-workers` take CPU lists such as "0,2-3")
+  zak::ThreadRegistry threads;
+  std::vector<int> capture_cpus, detect_cpus, worker_cpus;
+  if (zak::parseCpuList(options.get("cpu-capture", ""), capture_cpus) || zak::parseCpuList(options.get("cpu-detect", ""), detect_cpus) || zak::parseCpuList(options.get("cpu-workers", ""), worker_cpus))
+  {
+    std::cerr << "Invalid CPU list (expected e.g. 0,2-3)" << std::endl;
+    exit(1);
+  }
+  bool report_threads = (options.has("cpu-capture") || options.has("cpu-detect") || options.has("cpu-workers") || options.has("capture-fifo") || options.getBool("stats", false));
+
+  // Placed before OpenCV starts its worker pool, which inherits the detection CPUs
+  threads.placeCurrent("detect", detect_cpus);
+  if (!detect_cpus.empty())
+  {
+    cv::setNumThreads(static_cast<int>(detect_cpus.size()));
+  }
+
+  // Trace variables (`--trace[=<prefix>]` records spans of every stage; [t] or SIGUSR1 saves them as `<prefix>-<N>.json`)
+  std::string trace_prefix = options.get("trace", "");
+  trace_prefix = ((trace_prefix == "1") ? "trace" : trace_prefix);
+  int trace_count(0);
+  if (!trace_prefix.empty())
+  {
+    // Enabled before the capture and display threads start
+    zak::tracer().enable(static_cast<size_t>(std::max(1024, options.getInt("trace-events", 16384))));
+    zak::tracer().nameThread("detect");
+    signal(SIGUSR1, [](int) { zak::tracer().requestDump(); });
+  }
+  auto dump_trace = [&]() {
+    std::ostringstream file;
+    file << trace_prefix << "-" << trace_count << ".json";
+    long spans = zak::tracer().dump(file.str());
+    if (spans >= 0)
+    {
+      console << "Saved trace " << file.str() << " (" << spans << " spans)" << std::endl;
+      ++trace_count;
+    }
+  };
 
   // Screen shot variables
   char filename[] = "screenshot";
   char suffix[] = ".png";
   int snap_count(0);
+  std::string depth_snapshot_format = options.get("depth-snapshot", ""); // raw depth beside depth mode screenshots: "zkd" (lossless codec) or "png" (16-bit)
+  if (!depth_snapshot_format.empty() && depth_snapshot_format != "zkd" && depth_snapshot_format != "png")
+  {
+    std::cerr << "Unknown depth snapshot format " << depth_snapshot_format << " (expected zkd or png)" << std::endl;
+    exit(1);
+  }
+
+  // Facial recognition variables (prepared before the Kinect starts)
+  cv::CascadeClassifier face_detection;
+  zak::FaceDetector face_detector(face_detection);
+  zak::FrameCache frame_cache; // Preprocessing shared by every detection pass on a frame
+  std::vector<cv::Rect> faces;
+  int tilt_dead_band = 38; // pixels of a 480 row video frame (25 at the historical 1.5 image scale)
+
+  // Two-level detection (`--roi`: coarse pass, then full resolution crops; meant for `--resolution=high`)
+  zak::RoiDetector roi_detector(face_detection);
+  bool roi_detection = options.getBool("roi", false);
+
+  // Near-duplicate frames reuse the previous detections (`--dedup`)
+  zak::FrameDeduplicator frame_dedup(options.getDouble("dedup-threshold", 6), options.getInt("dedup-max-reuse", 15));
+  bool deduplicate = options.getBool("dedup", false);
 
-  // Microsoft Kinect variables
+  // Detection quality variables (`--target-fps` or `--target-latency-ms` enable adaptation)
+  double detect_budget_ms = options.getDouble("target-latency-ms", 0);
+  if (options.has("target-fps"))
+  {
+    // Leave a quarter of the frame period for capture, conversion and display
+    detect_budget_ms = (750.0 / options.getDouble("target-fps", 30));
+  }
+  zak::QualityController quality(detect_budget_ms, options.getInt("quality", 1));
+  std::string cascade_path = options.get("cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_frontalface_alt2.xml");
+  std::string cascade_cache_path = options.get("cascade-cache", zak::cascadeCachePath(cascade_path));
+  bool cascade_from_cache;
+  if (zak::loadCascade(face_detection, cascade_path, cascade_cache_path, cascade_from_cache))
+  {
+    exit(1);
+  }
+
+  // Additional cascades (`--cascades=frontal[,profile][,mirrored-profile][,eyes]`)
+  zak::MultiCascadeDetector multi_cascade(face_detection);
+  std::string cascade_set = ("," + options.get("cascades", "frontal") + ",");
+  std::string profile_path = options.get("profile-cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_profileface.xml");
+  std::string eye_path = options.get("eye-cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_eye.xml");
+  if ((cascade_set.find(",profile,") != std::string::npos && multi_cascade.addProfile(profile_path, zak::cascadeCachePath(profile_path), zak::MultiCascadeDetector::PASS_PROFILE)) ||
+      (cascade_set.find(",mirrored-profile,") != std::string::npos && multi_cascade.addProfile(profile_path, zak::cascadeCachePath(profile_path), zak::MultiCascadeDetector::PASS_MIRRORED_PROFILE)) ||
+      (cascade_set.find(",eyes,") != std::string::npos && multi_cascade.setEyeVerification(eye_path, zak::cascadeCachePath(eye_path))))
+  {
+    exit(1);
+  }
+  bool multi_cascade_detection = (multi_cascade.passes() > 1 || multi_cascade.eyeVerification());
+  startup.mark(cascade_from_cache ? "cascade load (cache)" : "cascade load (xml)");
+  if (options.has("cascade-cache-only"))
+  {
+    startup.report(console, "Startup");
+    return 0;
+  }
+
+  // Identification variables (`--identities=<index file>` names tracked faces
+  // with `--embedding-model`; `--enroll=<name>` adds `--enroll-samples` of the
+  // largest face to the index, then saves it)
+  zak::FaceEmbedder face_embedder;
+  zak::IdentityIndex identity_index;
+  zak::FaceIdentifier face_identifier(face_embedder, identity_index);
+  std::vector<std::string> face_names;
+  std::string identity_path = options.get("identities", "");
+  std::string enroll_name = options.get("enroll", "");
+  int enroll_samples = std::max(1, options.getInt("enroll-samples", 10)), enrolled_samples(0);
+  bool identify = !identity_path.empty();
+  if (!enroll_name.empty() && !identify)
+  {
+    std::cerr << "--enroll needs --identities=<index file>" << std::endl;
+    exit(1);
+  }
+  if (identify)
+  {
+    // A new index is only created by enrolling
+    if ((!access(identity_path.c_str(), F_OK) || enroll_name.empty()) && identity_index.open(identity_path))
+    {
+      exit(1);
+    }
+    if (face_embedder.load(options.get("embedding-model", "/usr/local/share/opencv4/face_recognition_sface_2021dec.onnx")))
+    {
+      exit(1);
+    }
+    int embedding_dimensions = face_embedder.dimensions();
+    if (embedding_dimensions < 0)
+    {
+      exit(1);
+    }
+    if (identity_index.size() && embedding_dimensions != identity_index.dimensions())
+    {
+      std::cerr << "The embedding model has " << embedding_dimensions << " dimensions, " << identity_path << " " << identity_index.dimensions() << " (enrolled with another model?)" << std::endl;
+      exit(1);
+    }
+    face_identifier.threshold = static_cast<float>(options.getDouble("identity-threshold", face_identifier.threshold));
+    face_identifier.refresh_detections = options.getInt("identity-refresh", face_identifier.refresh_detections);
+    identity_index.probes = options.getInt("identity-probes", identity_index.probes);
+    std::cerr << "Identity index " << identity_path << ": " << identity_index.identities() << " identities, " << identity_index.size() << " embeddings" << std::endl;
+    startup.mark("identity model");
+  }
+  auto finish_enrollment = [&]() {
+    identity_index.build();
+    if (!identity_index.save(identity_path))
+    {
+      console << "Enrolled " << enroll_name << " (" << enrolled_samples << " samples); " << identity_index.identities() << " identities in " << identity_path << std::endl;
+    }
+    enroll_name.clear();
+  };
+  if (MicrosoftKinect<Device>::videoResolutionToColumnsAndRows(video_resolution, window_columns, window_rows))
+  {
+    exit(1);
+  }
+
+  // T-API acceleration (`--opencl`; falls back to the CPU without an OpenCL device)
+  bool accelerate = options.getBool("opencl", false);
+  if (accelerate)
+  {
+    zak::configureOpenCL(true, console);
+    startup.mark("opencl init");
+  }
+  frame_cache.setAccelerated(accelerate);
+
+  zak::warmUpCascade(face_detection, cv::Size((window_columns / quality.settings().image_scale), (window_rows / quality.settings().image_scale)), quality.settings().scale_factor, quality.settings().min_neighbors, quality.settings().cascadeMinSize(), 2, accelerate);
+  multi_cascade.warmUp(cv::Size((window_columns / quality.settings().image_scale), (window_rows / quality.settings().image_scale)), quality.settings(), accelerate);
+  startup.mark("warm-up");
+
+  // Microsoft Kinect variables (`--event-timeout-ms` and `--tilt-poll-ms` tune the event loop)
   double tilt_degrees(0);
-  Freenect::Freenect freenect;
-  MicrosoftKinect &kinect = freenect.createDevice<MicrosoftKinect>(0);
+  Context freenect;
+  zak::EventLoopConfig event_loop;
+  event_loop.timeout_ms = options.getInt("event-timeout-ms", event_loop.timeout_ms);
+  event_loop.tilt_poll_ms = options.getInt("tilt-poll-ms", event_loop.tilt_poll_ms);
+  freenect.configure(event_loop);
+  MicrosoftKinect<Device> &kinect = freenect.template createDevice<MicrosoftKinect<Device> >(0);
+
+  // Video format variables (`--video-format=rgb|bayer|yuv|ir`; `--day-night` switches a color format to IR in the dark)
+  std::string video_format = options.get("video-format", "rgb");
+  freenect_video_format day_format = FREENECT_VIDEO_RGB;
+  if (video_format == "bayer")
+  {
+    day_format = FREENECT_VIDEO_BAYER;
+  }
+  else if (video_format == "yuv")
+  {
+    day_format = FREENECT_VIDEO_YUV_RAW;
+  }
+  else if (video_format == "ir")
+  {
+    day_format = FREENECT_VIDEO_IR_8BIT;
+  }
+  else if (video_format != "rgb")
+  {
+    std::cerr << "Unknown video format " << video_format << " (rgb, bayer, yuv or ir)" << std::endl;
+    exit(1);
+  }
+  freenect_video_format capture_format = day_format;
+  bool day_night_switching = options.getBool("day-night", false);
+  if (day_night_switching && day_format == FREENECT_VIDEO_IR_8BIT)
+  {
+    std::cerr << "--day-night switches from a color video format to IR" << std::endl;
+    exit(1);
+  }
+  if (zak::configureDevice(kinect, options) || kinect.setVideoResolution(video_resolution) || (capture_format != FREENECT_VIDEO_RGB && kinect.setVideoCaptureFormat(capture_format)) ||
+      (day_night_switching && !MicrosoftKinect<Device>::videoModeAvailable(video_resolution, FREENECT_VIDEO_IR_8BIT)) ||
+      (options.has("ir-brightness") && kinect.setIRBrightness(options.getInt("ir-brightness", 25))) ||
+      (options.getBool("packed-depth", false) && kinect.setDepthCaptureFormat(FREENECT_DEPTH_11BIT_PACKED)))
+  {
+    exit(1);
+  }
+  if (options.get("frame-exchange", "mailbox") == "queue")
+  {
+    kinect.setFrameExchange(zak::FrameExchange::FRAME_EXCHANGE_QUEUE, options.getInt("frame-exchange-frames", 4));
+  }
+  kinect.setCaptureThreadPlacement(&threads, capture_cpus, options.getInt("capture-fifo", 0));
+  startup.mark("kinect open");
 
   // Image canvas variables
-  if (kinect.getWindowColumnAndRowCount(window_columns, window_rows))
+  if (kinect.getWindowColumnAndRowCount(window_columns, window_rows) || kinect.getDepthColumnAndRowCount(depth_columns, depth_rows))
   {
     exit(1);
   }
   cv::Mat bgr_image(cv::Size(window_columns, window_rows), CV_8UC3, cv::Scalar(0));
-  cv::Mat depth_heat_map(cv::Size(window_columns, window_rows), CV_8UC3);
+  cv::Mat depth_heat_map(cv::Size(depth_columns, depth_rows), CV_8UC3);
+  cv::Mat depth_image(cv::Size(depth_columns, depth_rows), CV_16UC1);
+  tilt_dead_band = ((tilt_dead_band * window_rows) / 480);
+
+  // Frame bus variables (`--frame-bus=/name` publishes frames to shared memory)
+  zak::FrameBusWriter frame_bus;
+  uint64_t video_sequence(0), depth_sequence(0);
+  if (options.has("frame-bus"))
+  {
+    const uint32_t capacities[zak::FRAME_BUS_CHANNEL_COUNT] = {
+        static_cast<uint32_t>(window_columns * window_rows * 3),                          // BGR video
+        static_cast<uint32_t>(depth_columns * depth_rows * sizeof(uint16_t)),             // 11-bit depth
+        static_cast<uint32_t>(zak::FRAME_BUS_MAX_DETECTIONS * sizeof(zak::FrameBusRect)), // Detections
+    };
+    if (frame_bus.open(options.get("frame-bus", "/head_hunter"), capacities, options.getInt("frame-bus-slots", 4)))
+    {
+      exit(1);
+    }
+    console << "Publishing frames on shared memory bus " << options.get("frame-bus", "/head_hunter") << std::endl;
+  }
+
+  // Detection event stream variables (`--events[=<file|unix:path|->]`, stdout by default)
+  zak::DetectionStreamWriter event_stream;
+  zak::FaceTracker face_tracker;
+  std::vector<uint32_t> face_track_ids;
+  if (options.has("events"))
+  {
+    if (event_stream.open(events_target))
+    {
+      exit(1);
+    }
+    threads.place("events", event_stream.writerThread(), worker_cpus);
+  }
 
-  // Facial recognition variables
-  cv::CascadeClassifier face_detection("/usr/local/share/opencv4/haarcascades/haarcascade_frontalface_alt2.xml");
-  float cascade_image_scale = 1.5f;
+  // Recording variables (`--record=<directory>` records annotated video around faces)
+  zak::RecordingSink recorder;
+  if (options.has("record"))
+  {
+    recorder.jpeg_quality = options.getInt("record-jpeg-quality", 80);
+    recorder.messages = &console;
+    if (recorder.open(options.get("record", "."), cv::Size(window_columns, window_rows), options.getDouble("record-fps", 30), options.getDouble("record-pre-roll", 5), options.getDouble("record-post-roll", 5)))
+    {
+      exit(1);
+    }
+    threads.place("recorder", recorder.writerThread(), worker_cpus);
+  }
+
+  // Depth recording variables (`--record-depth=<file.zkd>` losslessly records raw depth while in depth mode)
+  zak::DepthRecorder depth_recorder;
+  if (options.has("record-depth"))
+  {
+    if (depth_recorder.open(options.get("record-depth", "depth.zkd"), cv::Size(depth_columns, depth_rows)))
+    {
+      exit(1);
+    }
+    threads.place("depth recorder", depth_recorder.writerThread(), worker_cpus);
+  }
+
+  // People counting variables (`--people` starts in depth mode and counts
+  // heads in the depth alone; meant for a sensor looking down on a room)
+  zak::PeopleCounter people_counter;
+  std::vector<zak::PeopleCounter::Person> people;
+  std::vector<cv::Rect> people_bounds;
+  size_t people_count(SIZE_MAX); // last count printed
+  bool count_people = options.getBool("people", false);
+  if (count_people)
+  {
+    people_counter.downsample = std::max(1, options.getInt("people-downsample", people_counter.downsample));
+    people_counter.learn_frames = std::max(1, options.getInt("people-learn-frames", people_counter.learn_frames));
+    people_counter.foreground_mm = static_cast<float>(options.getDouble("people-foreground-mm", people_counter.foreground_mm));
+    people_counter.min_area_m2 = options.getDouble("people-min-area", people_counter.min_area_m2);
+    people_counter.head_separation_mm = options.getDouble("people-separation-mm", people_counter.head_separation_mm);
+    enable_depth_heat_map = true;
+  }
+  bool raw_depth_consumers = (frame_bus.isOpen() || depth_recorder.isOpen() || !depth_snapshot_format.empty() || count_people);
+
+  // Raw capture variables (Bayer, YUV and IR: detection reads luma straight from the sensor mosaic, the Y plane or the IR frame)
+  cv::Mat raw_image(cv::Size(window_columns, window_rows), MicrosoftKinect<Device>::videoFrameType(capture_format));
+  bool color_consumers = (!headless || frame_bus.isOpen() || recorder.isOpen() || identify);
+
+  // Day/night variables (`--night-threshold`, `--day-threshold` mean luma and `--night-probe-s`)
+  zak::DayNightSwitch day_night;
+  day_night.config.night_below = options.getDouble("night-threshold", day_night.config.night_below);
+  day_night.config.day_above = options.getDouble("day-threshold", day_night.config.day_above);
+  day_night.config.probe_interval_s = options.getDouble("night-probe-s", day_night.config.probe_interval_s);
+
+  // Frame scheduling variables (the loop sleeps until a frame is published, a
+  // key is pressed or `--frame-wait-ms` passes, rather than polling)
+  int frame_wait_ms = std::max(1, options.getInt("frame-wait-ms", 100));
+
+  // Statistics variables (`--stats` prints once per second)
+  bool print_stats = options.getBool("stats", false);
+  uint64_t stats_frames(0), stats_detections(0);
+  int64 stats_start = cv::getTickCount();
+
+  // Display variables (`--display-fps` caps the frames shown, `--preview-scale`
+  // shrinks the window; the window lives on its own thread, and annotations
+  // are composited there rather than drawn into the frame detection reads)
+  zak::DisplayThread display;
+  zak::FrameOverlay overlay;
+  display.max_fps = options.getDouble("display-fps", 0);
+  display.preview_scale = options.getDouble("preview-scale", 1.0);
 
   // Load BGR Video Window (or headless defaults)
   if (headless)
@@ -338,74 +1047,289 @@ int main(int argc, char **argv)
   }
   else
   {
-    namedWindow("Microsoft Kinect (v1)", cv::WINDOW_AUTOSIZE);
+    display.open("Microsoft Kinect (v1)", &kinect.frameSignal());
+    threads.place("display", display.displayThread(), worker_cpus);
+  }
+  if (options.getBool("mlock", false) && !zak::lockMemory(std::cerr))
+  {
+    console << "Memory locked" << std::endl;
+  }
+  if (count_people)
+  {
+    kinect.setLed(LED_GREEN);
+    kinect.startDepth();
+    console << "Counting people (learning the depth background over " << people_counter.learn_frames << " frames; keep the view clear)" << std::endl;
+  }
+  else
+  {
+    kinect.startVideo();
   }
-  kinect.startVideo();
 
   // Print console commands
-  std::cout << "Press [Esc] or [q] to exit" << std::endl;
+  console << "Press [Esc] or [q] to exit" << std::endl;
   if (!headless)
   {
-    std::cout << "Press [d] to toggle depth heat map" << std::endl;
-    std::cout << "Press [f] to toggle facial recognition" << std::endl;
+    console << "Press [d] to toggle depth heat map" << std::endl;
+    console << "Press [f] to toggle facial recognition" << std::endl;
+  }
+  console << "Press [s] to capture a screenshot" << std::endl;
+  if (!trace_prefix.empty())
+  {
+    console << "Press [t] (or send SIGUSR1) to save a trace" << std::endl;
   }
-  std::cout << "Press [s] to capture a screenshot" << std::endl;
 
   // Process Video
   while (!quit)
   {
+    // Frames published from here on wake the next wait
+    kinect.frameSignal().clear();
+
+    if (!trace_prefix.empty() && zak::tracer().takeDumpRequest())
+    {
+      dump_trace();
+    }
+
     // Update depth image
     if (enable_depth_heat_map)
     {
-      kinect.getDepthHeatMap(depth_heat_map);
-      if (!headless)
+      // Nothing displays the heat map headless; raw depth consumers skip colorizing
+      bool new_depth_frame = ((headless && raw_depth_consumers) ? kinect.getRawDepth(depth_image) : kinect.getDepthHeatMap(depth_heat_map, (raw_depth_consumers ? &depth_image : nullptr)));
+      if (new_depth_frame)
       {
-        cv::imshow("Microsoft Kinect (v1)", depth_heat_map);
+        ++depth_sequence;
+        if (frame_bus.isOpen())
+        {
+          frame_bus.publish(zak::FRAME_BUS_DEPTH, depth_sequence, depth_image.data, depth_image.cols, depth_image.rows, depth_image.type(), depth_image.step, (depth_image.cols * depth_image.elemSize()));
+        }
+        if (depth_recorder.isOpen())
+        {
+          depth_recorder.submit(depth_image, zak::detectionTimestamp());
+        }
+
+        // Count people (changes are printed; each head is a tracked "face" of the event stream)
+        if (count_people)
+        {
+          {
+            zak::TraceSpan span("count people", kinect.depthSequence());
+            people_counter.update(depth_image, people);
+          }
+          people_bounds.clear();
+          for (auto &person : people)
+          {
+            people_bounds.push_back(person.bounds);
+          }
+          if (!people_counter.learning() && people.size() != people_count)
+          {
+            console << "People: " << people.size() << std::endl;
+            kinect.setLed(people.empty() ? LED_GREEN : LED_RED);
+            people_count = people.size();
+          }
+          if (event_stream.isOpen() && !people_counter.learning())
+          {
+            face_tracker.update(people_bounds, face_track_ids);
+            zak::DetectionEvent event;
+            event.timestamp_ns = zak::detectionTimestamp();
+            event.frame_sequence = static_cast<uint32_t>(depth_sequence);
+            event.tilt_centidegrees = static_cast<int16_t>(tilt_degrees * 100);
+            event.face_count = static_cast<uint8_t>(std::min<size_t>(people.size(), zak::DETECTION_STREAM_MAX_FACES));
+            for (uint8_t i = 0; i < event.face_count; ++i)
+            {
+              event.faces[i].track_id = face_track_ids[i];
+              event.faces[i].x = static_cast<int16_t>(people[i].bounds.x);
+              event.faces[i].y = static_cast<int16_t>(people[i].bounds.y);
+              event.faces[i].width = static_cast<uint16_t>(people[i].bounds.width);
+              event.faces[i].height = static_cast<uint16_t>(people[i].bounds.height);
+              event.faces[i].distance_mm = people[i].distance_mm;
+            }
+            event_stream.emit(event);
+          }
+        }
+        if (!headless)
+        {
+          overlay.clear();
+          overlay.faces = people_bounds;
+          display.submit(depth_heat_map, overlay, kinect.depthSequence());
+        }
       }
     }
     else
     {
-      // Update video image
-      kinect.getBGRVideo(bgr_image);
+      // Update video image (raw video is only converted for consumers of color)
+      bool new_video_frame, raw_capture = (capture_format != FREENECT_VIDEO_RGB);
+      if (raw_capture)
+      {
+        if ((new_video_frame = kinect.getRawVideo(raw_image)))
+        {
+          if (capture_format == FREENECT_VIDEO_BAYER)
+          {
+            frame_cache.resetBayer(raw_image);
+          }
+          else if (capture_format == FREENECT_VIDEO_YUV_RAW)
+          {
+            frame_cache.resetUYVY(raw_image);
+          }
+          else
+          {
+            frame_cache.resetGrayscale(raw_image);
+          }
+          if (color_consumers)
+          {
+            bgr_image = frame_cache.bgr();
+          }
+        }
+      }
+      else if ((new_video_frame = kinect.getBGRVideo(bgr_image)))
+      {
+        frame_cache.reset(bgr_image);
+      }
+      if (new_video_frame)
+      {
+        ++video_sequence;
+        if (frame_bus.isOpen())
+        {
+          frame_bus.publish(zak::FRAME_BUS_VIDEO, video_sequence, bgr_image.data, bgr_image.cols, bgr_image.rows, bgr_image.type(), bgr_image.step, (bgr_image.cols * bgr_image.elemSize()));
+        }
+      }
+      if (video_sequence == 1 && !startup_reported && !enable_facial_recognition)
+      {
+        startup.mark("first frame");
+        startup.report(console, "Startup");
+        startup_reported = true;
+      }
+      stats_frames += new_video_frame;
+      if (video_sequence == 1 && new_video_frame && report_threads)
+      {
+        // The capture thread has placed itself by now
+        threads.report(console);
+      }
+
+      // Day/night switch (color frames are judged by the detector's input; takes effect from the next frame)
+      if (day_night_switching && new_video_frame)
+      {
+        double mean_luma = ((day_night.mode() == zak::DayNightSwitch::DAY) ? zak::DayNightSwitch::meanLuma(frame_cache.level(quality.settings().image_scale)) : 0);
+        if (day_night.update(mean_luma, cv::getTickCount()))
+        {
+          bool night = (day_night.mode() == zak::DayNightSwitch::NIGHT);
+          capture_format = (night ? FREENECT_VIDEO_IR_8BIT : day_format);
+          console << (night ? "Dark scene; switching to IR video" : "Probing color video") << std::endl;
+          kinect.stopVideo();
+          if (kinect.setVideoCaptureFormat(capture_format))
+          {
+            exit(1);
+          }
+          kinect.videoIntervals().restart();
+          kinect.startVideo();
+          frame_dedup.invalidate();
+        }
+      }
 
-      // Facial recognition
-      if (enable_facial_recognition)
+      // Facial recognition (on new frames, every `detect_interval` frames)
+      const zak::DetectorSettings &detector_settings = quality.settings();
+      if (enable_facial_recognition && new_video_frame && !(video_sequence % detector_settings.detect_interval))
       {
-        cv::Mat cascade_grayscale;
-        cv::resize(bgr_image, cascade_grayscale, cv::Size((bgr_image.size().width / cascade_image_scale), (bgr_image.size().height / cascade_image_scale)));
-        cv::cvtColor(cascade_grayscale, cascade_grayscale, cv::COLOR_BGR2GRAY);
+        // Detect faces (a near-duplicate frame keeps the previous faces)
+        bool detected = false;
+        if (!deduplicate || !frame_dedup.duplicate(!raw_capture ? bgr_image : (capture_format == FREENECT_VIDEO_BAYER) ? raw_image : frame_cache.grayscale()))
+        {
+          detected = true;
+          zak::TraceSpan span("detect", kinect.videoSequence());
+          int64 detect_start = cv::getTickCount();
+          if (roi_detection)
+          {
+            roi_detector.detect(frame_cache, detector_settings, faces);
+          }
+          else if (multi_cascade_detection)
+          {
+            multi_cascade.detect(frame_cache, detector_settings, faces);
+          }
+          else
+          {
+            face_detector.detect(frame_cache, detector_settings, faces);
+          }
+          double detect_ms = (((cv::getTickCount() - detect_start) * 1000.0) / cv::getTickFrequency());
+          quality.update(detect_ms / detector_settings.detect_interval);
+          ++stats_detections;
+        }
+        if (!startup_reported)
+        {
+          startup.mark("first frame + detection");
+          startup.report(console, "Startup");
+          startup_reported = true;
+        }
 
-        // Detect faces
-        std::vector<cv::Rect> faces;
-        face_detection.detectMultiScale(cascade_grayscale, faces, 1.1, 3, 0, cv::Size(25, 25));
+        // Track and identify faces (embeddings are batched per frame; a tracked face keeps its name)
+        if (event_stream.isOpen() || identify)
+        {
+          face_tracker.update(faces, face_track_ids);
+        }
+        if (identify)
+        {
+          zak::TraceSpan span("identify", kinect.videoSequence());
+          if (!enroll_name.empty() && detected && !face_identifier.enroll(bgr_image, faces, enroll_name) && ++enrolled_samples == enroll_samples)
+          {
+            finish_enrollment();
+          }
+          face_identifier.identify(bgr_image, faces, face_track_ids, face_names);
+        }
+
+        // Publish detections
+        if (frame_bus.isOpen())
+        {
+          zak::FrameBusRect rects[zak::FRAME_BUS_MAX_DETECTIONS];
+          uint32_t count = 0;
+          for (auto &face : faces)
+          {
+            if (count == zak::FRAME_BUS_MAX_DETECTIONS)
+            {
+              break;
+            }
+            rects[count].x = face.x;
+            rects[count].y = face.y;
+            rects[count].width = face.width;
+            rects[count].height = face.height;
+            ++count;
+          }
+          frame_bus.publishDetections(video_sequence, rects, count);
+        }
+
+        // Emit detection event
+        if (event_stream.isOpen())
+        {
+          zak::DetectionEvent event;
+          event.timestamp_ns = zak::detectionTimestamp();
+          event.frame_sequence = static_cast<uint32_t>(video_sequence);
+          event.tilt_centidegrees = static_cast<int16_t>(tilt_degrees * 100);
+          event.face_count = static_cast<uint8_t>(std::min<size_t>(faces.size(), zak::DETECTION_STREAM_MAX_FACES));
+          for (uint8_t i = 0; i < event.face_count; ++i)
+          {
+            event.faces[i].track_id = face_track_ids[i];
+            event.faces[i].x = static_cast<int16_t>(faces[i].x);
+            event.faces[i].y = static_cast<int16_t>(faces[i].y);
+            event.faces[i].width = static_cast<uint16_t>(faces[i].width);
+            event.faces[i].height = static_cast<uint16_t>(faces[i].height);
+            event.faces[i].distance_mm = 0; // Depth is not streamed during facial recognition
+          }
+          event_stream.emit(event);
+        }
 
-        // Draw detection rectangles on original image
         if (!faces.size())
         {
           kinect.setLed(LED_BLINK_RED_YELLOW);
         }
         else
         {
-          int avg_face_y = (cascade_grayscale.size().height / 2), sum_face_y = 0;
+          int avg_face_y = (bgr_image.size().height / 2), sum_face_y = 0;
+          kinect.setLed(LED_RED);
 
-          // Apply rectangles to BGR image
+          // Calculate avgerage y-axis value of faces
           for (auto &face : faces)
           {
             sum_face_y += face.y;
-            kinect.setLed(LED_RED);
-            cv::rectangle(
-                bgr_image,
-                cv::Point(cvRound(face.x * cascade_image_scale), cvRound(face.y * cascade_image_scale)),                                            // Upper left point
-                cv::Point(cvRound((face.x + (face.width - 1)) * cascade_image_scale), cvRound((face.y + (face.height - 1)) * cascade_image_scale)), // Lower right point
-                cv::Scalar(0, 0, 255)                                                                                                               // Red line
-            );
           }
-
-          // Calculate avgerage y-axis value of faces
           avg_face_y = (sum_face_y / faces.size());
 
           // Track face (vertical only)
-          if (avg_face_y < ((cascade_grayscale.size().height / 2) - 25))
+          if (avg_face_y < ((bgr_image.size().height / 2) - tilt_dead_band))
           {
             if (++tilt_degrees >= 30)
             {
@@ -413,7 +1337,7 @@ int main(int argc, char **argv)
             }
             kinect.setTiltDegrees(tilt_degrees);
           }
-          else if (avg_face_y > ((cascade_grayscale.size().height / 2) + 25))
+          else if (avg_face_y > ((bgr_image.size().height / 2) + tilt_dead_band))
           {
             if (--tilt_degrees <= -30)
             {
@@ -424,21 +1348,111 @@ int main(int argc, char **argv)
         }
       }
 
-      // Render image
-      if (!headless)
+      // Annotate new frames (skipped frames reuse the last detections); the
+      // overlay is drawn onto the display's and recorder's copies
+      if (new_video_frame)
       {
-        cv::imshow("Microsoft Kinect (v1)", bgr_image);
+        overlay.faces = faces;
+        overlay.names = face_names;
+        if (recorder.isOpen())
+        {
+          recorder.submit(bgr_image, (enable_facial_recognition && !faces.empty()), &overlay);
+        }
+        if (!headless)
+        {
+          display.submit(bgr_image, overlay, kinect.videoSequence());
+        }
       }
     }
 
-    // Check User Input
-    if (headless)
+    // Report statistics
+    double stats_elapsed = ((cv::getTickCount() - stats_start) / cv::getTickFrequency());
+    if (print_stats && stats_elapsed >= 1.0)
     {
-      key_value = zak::waitKey(5);
+      std::ostringstream report;
+      report << "stats: video " << (stats_frames / stats_elapsed) << " fps, detections " << (stats_detections / stats_elapsed) << "/s, faces " << faces.size() << ", ";
+      quality.report(report);
+      if (roi_detection)
+      {
+        report << ", full resolution scan " << (100 * roi_detector.fineFraction()) << "%";
+      }
+      if (day_night_switching)
+      {
+        report << ", " << ((day_night.mode() == zak::DayNightSwitch::NIGHT) ? "night (IR)" : day_night.probing() ? "day (probe)" : "day") << ", day/night switches " << day_night.switches();
+      }
+      if (deduplicate)
+      {
+        report << ", duplicates skipped " << frame_dedup.skipped() << "/" << frame_dedup.frames() << " (" << (100 * frame_dedup.skipRate()) << "%)";
+        frame_dedup.resetCounters();
+      }
+      zak::EventLoopStats event_stats = freenect.stats(true);
+      double interval_ms, interval_stddev_ms, interval_max_ms;
+      zak::IntervalMeter &intervals = (enable_depth_heat_map ? kinect.depthIntervals() : kinect.videoIntervals());
+      intervals.snapshot(interval_ms, interval_stddev_ms, interval_max_ms, true);
+      report << ", frame interval " << interval_ms << " +/- " << interval_stddev_ms << " ms (max " << interval_max_ms << ")";
+      report << ", event loop " << (event_stats.iterations / stats_elapsed) << " it/s (mean " << event_stats.mean_iteration_ms << " ms, max " << event_stats.max_iteration_ms << " ms), usb errors " << event_stats.usb_errors << ", tilt " << event_stats.tilt_degrees << " deg";
+      report << ", capture dropped " << kinect.getVideoFramesDropped() << " video/" << kinect.getDepthFramesDropped() << " depth, cpu ";
+      threads.reportCpuTime(report);
+      if (event_stream.isOpen())
+      {
+        report << ", events dropped " << event_stream.dropped();
+      }
+      if (recorder.isOpen())
+      {
+        report << ", recordings " << recorder.recordings() << (recorder.recording() ? " (recording)" : "") << ", recorder dropped " << recorder.dropped();
+      }
+      if (identify)
+      {
+        report << ", ";
+        face_identifier.report(report);
+        face_identifier.resetCounters();
+      }
+      if (count_people)
+      {
+        report << ", people " << people.size() << ", ";
+        people_counter.report(report);
+        people_counter.resetCounters();
+      }
+      if (display.isOpen())
+      {
+        report << ", ";
+        display.report(report);
+        display.resetCounters();
+      }
+      if (depth_recorder.isOpen())
+      {
+        report << ", depth recorded " << depth_recorder.frames() << " (ratio " << depth_recorder.ratio() << "), depth recorder dropped " << depth_recorder.dropped();
+      }
+      console << report.str() << std::endl;
+      stats_frames = stats_detections = 0;
+      stats_start = cv::getTickCount();
     }
-    else
+
+    // Check User Input (sleeping until the next frame at the latest)
     {
-      key_value = cv::waitKey(5);
+      zak::TraceSpan span("wait");
+      if (headless)
+      {
+        key_value = zak::waitKey(frame_wait_ms, kinect.frameSignal().fd());
+      }
+      else if ((key_value = display.key()) < 0)
+      {
+        // The display thread wakes the wait when a key is pressed in the window
+        kinect.frameSignal().wait(frame_wait_ms);
+        key_value = display.key();
+      }
+    }
+
+    if (duration_s > 0 && ((cv::getTickCount() - run_start) / cv::getTickFrequency()) >= duration_s)
+    {
+      key_value = 27;
+    }
+
+    // A failed event loop delivers no more frames
+    if (freenect.stats(false).failed)
+    {
+      std::cerr << "Kinect event loop stopped" << std::endl;
+      key_value = 27;
     }
 
     // Process User Input
@@ -456,10 +1470,7 @@ int main(int argc, char **argv)
       {
         kinect.stopVideo();
       }
-      if (!headless)
-      {
-        cv::destroyWindow("Microsoft Kinect (v1)");
-      }
+      display.close();
       break;
     // [d] - Toggle Depth Heat Map Window
     case 100:
@@ -472,12 +1483,14 @@ int main(int argc, char **argv)
 
         // Swap input from video to depth
         kinect.stopVideo();
+        kinect.depthIntervals().restart();
         kinect.startDepth();
       }
       else
       {
         // Swap input from depth to video
         kinect.stopDepth();
+        kinect.videoIntervals().restart();
         kinect.startVideo();
       }
       break;
@@ -489,10 +1502,13 @@ int main(int argc, char **argv)
         enable_facial_recognition = !enable_facial_recognition;
         if (enable_facial_recognition)
         {
+          frame_dedup.invalidate();
           kinect.setLed(LED_BLINK_RED_YELLOW);
         }
         else
         {
+          faces.clear();
+          face_names.clear();
           kinect.setTiltDegrees(0);
           kinect.setLed(LED_GREEN);
         }
@@ -503,13 +1519,43 @@ int main(int argc, char **argv)
     {
       std::ostringstream file;
       file << filename << snap_count << suffix;
-      if (cv::imwrite(file.str(), bgr_image))
+      if (capture_format != FREENECT_VIDEO_RGB && !color_consumers && !enable_depth_heat_map)
+      {
+        // Nothing else needed color; convert the current frame now
+        bgr_image = frame_cache.bgr();
+      }
+      cv::Mat screenshot = bgr_image.clone();
+      overlay.faces = faces;
+      overlay.names = face_names;
+      zak::drawOverlay(screenshot, overlay);
+      bool captured = cv::imwrite(file.str(), screenshot);
+      if (captured)
+      {
+        console << "Captured screenshot " << file.str() << std::endl;
+      }
+      if (enable_depth_heat_map && !depth_snapshot_format.empty())
+      {
+        std::ostringstream depth_name;
+        depth_name << "depth" << snap_count << "." << depth_snapshot_format;
+        if ((depth_snapshot_format == "zkd") ? !zak::depth_file::writeSnapshot(depth_name.str(), depth_image, zak::detectionTimestamp()) : cv::imwrite(depth_name.str(), depth_image))
+        {
+          console << "Captured depth " << depth_name.str() << std::endl;
+          captured = true;
+        }
+      }
+      if (captured)
       {
-        std::cout << "Captured screenshot " << file.str() << std::endl;
         ++snap_count;
       }
       break;
     }
+    // [t] - Trace
+    case 116:
+      if (!trace_prefix.empty())
+      {
+        dump_trace();
+      }
+      break;
     // No input received
     case -1:
       break;
@@ -519,5 +1565,23 @@ int main(int argc, char **argv)
     }
   }
 
+  // An interrupted enrollment keeps the samples it collected
+  if (!enroll_name.empty() && enrolled_samples)
+  {
+    finish_enrollment();
+  }
+
   return 0;
 }
+
+int main(int argc, char **argv)
+{
+  zak::Options options(argc, argv);
+
+  // `--simulate[=<video | "image glob*">]` runs without a Kinect attached
+  if (options.has("simulate"))
+  {
+    return headHunter<zak::SimulatedFreenect, zak::SimulatedKinect>(options);
+  }
+  return headHunter<zak::FreenectEventLoop, Freenect::FreenectDevice>(options);
+}
@@ -0,0 +1,661 @@
+#ifndef ZAK_KINECT_SIMULATOR_HPP
+#define ZAK_KINECT_SIMULATOR_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 3rd Party Libraries
+#include <libfreenect.h>
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "event_loop_stats.hpp"
+#include "frame_kernels.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Frame sources and timing of a simulated Kinect
+   */
+  struct SimulatorConfig
+  {
+    std::string video_source; // video file or "image glob*" (empty: procedural)
+    std::string depth_source; // "16-bit image glob*" (empty: procedural)
+    std::string ir_source;    // IR video file or "image glob*" (empty: the video scene in grayscale)
+    double ambient;           // visible light level (0 - 1) scaling color video; IR is lit by the projector
+    double fps;               // nominal frame rate (HIGH resolution video is capped at 10 Hz and YUV video at 15 Hz, as on hardware)
+    double jitter_ms;         // standard deviation of frame arrival jitter
+    double drop_rate;         // probability that a frame is lost on the "USB bus"
+
+    SimulatorConfig(void) : ambient(1), fps(30), jitter_ms(2), drop_rate(0) {}
+  };
+
+  /**
+   * \brief Hardware-free stand-in for `Freenect::FreenectDevice`
+   *
+   * Offers the subset of the device interface `head_hunter` relies on
+   * (stream control, formats, LED, tilt and the video/depth callbacks) and is
+   * driven by `SimulatedFreenect`'s event thread, so callbacks arrive on a
+   * foreign thread exactly as they do with libfreenect.
+   *
+   * Procedural video shows a face-like figure drifting across a gradient; its
+   * height in the frame follows the tilt angle (about 43 degrees of vertical
+   * field of view), closing the tilt tracking loop. Procedural depth shows the
+   * same figure in front of a wall, with the "no reading" shadow the Kinect's
+   * offset projector casts along its left edge. Procedural IR video is the
+   * scene in grayscale, brightened or dimmed by the projector brightness.
+   */
+  class SimulatedKinect
+  {
+  public:
+    SimulatedKinect(freenect_context *, int _index)
+        : _video_format(FREENECT_VIDEO_RGB),
+          _video_resolution(FREENECT_RESOLUTION_MEDIUM),
+          _depth_format(FREENECT_DEPTH_11BIT),
+          _depth_resolution(FREENECT_RESOLUTION_MEDIUM),
+          _video_running(false),
+          _depth_running(false),
+          _tilt_degrees(0),
+          _led(LED_OFF),
+          _ir_brightness(25),
+          _video_buffer(nullptr),
+          _depth_buffer(nullptr),
+          _video_frames(0),
+          _depth_frames(0),
+          _random(static_cast<std::mt19937::result_type>(_index + 1)) {}
+
+    virtual ~SimulatedKinect() {}
+
+    /**
+     * \brief Select frame sources (call while both streams are stopped)
+     *
+     * \return 0 on success, -1 if a file source cannot be opened
+     */
+    int simulate(const SimulatorConfig &_config)
+    {
+      _simulation = _config;
+      _video_capture.release();
+      _ir_capture.release();
+      _depth_images.clear();
+      if (!_config.video_source.empty())
+      {
+        if (!_video_capture.open(_config.video_source))
+        {
+          std::cerr << "Unable to open simulated video source " << _config.video_source << std::endl;
+          return -1;
+        }
+      }
+      if (!_config.ir_source.empty())
+      {
+        if (!_ir_capture.open(_config.ir_source))
+        {
+          std::cerr << "Unable to open simulated IR source " << _config.ir_source << std::endl;
+          return -1;
+        }
+      }
+      if (!_config.depth_source.empty())
+      {
+        cv::glob(_config.depth_source, _depth_images);
+        if (_depth_images.empty())
+        {
+          std::cerr << "No simulated depth images match " << _config.depth_source << std::endl;
+          return -1;
+        }
+      }
+      return 0;
+    }
+
+    void startVideo(void) { _video_running.store(true, std::memory_order_release); }
+    void startDepth(void) { _depth_running.store(true, std::memory_order_release); }
+
+    /**
+     * \brief Stop a stream; returns once no callback of it is running, so
+     *        its buffer and format may change (as with libfreenect)
+     */
+    void stopVideo(void)
+    {
+      std::lock_guard<std::recursive_mutex> lock(_stream_mutex);
+      _video_running.store(false, std::memory_order_release);
+    }
+    void stopDepth(void)
+    {
+      std::lock_guard<std::recursive_mutex> lock(_stream_mutex);
+      _depth_running.store(false, std::memory_order_release);
+    }
+
+    void setTiltDegrees(double _angle) { _tilt_degrees.store(std::max(-30.0, std::min(30.0, _angle)), std::memory_order_relaxed); }
+    double getTiltDegrees(void) const { return _tilt_degrees.load(std::memory_order_relaxed); }
+    void setLed(freenect_led_options _option) { _led.store(_option, std::memory_order_relaxed); }
+    freenect_led_options getLed(void) const { return static_cast<freenect_led_options>(_led.load(std::memory_order_relaxed)); }
+
+    /**
+     * \brief Counterpart of `freenect_set_ir_brightness` (1 - 50)
+     */
+    int setIRBrightness(int _brightness)
+    {
+      if (_brightness < 1 || _brightness > 50)
+      {
+        return -1;
+      }
+      _ir_brightness.store(_brightness, std::memory_order_relaxed);
+      return 0;
+    }
+    int getIRBrightness(void) const { return _ir_brightness.load(std::memory_order_relaxed); }
+
+    void setVideoFormat(freenect_video_format _format, freenect_resolution _resolution = FREENECT_RESOLUTION_MEDIUM)
+    {
+      std::lock_guard<std::recursive_mutex> lock(_stream_mutex);
+      _video_format = _format;
+      _video_resolution = _resolution;
+    }
+    freenect_video_format getVideoFormat(void) { return _video_format; }
+    freenect_resolution getVideoResolution(void) { return _video_resolution; }
+
+    void setDepthFormat(freenect_depth_format _format, freenect_resolution _resolution = FREENECT_RESOLUTION_MEDIUM)
+    {
+      std::lock_guard<std::recursive_mutex> lock(_stream_mutex);
+      _depth_format = _format;
+      _depth_resolution = _resolution;
+    }
+    freenect_depth_format getDepthFormat(void) { return _depth_format; }
+    freenect_resolution getDepthResolution(void) { return _depth_resolution; }
+
+    /**
+     * \brief Counterpart of `freenect_set_video_buffer` (nullptr restores the
+     *        internal buffer; call from the callbacks or while stopped)
+     */
+    void setVideoBuffer(void *_buffer)
+    {
+      std::lock_guard<std::recursive_mutex> lock(_stream_mutex);
+      _video_buffer = static_cast<uint8_t *>(_buffer);
+    }
+    void setDepthBuffer(void *_buffer)
+    {
+      std::lock_guard<std::recursive_mutex> lock(_stream_mutex);
+      _depth_buffer = static_cast<uint8_t *>(_buffer);
+    }
+
+    virtual void VideoCallback(void *, uint32_t) {}
+    virtual void DepthCallback(void *, uint32_t) {}
+
+    /**
+     * \brief Deliver the frames that are due (simulated event thread only)
+     *
+     * \return Time of the next frame
+     */
+    std::chrono::steady_clock::time_point processEvents(std::chrono::steady_clock::time_point _now)
+    {
+      std::lock_guard<std::recursive_mutex> lock(_stream_mutex);
+      if (_start == std::chrono::steady_clock::time_point())
+      {
+        _start = _now;
+        _video_nominal = _next_video = _now;
+        _depth_nominal = _next_depth = (_now + (period(_simulation.fps) / 2)); // Streams are not in phase
+      }
+
+      bool video_running = _video_running.load(std::memory_order_acquire);
+      bool depth_running = _depth_running.load(std::memory_order_acquire);
+      if (_now >= _next_video)
+      {
+        if (video_running && !dropFrame())
+        {
+          deliverVideo(_now);
+        }
+        _video_nominal = advance(_video_nominal, videoFps(), _now);
+        _next_video = jitter(_video_nominal);
+      }
+      if (_now >= _next_depth)
+      {
+        if (depth_running && !dropFrame())
+        {
+          deliverDepth(_now);
+        }
+        _depth_nominal = advance(_depth_nominal, _simulation.fps, _now);
+        _next_depth = jitter(_depth_nominal);
+      }
+      return std::min(_next_video, _next_depth);
+    }
+
+  private:
+    // Formats change only while streams are stopped, but the event thread schedules frames from them
+    std::atomic<freenect_video_format> _video_format;
+    std::atomic<freenect_resolution> _video_resolution;
+    std::atomic<freenect_depth_format> _depth_format;
+    std::atomic<freenect_resolution> _depth_resolution;
+    std::atomic<bool> _video_running;
+    std::atomic<bool> _depth_running;
+    std::atomic<double> _tilt_degrees;
+    std::atomic<int> _led;
+    std::atomic<int> _ir_brightness;
+    SimulatorConfig _simulation;
+
+    // Held while frames are delivered; recursive because the callbacks install
+    // the next buffer from the event thread
+    std::recursive_mutex _stream_mutex;
+
+    // Event thread state (buffers are also set from outside while stopped)
+    uint8_t *_video_buffer;
+    uint8_t *_depth_buffer;
+    cv::Mat _video_frame;
+    cv::Mat _rgb_frame;
+    cv::Mat _depth_frame;
+    cv::Mat _unpacked_depth;
+    cv::Mat _source_frame;
+    cv::VideoCapture _video_capture;
+    cv::VideoCapture _ir_capture;
+    std::vector<cv::String> _depth_images;
+    uint64_t _video_frames;
+    uint64_t _depth_frames;
+    std::mt19937 _random;
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::time_point _video_nominal;
+    std::chrono::steady_clock::time_point _next_video;
+    std::chrono::steady_clock::time_point _depth_nominal;
+    std::chrono::steady_clock::time_point _next_depth;
+
+    /**
+     * \brief Video frame size (8-bit IR frames have 8 more rows at MEDIUM resolution)
+     */
+    cv::Size videoSize(void) const
+    {
+      cv::Size size = resolutionSize(_video_resolution);
+      if (_video_format == FREENECT_VIDEO_IR_8BIT && _video_resolution == FREENECT_RESOLUTION_MEDIUM)
+      {
+        size.height = 488;
+      }
+      return size;
+    }
+
+    static cv::Size resolutionSize(freenect_resolution _resolution)
+    {
+      switch (_resolution)
+      {
+      case FREENECT_RESOLUTION_LOW:
+        return cv::Size(320, 240);
+      case FREENECT_RESOLUTION_HIGH:
+        return cv::Size(1280, 1024);
+      default:
+        return cv::Size(640, 480);
+      }
+    }
+
+    double videoFps(void) const
+    {
+      if (_video_resolution == FREENECT_RESOLUTION_HIGH)
+      {
+        return std::min(_simulation.fps, 10.0);
+      }
+      return ((_video_format == FREENECT_VIDEO_YUV_RAW) ? std::min(_simulation.fps, 15.0) : _simulation.fps);
+    }
+
+    bool dropFrame(void)
+    {
+      return (_simulation.drop_rate > 0 && std::uniform_real_distribution<double>(0, 1)(_random) < _simulation.drop_rate);
+    }
+
+    /**
+     * \brief Arrival time of a frame: its nominal time plus bounded jitter
+     *        (jitter never accumulates into drift)
+     */
+    std::chrono::steady_clock::time_point jitter(std::chrono::steady_clock::time_point _nominal)
+    {
+      double jitter_us = 0;
+      if (_simulation.jitter_ms > 0)
+      {
+        jitter_us = (1000.0 * _simulation.jitter_ms * std::max(-3.0, std::min(3.0, std::normal_distribution<double>(0, 1)(_random))));
+      }
+      return (_nominal + std::chrono::microseconds(static_cast<int64_t>(jitter_us)));
+    }
+
+    static std::chrono::steady_clock::duration period(double _fps)
+    {
+      return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / _fps));
+    }
+
+    /**
+     * \brief Nominal time of the next frame; frames the event thread was too
+     *        late for are skipped (the sensor does not wait for the host)
+     */
+    static std::chrono::steady_clock::time_point advance(std::chrono::steady_clock::time_point _nominal, double _fps, std::chrono::steady_clock::time_point _now)
+    {
+      _nominal += period(_fps);
+      while (_nominal < _now)
+      {
+        _nominal += period(_fps);
+      }
+      return _nominal;
+    }
+
+    /**
+     * \brief libfreenect-style timestamp (device clock, wraps at 32 bits)
+     */
+    uint32_t timestamp(std::chrono::steady_clock::time_point _now) const
+    {
+      return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(_now - _start).count());
+    }
+
+    /**
+     * \brief Horizontal position (0 - 1) of the figure at frame `_frame`
+     */
+    static double figurePosition(uint64_t _frame)
+    {
+      return (0.5 + (0.3 * std::sin(_frame * 0.02)));
+    }
+
+    int figureRow(cv::Size _size) const
+    {
+      // Tilting the camera up moves the scene down in the frame
+      return cvRound((_size.height * 0.45) + (getTiltDegrees() * (_size.height / 43.0)));
+    }
+
+    void deliverVideo(std::chrono::steady_clock::time_point _now)
+    {
+      cv::Size size = videoSize();
+      bool bayer = (_video_format == FREENECT_VIDEO_BAYER);
+      bool yuv = (_video_format == FREENECT_VIDEO_YUV_RAW);
+      bool ir = (_video_format == FREENECT_VIDEO_IR_8BIT);
+      uint8_t *target = _video_buffer;
+      if (!target)
+      {
+        _video_frame.create(size, ((bayer || ir) ? CV_8UC1 : yuv ? CV_8UC2 : CV_8UC3));
+        target = _video_frame.data;
+      }
+
+      if (ir)
+      {
+        cv::Mat frame(size, CV_8UC1, target);
+        renderIR(frame);
+        ++_video_frames;
+        VideoCallback(target, timestamp(_now));
+        return;
+      }
+
+      // Bayer and YUV frames are rendered in RGB, then sampled through the
+      // sensor's color filter or encoded
+      cv::Mat frame;
+      if (bayer || yuv)
+      {
+        _rgb_frame.create(size, CV_8UC3);
+        frame = _rgb_frame;
+      }
+      else
+      {
+        frame = cv::Mat(size, CV_8UC3, target);
+      }
+      renderScene(frame);
+      if (_simulation.ambient < 1)
+      {
+        // A dim room
+        frame.convertTo(frame, -1, std::max(0.0, _simulation.ambient));
+      }
+
+      if (bayer)
+      {
+        cv::Mat mosaic(size, CV_8UC1, target);
+        mosaicBayer(frame, mosaic);
+      }
+      else if (yuv)
+      {
+        cv::Mat uyvy(size, CV_8UC2, target);
+        packUYVY(frame, uyvy);
+      }
+
+      ++_video_frames;
+      VideoCallback(target, timestamp(_now));
+    }
+
+    /**
+     * \brief The video source (or procedural scene) in RGB
+     */
+    void renderScene(cv::Mat &_frame)
+    {
+      if (_video_capture.isOpened())
+      {
+        if (!_video_capture.read(_source_frame))
+        {
+          // Loop the footage
+          _video_capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+          _video_capture.read(_source_frame);
+        }
+        if (_source_frame.empty())
+        {
+          _frame.setTo(cv::Scalar::all(0));
+        }
+        else
+        {
+          cv::resize(_source_frame, _source_frame, _frame.size());
+          cv::cvtColor(_source_frame, _frame, cv::COLOR_BGR2RGB);
+        }
+      }
+      else
+      {
+        renderVideo(_frame, _video_frames);
+      }
+    }
+
+    /**
+     * \brief An 8-bit IR frame: replayed, or the scene lit by the projector
+     */
+    void renderIR(cv::Mat &_frame)
+    {
+      if (_ir_capture.isOpened())
+      {
+        if (!_ir_capture.read(_source_frame))
+        {
+          _ir_capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+          _ir_capture.read(_source_frame);
+        }
+        if (_source_frame.empty())
+        {
+          _frame.setTo(cv::Scalar::all(0));
+          return;
+        }
+        if (_source_frame.channels() != 1)
+        {
+          cv::cvtColor(_source_frame, _source_frame, cv::COLOR_BGR2GRAY);
+        }
+        cv::resize(_source_frame, _frame, _frame.size());
+        return;
+      }
+      _rgb_frame.create(_frame.size(), CV_8UC3);
+      renderScene(_rgb_frame);
+      cv::cvtColor(_rgb_frame, _frame, cv::COLOR_RGB2GRAY);
+      _frame.convertTo(_frame, -1, (0.5 + (getIRBrightness() / 50.0)));
+    }
+
+    void deliverDepth(std::chrono::steady_clock::time_point _now)
+    {
+      cv::Size size = resolutionSize(_depth_resolution);
+      bool packed = (_depth_format == FREENECT_DEPTH_11BIT_PACKED);
+      uint8_t *target = _depth_buffer;
+      if (!target)
+      {
+        _depth_frame.create(size.height, (packed ? packedDepthRowBytes(size.width) : size.width), (packed ? CV_8UC1 : CV_16UC1));
+        target = _depth_frame.data;
+      }
+
+      // Packed depth is rendered in 16-bit words, then packed
+      cv::Mat frame;
+      if (packed)
+      {
+        _unpacked_depth.create(size, CV_16UC1);
+        frame = _unpacked_depth;
+      }
+      else
+      {
+        frame = cv::Mat(size, CV_16UC1, target);
+      }
+
+      if (!_depth_images.empty())
+      {
+        _source_frame = cv::imread(_depth_images[_depth_frames % _depth_images.size()], cv::IMREAD_ANYDEPTH);
+        if (_source_frame.empty() || _source_frame.type() != CV_16UC1)
+        {
+          frame.setTo(cv::Scalar::all(2047));
+        }
+        else
+        {
+          cv::resize(_source_frame, frame, size, 0, 0, cv::INTER_NEAREST);
+        }
+      }
+      else
+      {
+        renderDepth(frame, _depth_frames);
+      }
+
+      if (packed)
+      {
+        cv::Mat packed_frame(size.height, packedDepthRowBytes(size.width), CV_8UC1, target);
+        packDepth(frame, packed_frame);
+      }
+
+      ++_depth_frames;
+      DepthCallback(target, timestamp(_now));
+    }
+
+    void renderVideo(cv::Mat &_frame, uint64_t _frame_index) const
+    {
+      // Background: slowly drifting vertical gradient (RGB order)
+      int shift = static_cast<int>(_frame_index % 64);
+      for (int r = 0; r < _frame.rows; ++r)
+      {
+        uint8_t level = static_cast<uint8_t>(64 + (((r * 96) / _frame.rows + shift) % 128));
+        _frame.row(r).setTo(cv::Scalar(level, level, static_cast<uint8_t>(level / 2 + 32)));
+      }
+
+      // Face-like figure
+      int unit = (_frame.cols / 16);
+      cv::Point center(cvRound(figurePosition(_frame_index) * _frame.cols), figureRow(_frame.size()));
+      cv::ellipse(_frame, center + cv::Point(0, (unit * 4)), cv::Size((unit * 3), (unit * 3)), 0, 180, 360, cv::Scalar(40, 60, 140), cv::FILLED);
+      cv::ellipse(_frame, center, cv::Size(unit, cvRound(unit * 1.3)), 0, 0, 360, cv::Scalar(224, 172, 140), cv::FILLED);
+      cv::ellipse(_frame, center + cv::Point(-(unit * 2) / 5, -unit / 4), cv::Size(unit / 5, unit / 9), 0, 0, 360, cv::Scalar(30, 20, 20), cv::FILLED);
+      cv::ellipse(_frame, center + cv::Point((unit * 2) / 5, -unit / 4), cv::Size(unit / 5, unit / 9), 0, 0, 360, cv::Scalar(30, 20, 20), cv::FILLED);
+      cv::ellipse(_frame, center + cv::Point(0, (unit * 3) / 5), cv::Size(unit / 3, unit / 10), 0, 0, 360, cv::Scalar(150, 70, 70), cv::FILLED);
+    }
+
+    void renderDepth(cv::Mat &_frame, uint64_t _frame_index) const
+    {
+      // Wall at ~2.5m, figure at ~1.2m (raw 11-bit disparity values)
+      _frame.setTo(cv::Scalar::all(900));
+      int unit = (_frame.cols / 16);
+      cv::Point center(cvRound(figurePosition(_frame_index) * _frame.cols), figureRow(_frame.size()));
+      cv::Point shadow(-(unit / 3), 0);
+      cv::ellipse(_frame, center + shadow, cv::Size(unit, cvRound(unit * 1.3)), 0, 0, 360, cv::Scalar::all(2047), cv::FILLED);
+      cv::ellipse(_frame, center + shadow + cv::Point(0, (unit * 4)), cv::Size((unit * 3), (unit * 3)), 0, 180, 360, cv::Scalar::all(2047), cv::FILLED);
+      cv::ellipse(_frame, center, cv::Size(unit, cvRound(unit * 1.3)), 0, 0, 360, cv::Scalar::all(720), cv::FILLED);
+      cv::ellipse(_frame, center + cv::Point(0, (unit * 4)), cv::Size((unit * 3), (unit * 3)), 0, 180, 360, cv::Scalar::all(740), cv::FILLED);
+    }
+  };
+
+  /**
+   * \brief Hardware-free stand-in for `Freenect::Freenect`
+   *
+   * Owns the devices and runs the event thread that delivers their frames.
+   * As with libfreenect, the event thread is stopped before any device is
+   * destroyed, so callbacks never run on a partially destroyed device.
+   */
+  class SimulatedFreenect
+  {
+  public:
+    SimulatedFreenect(void) : _stop(false), _timeout_ms(EventLoopConfig().timeout_ms), _tilt_poll_ms(EventLoopConfig().tilt_poll_ms), _thread(&SimulatedFreenect::run, this) {}
+
+    ~SimulatedFreenect()
+    {
+      _stop.store(true, std::memory_order_release);
+      _thread.join();
+      for (auto &device : _devices)
+      {
+        delete device.second;
+      }
+    }
+
+    /**
+     * \brief Apply loop tuning (as `FreenectEventLoop`; there are no USB errors)
+     */
+    void configure(const EventLoopConfig &_config)
+    {
+      _timeout_ms.store(std::max(1, _config.timeout_ms), std::memory_order_relaxed);
+      _tilt_poll_ms.store(_config.tilt_poll_ms, std::memory_order_relaxed);
+    }
+
+    EventLoopStats stats(bool _reset)
+    {
+      return _meter.snapshot(_reset);
+    }
+
+    template <typename ConcreteDevice>
+    ConcreteDevice &createDevice(int _index)
+    {
+      ConcreteDevice *device = new ConcreteDevice(nullptr, _index);
+      std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+      SimulatedKinect *&slot = _devices[_index];
+      delete slot;
+      slot = device;
+      return *device;
+    }
+
+    void deleteDevice(int _index)
+    {
+      std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+      std::map<int, SimulatedKinect *>::iterator it = _devices.find(_index);
+      if (it != _devices.end())
+      {
+        delete it->second;
+        _devices.erase(it);
+      }
+    }
+
+    int deviceCount(void)
+    {
+      std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+      return static_cast<int>(_devices.size());
+    }
+
+  private:
+    std::atomic<bool> _stop;
+    std::atomic<int> _timeout_ms;
+    std::atomic<int> _tilt_poll_ms;
+    std::mutex _devices_mutex;
+    std::map<int, SimulatedKinect *> _devices;
+    EventLoopMeter _meter;
+    std::thread _thread;
+
+    void run(void)
+    {
+      std::chrono::steady_clock::time_point next_tilt_poll = std::chrono::steady_clock::now();
+      while (!_stop.load(std::memory_order_acquire))
+      {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point wake = (now + std::chrono::milliseconds(_timeout_ms.load(std::memory_order_relaxed)));
+        int tilt_poll_ms = _tilt_poll_ms.load(std::memory_order_relaxed);
+        {
+          std::lock_guard<std::mutex> devices_lock(_devices_mutex);
+          for (auto &device : _devices)
+          {
+            wake = std::min(wake, device.second->processEvents(now));
+          }
+          if (tilt_poll_ms > 0 && now >= next_tilt_poll && !_devices.empty())
+          {
+            next_tilt_poll = (now + std::chrono::milliseconds(tilt_poll_ms));
+            _meter.tilt(_devices.begin()->second->getTiltDegrees(), TILT_STATUS_STOPPED);
+          }
+        }
+        _meter.iteration(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count(), 0);
+        std::this_thread::sleep_until(wake);
+      }
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_KINECT_SIMULATOR_HPP
@@ -0,0 +1,238 @@
+#ifndef ZAK_MULTI_CASCADE_DETECTOR_HPP
+#define ZAK_MULTI_CASCADE_DETECTOR_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "cascade_loader.hpp"
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "frame_cache.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Several face cascades fused into one detection pass
+   *
+   * The frontal cascade loses heads turned to the side, so profile cascades
+   * can join it: OpenCV's profile cascade only knows one side, and its
+   * mirrored pass scans the horizontally flipped image for the other.
+   *
+   * All passes scan the same cached cascade input (`FrameCache`) and run
+   * concurrently with `cv::parallel_for_`. A face found by several cascades
+   * is reported once, in the box of the first pass (frontal first). An
+   * optional eye cascade then rejects faces without a visible eye; faces too
+   * small to resolve eyes at full resolution are kept.
+   */
+  class MultiCascadeDetector
+  {
+  public:
+    enum Pass
+    {
+      PASS_FRONTAL,
+      PASS_PROFILE,
+      PASS_MIRRORED_PROFILE,
+    };
+
+    /**
+     * \param[in] _frontal The loaded frontal cascade (always the first pass)
+     */
+    MultiCascadeDetector(cv::CascadeClassifier &_frontal) : _eye_cascade(nullptr), _eye_verification(false)
+    {
+      _passes.push_back(ScanPass(PASS_FRONTAL, &_frontal));
+    }
+
+    /**
+     * \brief Add a profile pass
+     *
+     * \param[in] _pass `PASS_PROFILE` or `PASS_MIRRORED_PROFILE`
+     * \return 0 on success, -1 if the cascade cannot be loaded
+     */
+    int addProfile(const std::string &_source_path, const std::string &_cache_path, Pass _pass)
+    {
+      // Passes run concurrently and a classifier is not reentrant, so each pass loads its own
+      cv::CascadeClassifier *profile = loadOwned(_source_path, _cache_path);
+      if (!profile)
+      {
+        return -1;
+      }
+      _passes.push_back(ScanPass(_pass, profile));
+      return 0;
+    }
+
+    /**
+     * \brief Verify faces with an eye cascade
+     *
+     * \return 0 on success, -1 if the cascade cannot be loaded
+     */
+    int setEyeVerification(const std::string &_source_path, const std::string &_cache_path)
+    {
+      _eye_cascade = loadOwned(_source_path, _cache_path);
+      _eye_verification = (_eye_cascade != nullptr);
+      return (_eye_verification ? 0 : -1);
+    }
+
+    size_t passes(void) const { return _passes.size(); }
+    bool eyeVerification(void) const { return _eye_verification; }
+
+    /**
+     * \brief Warm up the cascades this detector loaded (see `warmUpCascade`)
+     */
+    void warmUp(cv::Size _size, const DetectorSettings &_settings, bool _accelerated = false)
+    {
+      for (auto &cascade : _owned)
+      {
+        warmUpCascade(*cascade, _size, _settings.scale_factor, _settings.min_neighbors, _settings.cascadeMinSize(), 2, _accelerated);
+      }
+    }
+
+    /**
+     * \brief Detect faces with every pass
+     *
+     * \param[in] _frame The frame (its cascade input is computed or shared)
+     * \param[out] _faces Detections, in pixels of the video frame
+     * \param[out] _sources Pass that found each face (optional)
+     */
+    void detect(FrameCache &_frame, const DetectorSettings &_settings, std::vector<cv::Rect> &_faces, std::vector<Pass> *_sources = nullptr)
+    {
+      bool mirrored = false;
+      for (auto &pass : _passes)
+      {
+        mirrored = (mirrored || pass.pass == PASS_MIRRORED_PROFILE);
+      }
+
+      if (_frame.accelerated())
+      {
+        // T-API: the device (or OpenCV's CPU fallback) parallelizes each pass
+        cv::UMat grayscale = _frame.levelUMat(_settings.image_scale);
+        if (mirrored)
+        {
+          cv::flip(grayscale, _mirrored_umat, 1);
+        }
+        for (auto &pass : _passes)
+        {
+          scan(pass, ((pass.pass == PASS_MIRRORED_PROFILE) ? _mirrored_umat : grayscale), grayscale.cols, _settings);
+        }
+      }
+      else
+      {
+        // One task per pass
+        cv::Mat grayscale = _frame.level(_settings.image_scale);
+        if (mirrored)
+        {
+          cv::flip(grayscale, _mirrored, 1);
+        }
+        cv::parallel_for_(cv::Range(0, static_cast<int>(_passes.size())), [&](const cv::Range &_range) {
+          for (int i = _range.start; i < _range.end; ++i)
+          {
+            scan(_passes[i], ((_passes[i].pass == PASS_MIRRORED_PROFILE) ? _mirrored : grayscale), grayscale.cols, _settings);
+          }
+        });
+      }
+
+      // De-duplicate across passes, then verify
+      _faces.clear();
+      if (_sources)
+      {
+        _sources->clear();
+      }
+      for (auto &pass : _passes)
+      {
+        for (auto &face : pass.faces)
+        {
+          if (!duplicate(face, _faces) && verify(_frame, face))
+          {
+            _faces.push_back(face);
+            if (_sources)
+            {
+              _sources->push_back(pass.pass);
+            }
+          }
+        }
+      }
+    }
+
+  private:
+    struct ScanPass
+    {
+      ScanPass(Pass _pass, cv::CascadeClassifier *_cascade) : pass(_pass), cascade(_cascade) {}
+
+      Pass pass;
+      cv::CascadeClassifier *cascade;
+      std::vector<cv::Rect> faces; // per pass, so passes never share output
+    };
+
+    std::vector<ScanPass> _passes;
+    std::vector<std::unique_ptr<cv::CascadeClassifier> > _owned;
+    cv::CascadeClassifier *_eye_cascade;
+    bool _eye_verification;
+    cv::Mat _mirrored;
+    cv::UMat _mirrored_umat;
+    std::vector<cv::Rect> _eyes;
+
+    cv::CascadeClassifier *loadOwned(const std::string &_source_path, const std::string &_cache_path)
+    {
+      std::unique_ptr<cv::CascadeClassifier> cascade(new cv::CascadeClassifier());
+      bool from_cache;
+      if (loadCascade(*cascade, _source_path, _cache_path, from_cache))
+      {
+        return nullptr;
+      }
+      _owned.push_back(std::move(cascade));
+      return _owned.back().get();
+    }
+
+    /**
+     * \brief Run one pass and map its faces to the video frame
+     */
+    static void scan(ScanPass &_pass, cv::InputArray _grayscale, int _columns, const DetectorSettings &_settings)
+    {
+      _pass.cascade->detectMultiScale(_grayscale, _pass.faces, _settings.scale_factor, _settings.min_neighbors, 0, _settings.cascadeMinSize());
+      for (auto &face : _pass.faces)
+      {
+        if (_pass.pass == PASS_MIRRORED_PROFILE)
+        {
+          face.x = (_columns - face.x - face.width);
+        }
+        face = upscaleRect(face, _settings.image_scale);
+      }
+    }
+
+    static bool duplicate(const cv::Rect &_face, const std::vector<cv::Rect> &_faces)
+    {
+      for (auto &face : _faces)
+      {
+        if (FaceTracker::intersectionOverUnion(_face, face) > 0.3)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * \brief Look for an eye in the upper half of a face (full resolution)
+     */
+    bool verify(FrameCache &_frame, const cv::Rect &_face)
+    {
+      static const int EYE_WINDOW = 20; // haarcascade_eye window
+      cv::Rect upper_half = (cv::Rect(_face.x, _face.y, _face.width, (_face.height / 2)) & cv::Rect(cv::Point(0, 0), _frame.size()));
+      if (!_eye_verification || (upper_half.width / 3) < EYE_WINDOW)
+      {
+        return true;
+      }
+      _eye_cascade->detectMultiScale(_frame.grayscale()(upper_half), _eyes, 1.1, 2, 0, cv::Size(EYE_WINDOW, EYE_WINDOW), cv::Size((upper_half.width / 2), (upper_half.width / 2)));
+      return !_eyes.empty();
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_MULTI_CASCADE_DETECTOR_HPP
@@ -0,0 +1,91 @@
+#ifndef ZAK_OPTIONS_HPP
+#define ZAK_OPTIONS_HPP
+
+// C/C++ Libraries
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace zak
+{
+  /**
+   * \brief Minimal command line option parser
+   *
+   * Arguments of the form `--name=value` (or `--name`, meaning "1") are
+   * collected as named options; all other arguments are kept, in order, as
+   * positional arguments. This keeps the historical `head_hunter <headless>`
+   * invocation working while allowing additional settings.
+   */
+  class Options
+  {
+  public:
+    Options(int argc, char **argv)
+    {
+      for (int i = 1; i < argc; ++i)
+      {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 2, "--") == 0)
+        {
+          size_t equals = arg.find('=');
+          if (equals == std::string::npos)
+          {
+            _named[arg.substr(2)] = "1";
+          }
+          else
+          {
+            _named[arg.substr(2, (equals - 2))] = arg.substr(equals + 1);
+          }
+        }
+        else
+        {
+          _positional.push_back(arg);
+        }
+      }
+    }
+
+    bool has(const std::string &_name) const
+    {
+      return _named.count(_name);
+    }
+
+    std::string get(const std::string &_name, const std::string &_default_value) const
+    {
+      std::map<std::string, std::string>::const_iterator it = _named.find(_name);
+      return ((it == _named.end()) ? _default_value : it->second);
+    }
+
+    int getInt(const std::string &_name, int _default_value) const
+    {
+      std::map<std::string, std::string>::const_iterator it = _named.find(_name);
+      return ((it == _named.end()) ? _default_value : std::atoi(it->second.c_str()));
+    }
+
+    double getDouble(const std::string &_name, double _default_value) const
+    {
+      std::map<std::string, std::string>::const_iterator it = _named.find(_name);
+      return ((it == _named.end()) ? _default_value : std::atof(it->second.c_str()));
+    }
+
+    bool getBool(const std::string &_name, bool _default_value) const
+    {
+      std::map<std::string, std::string>::const_iterator it = _named.find(_name);
+      if (it == _named.end())
+      {
+        return _default_value;
+      }
+      return !(it->second == "0" || it->second == "false" || it->second == "off");
+    }
+
+    const std::vector<std::string> &positional(void) const
+    {
+      return _positional;
+    }
+
+  private:
+    std::map<std::string, std::string> _named;
+    std::vector<std::string> _positional;
+  };
+} // namespace zak
+
+#endif // ZAK_OPTIONS_HPP
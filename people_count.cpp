@@ -0,0 +1,221 @@
+// C/C++ Libraries
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "depth_recorder.hpp"
+#include "options.hpp"
+#include "people_counter.hpp"
+
+/*
+ * Depth people counting replay
+ *
+ * Runs the `head_hunter --people` counter over recorded depth: a lossless
+ * recording (`--record-depth=<file.zkd>`) or 16-bit images of raw depth (as
+ * written by `depth_decode` or `--depth-snapshot=png`). One CSV row per
+ * frame goes to stdout (frame, timestamp, count, then `x:y:mm` for each head,
+ * separated by `;`); the time per frame goes to stderr. The counter runs on
+ * one thread unless `--threads` says otherwise, as on a single ARM core.
+ *
+ * With `--truth=<file>` (lines of `frame count`, zero-based frames; `#`
+ * starts a comment), the counts are scored against the expected ones after
+ * the background is learned; the exit code is 2 if fewer than
+ * `--min-accuracy` of the scored frames have the exact count.
+ *
+ * Usage: people_count <recording.zkd | "image glob*"> [--truth=<file>]
+ *            [--min-accuracy=0.95] [--learn-frames=30] [--foreground-mm=150]
+ *            [--min-area=0.05] [--separation-mm=400] [--downsample=4]
+ *            [--threads=N]
+ */
+
+namespace
+{
+  /**
+   * \brief Load expected counts
+   *
+   * \return 0 on success, -1 on a malformed file
+   */
+  int loadTruth(const std::string &_path, std::map<unsigned, size_t> &_truth)
+  {
+    std::ifstream in(_path.c_str());
+    if (!in)
+    {
+      std::cerr << "Unable to read " << _path << std::endl;
+      return -1;
+    }
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number)
+    {
+      std::istringstream fields(line.substr(0, line.find('#')));
+      unsigned frame;
+      size_t count;
+      std::string extra;
+      if (!(fields >> frame))
+      {
+        continue;
+      }
+      if (!(fields >> count) || (fields >> extra))
+      {
+        std::cerr << _path << ":" << line_number << ": expected frame count" << std::endl;
+        return -1;
+      }
+      _truth[frame] = count;
+    }
+    return 0;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  zak::Options options(argc, argv);
+  if (options.positional().empty())
+  {
+    std::cerr << "Usage: " << argv[0] << " <recording.zkd | \"image glob*\"> [--truth=<file>] [--min-accuracy=0.95] [--learn-frames=30]" << std::endl;
+    return 1;
+  }
+  cv::setNumThreads(options.getInt("threads", 1));
+
+  // Open the depth source
+  std::string source = options.positional()[0];
+  bool recording = (source.size() > 4 && source.compare((source.size() - 4), 4, ".zkd") == 0);
+  FILE *input = nullptr;
+  std::vector<cv::String> images;
+  if (recording)
+  {
+    input = std::fopen(source.c_str(), "rb");
+    if (!input)
+    {
+      perror(source.c_str());
+      return 1;
+    }
+    if (zak::depth_file::readHeader(input))
+    {
+      std::cerr << "Not a depth recording" << std::endl;
+      return 1;
+    }
+  }
+  else
+  {
+    cv::glob(source, images);
+    if (images.empty())
+    {
+      std::cerr << "No depth images match " << source << std::endl;
+      return 1;
+    }
+  }
+
+  std::map<unsigned, size_t> truth;
+  if (options.has("truth") && loadTruth(options.get("truth", ""), truth))
+  {
+    return 1;
+  }
+
+  zak::PeopleCounter counter;
+  counter.learn_frames = std::max(1, options.getInt("learn-frames", counter.learn_frames));
+  counter.foreground_mm = static_cast<float>(options.getDouble("foreground-mm", counter.foreground_mm));
+  counter.min_area_m2 = options.getDouble("min-area", counter.min_area_m2);
+  counter.head_separation_mm = options.getDouble("separation-mm", counter.head_separation_mm);
+  counter.downsample = std::max(1, options.getInt("downsample", counter.downsample));
+
+  // Count every frame
+  zak::DepthCodec codec;
+  std::vector<uint8_t> payload;
+  std::vector<zak::PeopleCounter::Person> people;
+  std::vector<double> latencies_ms;
+  cv::Mat depth;
+  uint64_t timestamp = 0;
+  unsigned scored = 0, exact = 0;
+  size_t absolute_error = 0;
+  std::cout << "frame,timestamp_ns,people,heads" << std::endl;
+  for (unsigned frame = 0;; ++frame)
+  {
+    if (recording)
+    {
+      int result = zak::depth_file::readFrame(input, payload, timestamp);
+      if (result)
+      {
+        if (result < 0)
+        {
+          std::cerr << "Truncated frame " << frame << std::endl;
+        }
+        break;
+      }
+      if (codec.decode(payload, depth))
+      {
+        std::cerr << "Corrupt frame " << frame << std::endl;
+        return 1;
+      }
+    }
+    else
+    {
+      if (frame == images.size())
+      {
+        break;
+      }
+      depth = cv::imread(images[frame], cv::IMREAD_ANYDEPTH);
+      if (depth.empty() || depth.type() != CV_16UC1)
+      {
+        std::cerr << "Not a 16-bit depth image: " << images[frame] << std::endl;
+        return 1;
+      }
+    }
+
+    int64 start = cv::getTickCount();
+    counter.update(depth, people);
+    latencies_ms.push_back(((cv::getTickCount() - start) * 1000.0) / cv::getTickFrequency());
+
+    std::cout << frame << "," << timestamp << "," << people.size() << ",";
+    for (size_t i = 0; i < people.size(); ++i)
+    {
+      std::cout << (i ? ";" : "") << people[i].position.x << ":" << people[i].position.y << ":" << people[i].distance_mm;
+    }
+    std::cout << std::endl;
+
+    std::map<unsigned, size_t>::const_iterator expected = truth.find(frame);
+    if (expected != truth.end() && frame >= counter.learn_frames)
+    {
+      ++scored;
+      exact += (people.size() == expected->second);
+      absolute_error += ((people.size() > expected->second) ? (people.size() - expected->second) : (expected->second - people.size()));
+    }
+  }
+  if (input)
+  {
+    std::fclose(input);
+  }
+  if (latencies_ms.empty())
+  {
+    std::cerr << "No depth frames" << std::endl;
+    return 1;
+  }
+
+  // Time per frame (mean, median and 99th percentile)
+  double total_ms = 0;
+  for (double latency : latencies_ms)
+  {
+    total_ms += latency;
+  }
+  std::sort(latencies_ms.begin(), latencies_ms.end());
+  std::cerr << latencies_ms.size() << " frames at " << depth.cols << "x" << depth.rows << ": " << (total_ms / latencies_ms.size()) << " ms/frame (median " << latencies_ms[latencies_ms.size() / 2] << ", p99 " << latencies_ms[std::min((latencies_ms.size() - 1), ((latencies_ms.size() * 99) / 100))] << ")" << std::endl;
+
+  if (!truth.empty())
+  {
+    double accuracy = (scored ? (static_cast<double>(exact) / scored) : 0.0);
+    std::cerr << "Exact count on " << exact << "/" << scored << " scored frames (" << (100 * accuracy) << "%), mean absolute error " << (scored ? (static_cast<double>(absolute_error) / scored) : 0.0) << std::endl;
+    if (accuracy < options.getDouble("min-accuracy", 0))
+    {
+      return 2;
+    }
+  }
+  return 0;
+}
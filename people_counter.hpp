@@ -0,0 +1,382 @@
+#ifndef ZAK_PEOPLE_COUNTER_HPP
+#define ZAK_PEOPLE_COUNTER_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+namespace zak
+{
+  /**
+   * \brief Distance (mm) of a raw 11-bit Kinect depth value (0: no reading)
+   *
+   * Disparity is converted with the common first-order fit of the Kinect v1
+   * calibration; it is good to a few percent over the usable range.
+   */
+  inline uint16_t depthMillimeters(uint16_t _raw)
+  {
+    double inverse_m = (3.3309495161 - (0.0030711016 * (_raw & 0x7FF)));
+    double mm = ((inverse_m > 0) ? (1000.0 / inverse_m) : 0);
+    return static_cast<uint16_t>((mm >= 400 && mm <= 10000) ? mm : 0);
+  }
+
+  /**
+   * \brief Raw 11-bit Kinect depth value of a distance (mm), e.g. for
+   *        synthetic scenes
+   */
+  inline uint16_t depthRaw(double _mm)
+  {
+    return static_cast<uint16_t>(std::max(0.0, std::min(2046.0, std::floor(((3.3309495161 - (1000.0 / _mm)) / 0.0030711016) + 0.5))));
+  }
+
+  /**
+   * \brief Counts people from depth alone
+   *
+   * Meant for a sensor looking down on a room (ceiling or high wall mount),
+   * where every head is the nearest point of its surroundings. Each frame is
+   * converted to millimeters and reduced to one cell per `downsample` x
+   * `downsample` pixels (the nearest reading of the block), so the rest of
+   * the pipeline runs on a 160x120 grid at the default factor:
+   *
+   * 1. The background is learned over the first `learn_frames` frames (the
+   *    farthest reading of each cell), then follows slow changes of the
+   *    cells nobody stands on; a cell reading farther than its background
+   *    reveals the real background (something that stood there has left).
+   * 2. Cells nearer than their background by more than `foreground_mm` are
+   *    foreground; a 3x3 opening removes speckle.
+   * 3. Foreground cells are grouped by connected components; a component
+   *    covering less than `min_area_m2` of real surface (its cells scaled by
+   *    their distance) is noise.
+   * 4. Head tops are the local depth minima of each component (nearest
+   *    within `head_window` cells), nearest first; a minimum closer than
+   *    `head_separation_mm` to a head already found in its component is a
+   *    shoulder or the same head.
+   *
+   * A stationary object placed after learning stays foreground (and may be
+   * counted) until `reset()`; a person standing still is still counted.
+   */
+  class PeopleCounter
+  {
+  public:
+    struct Person
+    {
+      cv::Point position;   // head top (full resolution pixels)
+      cv::Rect bounds;      // head, `head_size_mm` across (full resolution pixels)
+      uint16_t distance_mm; // from the sensor to the head top
+      int component;        // people sharing a component touch each other
+    };
+
+    PeopleCounter(void) : _millimeters(2048), _learned(0), _frames(0), _ticks(0), downsample(4), learn_frames(30), foreground_mm(150), adaptation(0.02f), min_area_m2(0.05), head_window(5), head_separation_mm(400), head_size_mm(250), focal_length(585)
+    {
+      for (int raw = 0; raw < 2048; ++raw)
+      {
+        _millimeters[raw] = depthMillimeters(static_cast<uint16_t>(raw));
+      }
+    }
+
+    /**
+     * \brief Count the people of a depth frame
+     *
+     * \param[in] _depth Raw 11-bit depth (`CV_16UC1`, 2047: no reading)
+     * \param[out] _people People found (none while learning the background)
+     * \return Number of people
+     */
+    size_t update(const cv::Mat &_depth, std::vector<Person> &_people)
+    {
+      int64 start = cv::getTickCount();
+      _people.clear();
+      reduce(_depth);
+      if (_background.size() != _cells.size())
+      {
+        _background.create(_cells.size(), CV_32FC1);
+        _background.setTo(cv::Scalar(0));
+        _learned = 0;
+      }
+      if (_learned < learn_frames)
+      {
+        learn();
+        ++_learned;
+      }
+      else
+      {
+        segment();
+        findHeads(_people);
+        adapt();
+      }
+      _ticks += (cv::getTickCount() - start);
+      ++_frames;
+      return _people.size();
+    }
+
+    /**
+     * \brief Forget the background and learn it again
+     */
+    void reset(void)
+    {
+      _background.release();
+      _learned = 0;
+    }
+
+    bool learning(void) const { return (_learned < learn_frames); }
+
+    /**
+     * \brief Foreground cells of the last frame (255), one per `downsample`
+     *        x `downsample` pixels
+     */
+    const cv::Mat &foreground(void) const { return _foreground; }
+
+    /**
+     * \brief Frames counted and mean time per frame (ms) since the last reset
+     */
+    void report(std::ostream &_out) const
+    {
+      _out << "counted " << _frames << " frames (" << (_frames ? ((_ticks * 1e3) / cv::getTickFrequency() / _frames) : 0) << " ms/frame)";
+    }
+
+    void resetCounters(void)
+    {
+      _frames = 0;
+      _ticks = 0;
+    }
+
+  private:
+    struct Component
+    {
+      double area_mm2;
+      bool valid;
+    };
+
+    struct Candidate
+    {
+      uint16_t depth;
+      int x;
+      int y;
+      int label;
+    };
+
+    /**
+     * \brief Millimeters, nearest reading per block (0: no reading)
+     */
+    void reduce(const cv::Mat &_depth)
+    {
+      int factor = std::max(1, downsample);
+      int columns = (_depth.cols / factor), rows = (_depth.rows / factor);
+      _cells.create(rows, columns, CV_16UC1);
+      const uint16_t *millimeters = _millimeters.data();
+      for (int r = 0; r < rows; ++r)
+      {
+        uint16_t *cell = _cells.ptr<uint16_t>(r);
+        std::fill(cell, (cell + columns), 0xFFFF);
+        for (int block_row = 0; block_row < factor; ++block_row)
+        {
+          const uint16_t *raw = _depth.ptr<uint16_t>((r * factor) + block_row);
+          for (int c = 0; c < columns; ++c)
+          {
+            uint16_t nearest = cell[c];
+            for (int i = 0; i < factor; ++i)
+            {
+              uint16_t mm = millimeters[raw[(c * factor) + i] & 0x7FF];
+              nearest = ((mm && mm < nearest) ? mm : nearest);
+            }
+            cell[c] = nearest;
+          }
+        }
+        for (int c = 0; c < columns; ++c)
+        {
+          cell[c] = ((cell[c] == 0xFFFF) ? 0 : cell[c]);
+        }
+      }
+    }
+
+    void learn(void)
+    {
+      for (int r = 0; r < _cells.rows; ++r)
+      {
+        const uint16_t *cell = _cells.ptr<uint16_t>(r);
+        float *background = _background.ptr<float>(r);
+        for (int c = 0; c < _cells.cols; ++c)
+        {
+          background[c] = std::max(background[c], static_cast<float>(cell[c]));
+        }
+      }
+    }
+
+    void segment(void)
+    {
+      _foreground.create(_cells.size(), CV_8UC1);
+      for (int r = 0; r < _cells.rows; ++r)
+      {
+        const uint16_t *cell = _cells.ptr<uint16_t>(r);
+        const float *background = _background.ptr<float>(r);
+        uint8_t *foreground = _foreground.ptr<uint8_t>(r);
+        for (int c = 0; c < _cells.cols; ++c)
+        {
+          foreground[c] = ((cell[c] && background[c] > 0 && (background[c] - cell[c]) > foreground_mm) ? 255 : 0);
+        }
+      }
+      if (_opening.empty())
+      {
+        _opening = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+      }
+      cv::erode(_foreground, _scratch, _opening);
+      cv::dilate(_scratch, _foreground, _opening);
+    }
+
+    /**
+     * \brief Follow slow changes of the background (foreground cells are kept)
+     */
+    void adapt(void)
+    {
+      for (int r = 0; r < _cells.rows; ++r)
+      {
+        const uint16_t *cell = _cells.ptr<uint16_t>(r);
+        const uint8_t *foreground = _foreground.ptr<uint8_t>(r);
+        float *background = _background.ptr<float>(r);
+        for (int c = 0; c < _cells.cols; ++c)
+        {
+          if (!cell[c] || foreground[c])
+          {
+            continue;
+          }
+          float depth = static_cast<float>(cell[c]);
+          bool revealed = (background[c] <= 0 || (depth - background[c]) > foreground_mm);
+          background[c] = (revealed ? depth : (background[c] + (adaptation * (depth - background[c]))));
+        }
+      }
+    }
+
+    void findHeads(std::vector<Person> &_people)
+    {
+      int labels = cv::connectedComponents(_foreground, _labels, 8, CV_32S);
+      if (labels <= 1)
+      {
+        return;
+      }
+
+      // Real surface of each component (a cell at z mm covers (z / f)^2 mm^2)
+      double focal_cells = ((focal_length * _cells.cols) / 640.0); // per cell, at any resolution
+      _components.assign(labels, Component());
+      for (int r = 0; r < _cells.rows; ++r)
+      {
+        const uint16_t *cell = _cells.ptr<uint16_t>(r);
+        const int *label = _labels.ptr<int>(r);
+        for (int c = 0; c < _cells.cols; ++c)
+        {
+          if (label[c])
+          {
+            _components[label[c]].area_mm2 += (static_cast<double>(cell[c]) * cell[c]);
+          }
+        }
+      }
+      bool any_valid = false;
+      for (int label = 1; label < labels; ++label)
+      {
+        Component &component = _components[label];
+        component.area_mm2 /= (focal_cells * focal_cells);
+        component.valid = (component.area_mm2 >= (min_area_m2 * 1e6));
+        any_valid = (any_valid || component.valid);
+      }
+      if (!any_valid)
+      {
+        return;
+      }
+
+      // Local minima (background cells never win)
+      _masked.create(_cells.size(), CV_16UC1);
+      _masked.setTo(cv::Scalar(0xFFFF));
+      _cells.copyTo(_masked, _foreground);
+      if (_window.empty() || _window.cols != head_window)
+      {
+        _window = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(head_window, head_window));
+      }
+      cv::erode(_masked, _minima, _window);
+      _candidates.clear();
+      for (int r = 0; r < _cells.rows; ++r)
+      {
+        const uint16_t *masked = _masked.ptr<uint16_t>(r);
+        const uint16_t *minima = _minima.ptr<uint16_t>(r);
+        const int *label = _labels.ptr<int>(r);
+        for (int c = 0; c < _cells.cols; ++c)
+        {
+          if (label[c] && masked[c] == minima[c] && _components[label[c]].valid)
+          {
+            Candidate candidate;
+            candidate.depth = masked[c];
+            candidate.x = c;
+            candidate.y = r;
+            candidate.label = label[c];
+            _candidates.push_back(candidate);
+          }
+        }
+      }
+
+      // Nearest first; minima near a head of the same component belong to it
+      std::sort(_candidates.begin(), _candidates.end(), [](const Candidate &_a, const Candidate &_b) { return (_a.depth < _b.depth); });
+      _heads.clear();
+      for (auto &candidate : _candidates)
+      {
+        bool separate = true;
+        for (size_t i = 0; separate && i < _heads.size(); ++i)
+        {
+          const Candidate &head = _heads[i];
+          double separation = ((head_separation_mm * focal_cells) / head.depth);
+          int dx = (candidate.x - head.x), dy = (candidate.y - head.y);
+          separate = (head.label != candidate.label || ((dx * dx) + (dy * dy)) >= (separation * separation));
+        }
+        if (separate)
+        {
+          _heads.push_back(candidate);
+        }
+      }
+
+      // Full resolution coordinates
+      int factor = std::max(1, downsample);
+      for (auto &head : _heads)
+      {
+        Person person;
+        person.position = cv::Point(((head.x * factor) + (factor / 2)), ((head.y * factor) + (factor / 2)));
+        int half = std::max(1, cvRound(((head_size_mm * focal_cells * factor) / head.depth) / 2));
+        person.bounds = cv::Rect((person.position.x - half), (person.position.y - half), (2 * half), (2 * half));
+        person.distance_mm = head.depth;
+        person.component = head.label;
+        _people.push_back(person);
+      }
+    }
+
+    std::vector<uint16_t> _millimeters; // raw 11-bit value to mm
+    cv::Mat _cells;
+    cv::Mat _background; // mm (CV_32FC1, 0: unknown)
+    cv::Mat _foreground;
+    cv::Mat _scratch;
+    cv::Mat _opening;
+    cv::Mat _labels;
+    cv::Mat _masked;
+    cv::Mat _minima;
+    cv::Mat _window;
+    std::vector<Component> _components;
+    std::vector<Candidate> _candidates;
+    std::vector<Candidate> _heads;
+    unsigned _learned;
+    uint64_t _frames;
+    int64 _ticks;
+
+  public:
+    int downsample;            // pixels per cell side
+    unsigned learn_frames;     // frames learning the background
+    float foreground_mm;       // least distance in front of the background
+    float adaptation;          // per-frame background blend of cells nobody stands on
+    double min_area_m2;        // least real surface of a person
+    int head_window;           // local minimum window (cells, odd)
+    double head_separation_mm; // least distance between two heads of one component
+    double head_size_mm;       // head box size of a person
+    double focal_length;       // depth camera focal length (pixels at 640 columns)
+  };
+} // namespace zak
+
+#endif // ZAK_PEOPLE_COUNTER_HPP
@@ -0,0 +1,65 @@
+#ifndef ZAK_PHASE_TIMER_HPP
+#define ZAK_PHASE_TIMER_HPP
+
+// C/C++ Libraries
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace zak
+{
+  /**
+   * \brief Records the duration of consecutive named phases
+   *
+   * Each call to `mark` closes the phase that began at the previous mark (or
+   * at construction) and labels it.
+   */
+  class PhaseTimer
+  {
+  public:
+    PhaseTimer(void) : _start(std::chrono::steady_clock::now()), _last(_start) {}
+
+    /**
+     * \brief Close the current phase
+     *
+     * \return Duration of the phase in milliseconds
+     */
+    double mark(const std::string &_phase)
+    {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      double elapsed_ms = std::chrono::duration<double, std::milli>(now - _last).count();
+      _phases.push_back(std::make_pair(_phase, elapsed_ms));
+      _last = now;
+      return elapsed_ms;
+    }
+
+    /**
+     * \brief Milliseconds since construction
+     */
+    double total(void) const
+    {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+    void report(std::ostream &_out, const std::string &_title) const
+    {
+      _out << _title << ":";
+      for (size_t i = 0; i < _phases.size(); ++i)
+      {
+        _out << (i ? " |" : "") << " " << _phases[i].first << " " << std::fixed << std::setprecision(1) << _phases[i].second << " ms";
+      }
+      _out << " | total " << std::fixed << std::setprecision(1) << std::chrono::duration<double, std::milli>(_last - _start).count() << " ms" << std::endl;
+      _out.unsetf(std::ios_base::floatfield);
+    }
+
+  private:
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::time_point _last;
+    std::vector<std::pair<std::string, double> > _phases;
+  };
+} // namespace zak
+
+#endif // ZAK_PHASE_TIMER_HPP
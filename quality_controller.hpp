@@ -0,0 +1,171 @@
+#ifndef ZAK_QUALITY_CONTROLLER_HPP
+#define ZAK_QUALITY_CONTROLLER_HPP
+
+// C/C++ Libraries
+#include <ostream>
+#include <vector>
+
+// Local Libraries
+#include "face_detector.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Feedback controller that trades detection quality for frame rate
+   *
+   * The controller walks a ladder of `DetectorSettings`, ordered from the most
+   * thorough (level 0) to the cheapest. Per-frame detection latency is smoothed
+   * with an exponentially weighted moving average and compared to the budget:
+   *
+   * - above the budget for `degrade_frames` consecutive frames: step down
+   * - below `upgrade_ratio` of the budget for `upgrade_frames` consecutive
+   *   frames: step up
+   * - after any change the controller holds for `settle_frames` frames, so
+   *   the average reflects the new settings before it acts again
+   *
+   * The asymmetric thresholds provide hysteresis and prevent oscillation
+   * between adjacent levels.
+   */
+  class QualityController
+  {
+  public:
+    /**
+     * \param[in] _budget_ms Detection latency target per frame (<= 0 disables
+     *                       the controller; level `_initial_level` is kept)
+     * \param[in] _initial_level Starting rung of the ladder
+     */
+    QualityController(double _budget_ms, size_t _initial_level = 1)
+        : _budget_ms(_budget_ms),
+          _level(_initial_level),
+          _average_ms(0),
+          _over_count(0),
+          _under_count(0),
+          _settle_count(0),
+          _changes(0),
+          degrade_frames(3),
+          upgrade_frames(30),
+          settle_frames(15),
+          upgrade_ratio(0.6),
+          smoothing(0.2)
+    {
+      _ladder.push_back(rung(1.0f, 1.10, 30, 1));
+      _ladder.push_back(rung(1.5f, 1.10, 38, 1)); // historical default
+      _ladder.push_back(rung(2.0f, 1.15, 48, 1));
+      _ladder.push_back(rung(2.5f, 1.20, 60, 1));
+      _ladder.push_back(rung(3.0f, 1.25, 72, 2));
+      _ladder.push_back(rung(3.0f, 1.30, 72, 3));
+
+      if (_level >= _ladder.size())
+      {
+        _level = (_ladder.size() - 1);
+      }
+    }
+
+    /**
+     * \brief Feed the cost of one detection pass
+     *
+     * \param[in] _latency_ms Detection latency amortized over the frames it
+     *                        covers (latency / `detect_interval`)
+     * \return true when the settings changed
+     */
+    bool update(double _latency_ms)
+    {
+      _average_ms = (_average_ms ? (((1.0 - smoothing) * _average_ms) + (smoothing * _latency_ms)) : _latency_ms);
+      if (_budget_ms <= 0)
+      {
+        return false;
+      }
+      if (_settle_count)
+      {
+        --_settle_count;
+        return false;
+      }
+
+      if (_average_ms > _budget_ms)
+      {
+        _under_count = 0;
+        if (++_over_count >= degrade_frames && (_level + 1) < _ladder.size())
+        {
+          return change(_level + 1);
+        }
+      }
+      else if (_average_ms < (_budget_ms * upgrade_ratio))
+      {
+        _over_count = 0;
+        if (++_under_count >= upgrade_frames && _level > 0)
+        {
+          return change(_level - 1);
+        }
+      }
+      else
+      {
+        _over_count = _under_count = 0;
+      }
+      return false;
+    }
+
+    const DetectorSettings &settings(void) const { return _ladder[_level]; }
+    size_t level(void) const { return _level; }
+    size_t levels(void) const { return _ladder.size(); }
+    double averageMs(void) const { return _average_ms; }
+    double budgetMs(void) const { return _budget_ms; }
+    unsigned changes(void) const { return _changes; }
+
+    /**
+     * \brief Print the active settings (for the stats output)
+     */
+    void report(std::ostream &_out) const
+    {
+      const DetectorSettings &active = settings();
+      _out << "quality " << _level << "/" << (_ladder.size() - 1)
+           << " (scale " << active.image_scale
+           << ", step " << active.scale_factor
+           << ", min face " << active.min_face
+           << ", interval " << active.detect_interval
+           << ", detect " << _average_ms << " ms";
+      if (_budget_ms > 0)
+      {
+        _out << " of " << _budget_ms << " ms";
+      }
+      _out << ")";
+    }
+
+  private:
+    std::vector<DetectorSettings> _ladder;
+    double _budget_ms;
+    size_t _level;
+    double _average_ms;
+    unsigned _over_count;
+    unsigned _under_count;
+    unsigned _settle_count;
+    unsigned _changes;
+
+    static DetectorSettings rung(float _image_scale, double _scale_factor, int _min_face, int _detect_interval)
+    {
+      DetectorSettings settings = defaultDetectorSettings();
+      settings.image_scale = _image_scale;
+      settings.scale_factor = _scale_factor;
+      settings.min_face = _min_face;
+      settings.detect_interval = _detect_interval;
+      return settings;
+    }
+
+    bool change(size_t _new_level)
+    {
+      _level = _new_level;
+      _over_count = _under_count = 0;
+      _settle_count = settle_frames;
+      ++_changes;
+      return true;
+    }
+
+  public:
+    unsigned degrade_frames;
+    unsigned upgrade_frames;
+    unsigned settle_frames;
+    double upgrade_ratio;
+    double smoothing;
+  };
+} // namespace zak
+
+#endif // ZAK_QUALITY_CONTROLLER_HPP
@@ -0,0 +1,135 @@
+// C/C++ Libraries
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "cascade_loader.hpp"
+#include "face_detector.hpp"
+#include "options.hpp"
+#include "quality_controller.hpp"
+
+/*
+ * Quality controller replay
+ *
+ * Replays recorded footage through the detection path as if it were arriving
+ * live from the Kinect: frame `i` arrives at `i / fps` seconds, and a frame
+ * arriving while the detector is still busy is dropped. The adaptive quality
+ * controller sees the same latencies it would see in `head_hunter`, so its
+ * behavior (and the fixed-quality baseline, via `--quality=N` without a
+ * target) can be compared on identical input.
+ *
+ * Usage: quality_replay <video file | "image glob*"> [--fps=30]
+ *            [--target-fps=N | --target-latency-ms=N] [--quality=1]
+ *            [--cascade=<xml>] [--cascade-cache=<yml>]
+ */
+int main(int argc, char **argv)
+{
+  zak::Options options(argc, argv);
+  if (options.positional().empty())
+  {
+    std::cerr << "Usage: " << argv[0] << " <video file | \"image glob*\"> [--fps=30] [--target-fps=N | --target-latency-ms=N] [--quality=1]" << std::endl;
+    return 1;
+  }
+
+  // Open footage
+  std::string source = options.positional()[0];
+  std::vector<cv::String> images;
+  cv::VideoCapture video;
+  if (source.find('*') != std::string::npos)
+  {
+    cv::glob(source, images);
+  }
+  else if (!video.open(source))
+  {
+    std::cerr << "Unable to open " << source << std::endl;
+    return 1;
+  }
+  double fps = options.getDouble("fps", (video.isOpened() && video.get(cv::CAP_PROP_FPS) > 0) ? video.get(cv::CAP_PROP_FPS) : 30);
+
+  // Prepare the detector exactly as `head_hunter` does
+  cv::CascadeClassifier cascade;
+  bool from_cache;
+  if (zak::loadCascade(cascade, options.get("cascade", "/usr/local/share/opencv4/haarcascades/haarcascade_frontalface_alt2.xml"), options.get("cascade-cache", ""), from_cache))
+  {
+    return 1;
+  }
+  zak::FaceDetector detector(cascade);
+  double budget_ms = options.getDouble("target-latency-ms", 0);
+  if (options.has("target-fps"))
+  {
+    budget_ms = (750.0 / options.getDouble("target-fps", 30));
+  }
+  zak::QualityController quality(budget_ms, options.getInt("quality", 1));
+
+  // Replay
+  cv::Mat frame;
+  std::vector<cv::Rect> faces;
+  std::vector<uint64_t> frames_per_level(quality.levels(), 0);
+  uint64_t arrived = 0, processed = 0, dropped = 0, detections = 0;
+  uint64_t second_processed = 0, second_dropped = 0, second_faces = 0;
+  double busy_until_s = 0, total_detect_ms = 0;
+  std::cout << "second,processed,dropped,level,image_scale,scale_factor,min_face,interval,detect_ms,faces" << std::endl;
+  for (;;)
+  {
+    if (video.isOpened() ? !video.read(frame) : (arrived >= images.size() || (frame = cv::imread(images[arrived])).empty()))
+    {
+      break;
+    }
+    double arrival_s = (arrived / fps);
+    ++arrived;
+
+    // A busy detector misses live frames
+    if (arrival_s < busy_until_s)
+    {
+      ++dropped;
+      ++second_dropped;
+    }
+    else
+    {
+      const zak::DetectorSettings &settings = quality.settings();
+      double cost_ms = 0;
+      if (!(processed % settings.detect_interval))
+      {
+        int64 start = cv::getTickCount();
+        detector.detect(frame, settings, faces);
+        cost_ms = (((cv::getTickCount() - start) * 1000.0) / cv::getTickFrequency());
+        quality.update(cost_ms / settings.detect_interval);
+        total_detect_ms += cost_ms;
+        ++detections;
+      }
+      busy_until_s = (arrival_s + (cost_ms / 1000.0));
+      ++frames_per_level[quality.level()];
+      ++processed;
+      ++second_processed;
+      second_faces += faces.size();
+    }
+
+    // Report once per second of footage
+    if (!(arrived % static_cast<uint64_t>(fps + 0.5)))
+    {
+      const zak::DetectorSettings &settings = quality.settings();
+      std::cout << static_cast<uint64_t>(arrival_s) << "," << second_processed << "," << second_dropped << "," << quality.level()
+                << "," << settings.image_scale << "," << settings.scale_factor << "," << settings.min_face << "," << settings.detect_interval
+                << "," << quality.averageMs() << "," << (second_processed ? (static_cast<double>(second_faces) / second_processed) : 0) << std::endl;
+      second_processed = second_dropped = second_faces = 0;
+    }
+  }
+
+  // Summary
+  std::cerr << "frames " << arrived << ", processed " << processed << " (" << std::fixed << std::setprecision(1)
+            << (arrived ? ((100.0 * processed) / arrived) : 0) << "%), dropped " << dropped
+            << ", mean detect " << (detections ? (total_detect_ms / detections) : 0) << " ms"
+            << ", effective " << (arrived ? ((processed * fps) / arrived) : 0) << " fps"
+            << ", level changes " << quality.changes() << std::endl;
+  for (size_t level = 0; level < frames_per_level.size(); ++level)
+  {
+    std::cerr << "  level " << level << ": " << frames_per_level[level] << " frames" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,274 @@
+#ifndef ZAK_RECORDING_SINK_HPP
+#define ZAK_RECORDING_SINK_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "background_writer.hpp"
+#include "frame_kernels.hpp"
+#include "spsc_ring.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Continuous recording of annotated video around face sightings
+   *
+   * The detection thread submits every frame with its overlay. A background
+   * writer draws the overlay onto its copy of the frame and keeps the last
+   * `pre-roll` seconds as JPEG frames in a ring; when a face appears it
+   * writes the ring, then the live frames, to a new video file
+   * (Motion JPEG in AVI, which OpenCV writes without external codecs) and
+   * closes it once no face has been seen for `post-roll` seconds.
+   *
+   * `submit` copies the frame into one of a fixed set of slots and queues it
+   * through a wait-free ring; it never waits on the writer. When the writer
+   * falls behind and no slot is free, the frame is dropped and counted.
+   * Slots, the JPEG ring and its buffers are allocated once, so memory stays
+   * fixed (a JPEG buffer only grows to the largest frame it has held).
+   */
+  class RecordingSink
+  {
+  public:
+    RecordingSink(void) : _fps_value(0), _pre_roll_next(0), _pre_roll_count(0), _post_roll_ticks(0), _last_face_tick(0), _dropped(0), _recordings(0), _recording(false), jpeg_quality(80), messages(&std::cout) {}
+
+    ~RecordingSink(void)
+    {
+      close();
+    }
+
+    /**
+     * \brief Allocate the buffers and start the writer thread
+     *
+     * \param[in] _directory Where recordings are written (`recording-<time>.avi`)
+     * \param[in] _size Video frame size (`CV_8UC3`)
+     * \param[in] _fps Frame rate of the recordings (and of the pre-roll ring)
+     * \param[in] _pre_roll_s Seconds kept before a face appears
+     * \param[in] _post_roll_s Seconds recorded after the last face
+     * \return 0 on success, -1 on failure
+     */
+    int open(const std::string &_directory, cv::Size _size, double _fps, double _pre_roll_s, double _post_roll_s)
+    {
+      close();
+      if (_fps <= 0 || _pre_roll_s < 0 || _post_roll_s < 0)
+      {
+        std::cerr << "Invalid recording frame rate or pre/post-roll" << std::endl;
+        return -1;
+      }
+      _directory_path = _directory;
+      _fps_value = _fps;
+      _frame_size = _size;
+      _post_roll_ticks = static_cast<int64>(_post_roll_s * cv::getTickFrequency());
+
+      for (size_t i = 0; i < FRAME_SLOTS; ++i)
+      {
+        _slots[i].image.create(_size, CV_8UC3);
+      }
+      if (!_free.size())
+      {
+        // First open; afterwards the writer returns every slot before it stops
+        for (size_t i = 0; i < FRAME_SLOTS; ++i)
+        {
+          _free.tryPush(i);
+        }
+      }
+      _pre_roll.assign(static_cast<size_t>(_pre_roll_s * _fps), std::vector<uchar>());
+      for (auto &jpeg : _pre_roll)
+      {
+        jpeg.reserve((_size.area() * 3) / 8);
+      }
+      _pre_roll_next = _pre_roll_count = 0;
+      _jpeg_parameters.assign(1, cv::IMWRITE_JPEG_QUALITY);
+      _jpeg_parameters.push_back(jpeg_quality);
+
+      _writer.start([this]() { return drain(); });
+      return 0;
+    }
+
+    /**
+     * \brief Finish the current recording and stop the writer
+     */
+    void close(void)
+    {
+      _writer.stop();
+      stop();
+    }
+
+    /**
+     * \brief The writer thread (valid while open; for placement)
+     */
+    pthread_t writerThread(void)
+    {
+      return _writer.thread();
+    }
+
+    bool isOpen(void) const
+    {
+      return _writer.isRunning();
+    }
+
+    /**
+     * \brief Queue a frame (detection thread; never blocks)
+     *
+     * \param[in] _faces_present Whether the frame shows a face (starts or
+     *                           extends a recording)
+     * \param[in] _overlay Annotations drawn onto the recorded copy (nullptr: none)
+     * \return false if the writer was behind and the frame was dropped
+     */
+    bool submit(const cv::Mat &_bgr_image, bool _faces_present, const FrameOverlay *_overlay = nullptr)
+    {
+      size_t slot;
+      if (_bgr_image.size() != _frame_size || !_free.tryPop(slot))
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      _bgr_image.copyTo(_slots[slot].image);
+      _slots[slot].tick = cv::getTickCount();
+      _slots[slot].faces_present = _faces_present;
+      if (_overlay)
+      {
+        _slots[slot].overlay = *_overlay;
+      }
+      else
+      {
+        _slots[slot].overlay.clear();
+      }
+      _pending.tryPush(slot); // Cannot fail: there are no more slots than ring entries
+      _writer.notify();
+      return true;
+    }
+
+    uint64_t dropped(void) const { return _dropped.load(std::memory_order_relaxed); }
+    uint64_t recordings(void) const { return _recordings.load(std::memory_order_relaxed); }
+    bool recording(void) const { return _recording.load(std::memory_order_relaxed); }
+
+  private:
+    static const size_t FRAME_SLOTS = 4;
+
+    struct FrameSlot
+    {
+      cv::Mat image;
+      int64 tick;
+      bool faces_present;
+      FrameOverlay overlay;
+    };
+
+    std::string _directory_path;
+    double _fps_value;
+    cv::Size _frame_size;
+    FrameSlot _slots[FRAME_SLOTS];
+    SpscRing<size_t, FRAME_SLOTS> _pending; // detection thread -> writer
+    SpscRing<size_t, FRAME_SLOTS> _free;    // writer -> detection thread
+    std::vector<std::vector<uchar> > _pre_roll;
+    size_t _pre_roll_next;
+    size_t _pre_roll_count;
+    int64 _post_roll_ticks;
+    int64 _last_face_tick;
+    cv::VideoWriter _video;
+    cv::Mat _decoded;
+    std::vector<int> _jpeg_parameters;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<uint64_t> _recordings;
+    std::atomic<bool> _recording;
+    BackgroundWriter _writer; // last: stopped before the members it drains are destroyed
+
+    /**
+     * \brief Write the queued frames (writer thread)
+     *
+     * \return Whether there were any
+     */
+    bool drain(void)
+    {
+      size_t slot;
+      bool found = false;
+      while (_pending.tryPop(slot))
+      {
+        write(_slots[slot]);
+        _free.tryPush(slot);
+        found = true;
+      }
+      return found;
+    }
+
+    void write(FrameSlot &_frame)
+    {
+      drawOverlay(_frame.image, _frame.overlay);
+      if (_frame.faces_present)
+      {
+        _last_face_tick = _frame.tick;
+        if (!_video.isOpened())
+        {
+          start();
+        }
+      }
+      else if (_video.isOpened() && (_frame.tick - _last_face_tick) > _post_roll_ticks)
+      {
+        stop();
+      }
+
+      if (_video.isOpened())
+      {
+        _video.write(_frame.image);
+      }
+      else if (!_pre_roll.empty())
+      {
+        cv::imencode(".jpg", _frame.image, _pre_roll[_pre_roll_next], _jpeg_parameters);
+        _pre_roll_next = ((_pre_roll_next + 1) % _pre_roll.size());
+        _pre_roll_count = std::min((_pre_roll_count + 1), _pre_roll.size());
+      }
+    }
+
+    /**
+     * \brief Open a new recording and flush the pre-roll into it (oldest first)
+     */
+    void start(void)
+    {
+      char stamp[32];
+      time_t now = time(nullptr);
+      strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+      std::string path = (_directory_path + "/recording-" + stamp + ".avi");
+      if (!_video.open(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), _fps_value, _frame_size))
+      {
+        std::cerr << "Cannot open recording " << path << std::endl;
+        return;
+      }
+      *messages << "Recording " << path << std::endl;
+      _recording.store(true, std::memory_order_relaxed);
+      _recordings.fetch_add(1, std::memory_order_relaxed);
+
+      size_t oldest = ((_pre_roll_next + _pre_roll.size() - _pre_roll_count) % std::max<size_t>(_pre_roll.size(), 1));
+      for (size_t i = 0; i < _pre_roll_count; ++i)
+      {
+        cv::imdecode(_pre_roll[(oldest + i) % _pre_roll.size()], cv::IMREAD_COLOR, &_decoded);
+        _video.write(_decoded);
+      }
+      _pre_roll_count = 0;
+    }
+
+    void stop(void)
+    {
+      if (_video.isOpened())
+      {
+        _video.release();
+        _recording.store(false, std::memory_order_relaxed);
+      }
+    }
+
+  public:
+    int jpeg_quality;       // pre-roll JPEG quality (0-100; set before `open`)
+    std::ostream *messages; // where new recordings are announced (set before `open`)
+  };
+} // namespace zak
+
+#endif // ZAK_RECORDING_SINK_HPP
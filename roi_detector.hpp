@@ -0,0 +1,238 @@
+#ifndef ZAK_ROI_DETECTOR_HPP
+#define ZAK_ROI_DETECTOR_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <vector>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "frame_cache.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Two-level face detection for high resolution frames
+   *
+   * Downscaling a 1280x1024 frame for the cascade loses distant faces, and
+   * scanning it at full resolution is far too slow. Instead:
+   *
+   * 1. Coarse pass: the frame is downscaled by `coarse_scale`; the cascade
+   *    finds near faces there, and the difference with the previous coarse
+   *    frame yields motion candidates.
+   * 2. Fine pass: candidates (motion, faces found on the previous frame and
+   *    one tile of a slow round-robin sweep, so still people are eventually
+   *    found too) are padded, merged and scanned at full resolution for faces
+   *    down to `fine_min_face` pixels, too small for the coarse pass.
+   *
+   * Fine regions are views into one full resolution grayscale buffer (the
+   * frame cache's, if another pass already converted the frame; otherwise
+   * only the pixels inside regions are converted). Nothing is copied.
+   */
+  class RoiDetector
+  {
+  public:
+    RoiDetector(cv::CascadeClassifier &_cascade)
+        : _cascade(_cascade),
+          _sweep_index(0),
+          _fine_fraction(0),
+          coarse_scale(4.0f),
+          fine_min_face(20),
+          margin(0.5),
+          motion_threshold(24),
+          max_motion_fraction(0.4),
+          sweep_tiles(4) {}
+
+    /**
+     * \brief Detect faces in a BGR video frame
+     *
+     * \param[in] _bgr_image Video frame (full resolution)
+     * \param[in] _settings Pyramid step and grouping threshold (the image scale
+     *                      and minimum face size are replaced by the two passes)
+     * \param[out] _faces Detections, in pixels of the video frame
+     */
+    void detect(const cv::Mat &_bgr_image, const DetectorSettings &_settings, std::vector<cv::Rect> &_faces)
+    {
+      _own_frame.reset(_bgr_image);
+      detect(_own_frame, _settings, _faces);
+    }
+
+    /**
+     * \brief Detect faces in a cached frame (shares preprocessing with other passes)
+     */
+    void detect(FrameCache &_frame, const DetectorSettings &_settings, std::vector<cv::Rect> &_faces)
+    {
+      cv::Rect frame(cv::Point(0, 0), _frame.size());
+      int coarse_window = cvRound(20 * coarse_scale); // Smallest face the coarse pass can see
+      _faces.clear();
+
+      // Coarse pass
+      _frame.level(coarse_scale, cv::INTER_AREA).copyTo(_coarse_grayscale);
+      _cascade.detectMultiScale(_coarse_grayscale, _coarse_faces, _settings.scale_factor, _settings.min_neighbors, 0, cv::Size(20, 20));
+      for (auto &face : _coarse_faces)
+      {
+        _faces.push_back(upscaleRect(face, coarse_scale) & frame);
+      }
+
+      // Motion candidates (a global change, e.g. while tilting, is ignored)
+      _candidates.clear();
+      if (_previous_grayscale.size() == _coarse_grayscale.size())
+      {
+        cv::absdiff(_coarse_grayscale, _previous_grayscale, _motion);
+        cv::threshold(_motion, _motion, motion_threshold, 255, cv::THRESH_BINARY);
+        cv::dilate(_motion, _motion, cv::Mat(), cv::Point(-1, -1), 2);
+        cv::findContours(_motion, _contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        double motion_area = 0;
+        for (auto &contour : _contours)
+        {
+          cv::Rect region = pad(upscaleRect(cv::boundingRect(contour), coarse_scale)) & frame;
+          motion_area += region.area();
+          _candidates.push_back(region);
+        }
+        if (motion_area > (max_motion_fraction * frame.area()))
+        {
+          _candidates.clear();
+        }
+      }
+      std::swap(_previous_grayscale, _coarse_grayscale);
+
+      // Faces seen on the previous frame and the next sweep tile
+      for (auto &face : _previous_faces)
+      {
+        _candidates.push_back(pad(face) & frame);
+      }
+      if (sweep_tiles > 0)
+      {
+        int tile = (_sweep_index++ % (sweep_tiles * sweep_tiles));
+        cv::Size tile_size((frame.width + sweep_tiles - 1) / sweep_tiles, (frame.height + sweep_tiles - 1) / sweep_tiles);
+        _candidates.push_back(cv::Rect(cv::Point((tile % sweep_tiles) * tile_size.width, (tile / sweep_tiles) * tile_size.height), tile_size) & frame);
+      }
+      merge(_candidates, _regions);
+
+      // Fine pass on full resolution views (raw frames convert whole, as regions would demosaic or unpack with the wrong phase)
+      bool converted = (_frame.hasGrayscale() || _frame.raw());
+      if (!converted)
+      {
+        _grayscale.create(_frame.size(), CV_8UC1);
+      }
+      const cv::Mat &grayscale = (converted ? _frame.grayscale() : _grayscale);
+      double fine_area = 0;
+      for (auto &region : _regions)
+      {
+        if (region.width < fine_min_face || region.height < fine_min_face)
+        {
+          continue;
+        }
+        cv::Mat grayscale_view = grayscale(region);
+        if (!converted)
+        {
+          cv::cvtColor(_frame.bgr()(region), grayscale_view, cv::COLOR_BGR2GRAY);
+        }
+        _cascade.detectMultiScale(grayscale_view, _region_faces, _settings.scale_factor, _settings.min_neighbors, 0,
+                                  cv::Size(fine_min_face, fine_min_face), cv::Size(coarse_window + (coarse_window / 4), coarse_window + (coarse_window / 4)));
+        for (auto &face : _region_faces)
+        {
+          addFace(cv::Rect((face.x + region.x), (face.y + region.y), face.width, face.height), _faces);
+        }
+        fine_area += region.area();
+      }
+      _fine_fraction = (fine_area / frame.area());
+      _previous_faces = _faces;
+    }
+
+    /**
+     * \brief Regions scanned by the last fine pass
+     */
+    const std::vector<cv::Rect> &regions(void) const { return _regions; }
+
+    /**
+     * \brief Fraction of the last frame scanned at full resolution
+     */
+    double fineFraction(void) const { return _fine_fraction; }
+
+  private:
+    cv::CascadeClassifier &_cascade;
+    FrameCache _own_frame;
+    cv::Mat _coarse_grayscale;
+    cv::Mat _previous_grayscale;
+    cv::Mat _motion;
+    cv::Mat _grayscale;
+    std::vector<std::vector<cv::Point> > _contours;
+    std::vector<cv::Rect> _coarse_faces;
+    std::vector<cv::Rect> _region_faces;
+    std::vector<cv::Rect> _previous_faces;
+    std::vector<cv::Rect> _candidates;
+    std::vector<cv::Rect> _regions;
+    unsigned _sweep_index;
+    double _fine_fraction;
+
+    /**
+     * \brief Grow a candidate so a face at its edge fits the fine pass
+     */
+    cv::Rect pad(const cv::Rect &_candidate) const
+    {
+      int border = std::max((fine_min_face * 2), cvRound(margin * std::max(_candidate.width, _candidate.height)));
+      return cv::Rect((_candidate.x - border), (_candidate.y - border), (_candidate.width + (2 * border)), (_candidate.height + (2 * border)));
+    }
+
+    /**
+     * \brief Union overlapping candidates so no pixel is scanned twice
+     */
+    static void merge(std::vector<cv::Rect> &_candidates, std::vector<cv::Rect> &_merged)
+    {
+      _merged.clear();
+      for (auto &candidate : _candidates)
+      {
+        if (!candidate.area())
+        {
+          continue;
+        }
+        cv::Rect region = candidate;
+        for (size_t i = 0; i < _merged.size();)
+        {
+          if ((region & _merged[i]).area())
+          {
+            // Grown region may now overlap regions already checked; rescan
+            region |= _merged[i];
+            _merged.erase(_merged.begin() + i);
+            i = 0;
+          }
+          else
+          {
+            ++i;
+          }
+        }
+        _merged.push_back(region);
+      }
+    }
+
+    /**
+     * \brief Add a fine pass face unless the coarse pass already found it
+     */
+    static void addFace(const cv::Rect &_face, std::vector<cv::Rect> &_faces)
+    {
+      for (auto &face : _faces)
+      {
+        if (FaceTracker::intersectionOverUnion(_face, face) > 0.3)
+        {
+          return;
+        }
+      }
+      _faces.push_back(_face);
+    }
+
+  public:
+    float coarse_scale;         // coarse pass downscale factor
+    int fine_min_face;          // smallest face of the fine pass (pixels of the video frame)
+    double margin;              // candidate padding, as a fraction of its larger side
+    double motion_threshold;    // coarse grayscale difference counted as motion
+    double max_motion_fraction; // above this share of the frame, motion is global and ignored
+    int sweep_tiles;            // the sweep visits sweep_tiles x sweep_tiles tiles (0 disables)
+  };
+} // namespace zak
+
+#endif // ZAK_ROI_DETECTOR_HPP
@@ -0,0 +1,100 @@
+#ifndef ZAK_SPSC_RING_HPP
+#define ZAK_SPSC_RING_HPP
+
+// C/C++ Libraries
+#include <atomic>
+#include <cstddef>
+
+namespace zak
+{
+  static const size_t CACHE_LINE_BYTES = 64;
+
+  /**
+   * \brief Wait-free single-producer/single-consumer ring buffer
+   *
+   * Exactly one thread may call `tryPush` and exactly one (other) thread may
+   * call `tryPop`. Neither call ever blocks or retries; a full ring rejects the
+   * push and an empty ring rejects the pop. The head and tail indices live on
+   * separate cache lines, each paired with a cached copy of the opposite index,
+   * so the two threads only share a line when the ring is nearly full/empty.
+   *
+   * \tparam T Element type (copy assignable)
+   * \tparam Capacity Number of elements (must be a power of two)
+   */
+  template <typename T, size_t Capacity>
+  class SpscRing
+  {
+    static_assert((Capacity >= 2) && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+
+  public:
+    SpscRing(void) : _head(0), _cached_tail(0), _tail(0), _cached_head(0) {}
+
+    /**
+     * \brief Append an element (producer thread only)
+     *
+     * \return false when the ring is full
+     */
+    bool tryPush(const T &_value)
+    {
+      size_t head = _head.load(std::memory_order_relaxed);
+      if ((head - _cached_tail) == Capacity)
+      {
+        _cached_tail = _tail.load(std::memory_order_acquire);
+        if ((head - _cached_tail) == Capacity)
+        {
+          return false;
+        }
+      }
+      _slots[head & (Capacity - 1)] = _value;
+      _head.store((head + 1), std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * \brief Remove the oldest element (consumer thread only)
+     *
+     * \return false when the ring is empty
+     */
+    bool tryPop(T &_value)
+    {
+      size_t tail = _tail.load(std::memory_order_relaxed);
+      if (tail == _cached_head)
+      {
+        _cached_head = _head.load(std::memory_order_acquire);
+        if (tail == _cached_head)
+        {
+          return false;
+        }
+      }
+      _value = _slots[tail & (Capacity - 1)];
+      _tail.store((tail + 1), std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * \brief Approximate number of queued elements (any thread)
+     */
+    size_t size(void) const
+    {
+      return (_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire));
+    }
+
+    static size_t capacity(void)
+    {
+      return Capacity;
+    }
+
+  private:
+    // Producer cache line
+    alignas(CACHE_LINE_BYTES) std::atomic<size_t> _head;
+    size_t _cached_tail;
+
+    // Consumer cache line
+    alignas(CACHE_LINE_BYTES) std::atomic<size_t> _tail;
+    size_t _cached_head;
+
+    alignas(CACHE_LINE_BYTES) T _slots[Capacity];
+  };
+} // namespace zak
+
+#endif // ZAK_SPSC_RING_HPP
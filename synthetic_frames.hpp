@@ -0,0 +1,78 @@
+#ifndef ZAK_SYNTHETIC_FRAMES_HPP
+#define ZAK_SYNTHETIC_FRAMES_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <cstdint>
+
+// 3rd Party Libraries
+#include <opencv2/opencv.hpp>
+
+// Local Libraries
+#include "people_counter.hpp"
+
+namespace zak
+{
+  /**
+   * \brief Smooth, noisy RGB frame (no faces: the cascade rejects nearly
+   *        every window in its first stages)
+   */
+  inline cv::Mat syntheticVideo(cv::Size _size)
+  {
+    cv::Mat rgb(_size, CV_8UC3);
+    cv::RNG rng(0x5A4B);
+    rng.fill(rgb, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::GaussianBlur(rgb, rgb, cv::Size(7, 7), 0);
+    return rgb;
+  }
+
+  /**
+   * \brief 11-bit depth ramp (near to far, left to right) with sensor noise
+   *        and a band of "no reading" (2047) pixels
+   */
+  inline cv::Mat syntheticDepth(cv::Size _size)
+  {
+    cv::Mat depth(_size, CV_16UC1);
+    cv::RNG rng(0x5A4B);
+    for (int r = 0; r < depth.rows; ++r)
+    {
+      for (int c = 0; c < depth.cols; ++c)
+      {
+        int value = (400 + ((c * 700) / depth.cols) + rng.uniform(-8, 9));
+        depth.at<uint16_t>(r, c) = static_cast<uint16_t>((r < (depth.rows / 16)) ? 2047 : value);
+      }
+    }
+    return depth;
+  }
+
+  /**
+   * \brief Overhead depth of up to four people (one per quadrant, head tops
+   *        1.2-1.35m from the sensor) over a floor 3m away, with sensor noise
+   *        and scattered "no reading" (2047) pixels
+   */
+  inline cv::Mat syntheticOverhead(cv::Size _size, int _people)
+  {
+    cv::Mat millimeters(_size, CV_32FC1, cv::Scalar(3000));
+    const double focal_length = ((585.0 * _size.width) / 640);
+    for (int person = 0; person < std::min(_people, 4); ++person)
+    {
+      cv::Point head((((1 + (2 * (person % 2))) * _size.width) / 4), (((1 + (2 * (person / 2))) * _size.height) / 4));
+      double top = (1200 + (50 * person)), shoulders = (top + 250);
+      int shoulder_radius = cvRound((230 * focal_length) / shoulders);
+      cv::ellipse(millimeters, head, cv::Size(shoulder_radius, ((shoulder_radius * 11) / 20)), 0, 0, 360, cv::Scalar(shoulders), cv::FILLED);
+      cv::circle(millimeters, head, cvRound((100 * focal_length) / top), cv::Scalar(top), cv::FILLED);
+    }
+    cv::Mat depth(_size, CV_16UC1);
+    cv::RNG rng(0x5A4B);
+    for (int r = 0; r < depth.rows; ++r)
+    {
+      for (int c = 0; c < depth.cols; ++c)
+      {
+        depth.at<uint16_t>(r, c) = ((rng.uniform(0, 100) == 0) ? 2047 : depthRaw(millimeters.at<float>(r, c) + rng.uniform(-8, 9)));
+      }
+    }
+    return depth;
+  }
+} // namespace zak
+
+#endif // ZAK_SYNTHETIC_FRAMES_HPP
@@ -0,0 +1,254 @@
+#ifndef ZAK_THREAD_PLACEMENT_HPP
+#define ZAK_THREAD_PLACEMENT_HPP
+
+// C/C++ Libraries
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ios>
+#include <mutex>
+#include <ostream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+#include <time.h>
+#include <vector>
+
+namespace zak
+{
+  /**
+   * \brief Parse a CPU list such as "0", "1-3" or "0,2-3"
+   *
+   * \return 0 on success, -1 on a malformed list
+   */
+  inline int parseCpuList(const std::string &_list, std::vector<int> &_cpus)
+  {
+    _cpus.clear();
+    size_t begin = 0;
+    while (begin < _list.size())
+    {
+      size_t end = _list.find(',', begin);
+      std::string range = _list.substr(begin, (end == std::string::npos) ? std::string::npos : (end - begin));
+      char *cursor = nullptr;
+      long first = std::strtol(range.c_str(), &cursor, 10);
+      long last = first;
+      if (cursor == range.c_str())
+      {
+        return -1;
+      }
+      if (*cursor == '-')
+      {
+        const char *second = (cursor + 1);
+        last = std::strtol(second, &cursor, 10);
+        if (cursor == second)
+        {
+          return -1;
+        }
+      }
+      if (*cursor || first < 0 || last < first || last >= CPU_SETSIZE)
+      {
+        return -1;
+      }
+      for (long cpu = first; cpu <= last; ++cpu)
+      {
+        _cpus.push_back(static_cast<int>(cpu));
+      }
+      begin = ((end == std::string::npos) ? _list.size() : (end + 1));
+    }
+    return 0;
+  }
+
+  /**
+   * \brief Lock current and future pages (frame buffers never page out)
+   *
+   * \return 0 on success, -1 on failure (e.g. without CAP_IPC_LOCK or a large
+   *         enough RLIMIT_MEMLOCK)
+   */
+  inline int lockMemory(std::ostream &_log)
+  {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE))
+    {
+      _log << "mlockall() failed: " << std::strerror(errno) << std::endl;
+      return -1;
+    }
+    return 0;
+  }
+
+  /**
+   * \brief Places threads on CPUs and reports where they run and what they cost
+   *
+   * `place` pins a thread to a CPU list and optionally gives it SCHED_FIFO
+   * priority; an empty list leaves the affinity alone, so every thread can be
+   * registered for CPU time reporting whether or not it is placed. Threads
+   * created by a placed thread (e.g. OpenCV's `parallel_for_` pool, started on
+   * first use) inherit its affinity.
+   *
+   * Threads register from any thread (the libfreenect event thread registers
+   * itself from its first callback); reports are printed by the main loop.
+   * Registered threads must outlive the registry's last report.
+   */
+  class ThreadRegistry
+  {
+  public:
+    /**
+     * \brief Apply a placement to a thread and register it
+     *
+     * \param[in] _cpus CPUs the thread may run on (empty: unchanged)
+     * \param[in] _fifo_priority SCHED_FIFO priority (1-99; 0: unchanged)
+     * \return 0 on success, -1 if the placement was (partly) refused or the
+     *         thread's CPU clock is unavailable; the thread is registered
+     *         either way (without CPU time when it has no clock)
+     */
+    int place(const std::string &_name, pthread_t _thread, const std::vector<int> &_cpus, int _fifo_priority = 0)
+    {
+      int result = 0;
+      if (!_cpus.empty())
+      {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (auto cpu : _cpus)
+        {
+          CPU_SET(cpu, &cpu_set);
+        }
+        if ((errno = pthread_setaffinity_np(_thread, sizeof(cpu_set), &cpu_set)))
+        {
+          perror(("pthread_setaffinity_np(" + _name + ")").c_str());
+          result = -1;
+        }
+      }
+      if (_fifo_priority > 0)
+      {
+        struct sched_param parameters;
+        std::memset(&parameters, 0, sizeof(parameters));
+        parameters.sched_priority = _fifo_priority;
+        if ((errno = pthread_setschedparam(_thread, SCHED_FIFO, &parameters)))
+        {
+          perror(("pthread_setschedparam(" + _name + ", SCHED_FIFO)").c_str());
+          result = -1;
+        }
+      }
+
+      Entry entry;
+      entry.name = _name;
+      entry.thread = _thread;
+      entry.cpu_ns = entry.wall_ns = 0;
+      entry.has_clock = true;
+      if ((errno = pthread_getcpuclockid(_thread, &entry.clock)))
+      {
+        perror(("pthread_getcpuclockid(" + _name + ")").c_str());
+        entry.has_clock = false;
+        result = -1;
+      }
+      std::lock_guard<std::mutex> lock(_mutex);
+      _threads.push_back(entry);
+      return result;
+    }
+
+    /**
+     * \brief `place` the calling thread
+     */
+    int placeCurrent(const std::string &_name, const std::vector<int> &_cpus, int _fifo_priority = 0)
+    {
+      return place(_name, pthread_self(), _cpus, _fifo_priority);
+    }
+
+    size_t size(void)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _threads.size();
+    }
+
+    /**
+     * \brief Print each thread's effective CPUs and scheduling policy
+     */
+    void report(std::ostream &_out)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto &entry : _threads)
+      {
+        cpu_set_t cpu_set;
+        int policy;
+        struct sched_param parameters;
+        _out << "thread " << entry.name << ": cpus ";
+        if (!pthread_getaffinity_np(entry.thread, sizeof(cpu_set), &cpu_set))
+        {
+          const char *separator = "";
+          for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+          {
+            if (CPU_ISSET(cpu, &cpu_set))
+            {
+              _out << separator << cpu;
+              separator = ",";
+            }
+          }
+        }
+        if (!pthread_getschedparam(entry.thread, &policy, &parameters))
+        {
+          _out << ", " << ((policy == SCHED_FIFO) ? "SCHED_FIFO" : (policy == SCHED_RR) ? "SCHED_RR" : "SCHED_OTHER") << " priority " << parameters.sched_priority;
+        }
+        _out << std::endl;
+      }
+    }
+
+    /**
+     * \brief Print each thread's CPU use since the previous call (percent of one CPU)
+     */
+    void reportCpuTime(std::ostream &_out)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      uint64_t wall_ns = nanoseconds(CLOCK_MONOTONIC);
+      std::ios_base::fmtflags flags = _out.flags();
+      std::streamsize precision = _out.precision(1);
+      const char *separator = "";
+      for (auto &entry : _threads)
+      {
+        _out << separator << entry.name << " ";
+        separator = ", ";
+        if (!entry.has_clock)
+        {
+          _out << "n/a";
+          continue;
+        }
+        uint64_t cpu_ns = nanoseconds(entry.clock);
+        if (entry.wall_ns && wall_ns > entry.wall_ns)
+        {
+          _out << std::fixed << ((100.0 * (cpu_ns - entry.cpu_ns)) / (wall_ns - entry.wall_ns)) << "%";
+        }
+        else
+        {
+          _out << (cpu_ns / 1000000) << " ms";
+        }
+        entry.cpu_ns = cpu_ns;
+        entry.wall_ns = wall_ns;
+      }
+      _out.flags(flags);
+      _out.precision(precision);
+    }
+
+  private:
+    struct Entry
+    {
+      std::string name;
+      pthread_t thread;
+      clockid_t clock;
+      bool has_clock; // false: CPU time is not reported
+      uint64_t cpu_ns;
+      uint64_t wall_ns;
+    };
+
+    std::mutex _mutex;
+    std::vector<Entry> _threads;
+
+    static uint64_t nanoseconds(clockid_t _clock)
+    {
+      struct timespec now;
+      clock_gettime(_clock, &now);
+      return ((static_cast<uint64_t>(now.tv_sec) * 1000000000ull) + now.tv_nsec);
+    }
+  };
+} // namespace zak
+
+#endif // ZAK_THREAD_PLACEMENT_HPP
@@ -0,0 +1,294 @@
+#ifndef ZAK_TRACE_HPP
+#define ZAK_TRACE_HPP
+
+// C/C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace zak
+{
+  /**
+   * \brief Per-thread span recorder with Chrome trace-event export
+   *
+   * Aggregate statistics hide stalls that come from threads interacting (a
+   * slow USB control transfer on the event thread, a display call holding up
+   * the main loop); a timeline of every stage shows them. Each thread records
+   * completed spans (name, start, duration, frame sequence) into a ring of its
+   * own, so recording takes no lock and touches no shared cache line: two
+   * monotonic clock reads and one 24-byte store per span. Rings keep the last
+   * `events_per_thread` spans and wrap silently.
+   *
+   * `dump` writes every ring as Chrome trace-event JSON (complete "X"
+   * events, one track per thread), which Perfetto and chrome://tracing open.
+   * It may run while threads keep recording: entries the writers overwrote
+   * during the copy are discarded.
+   *
+   * Disabled (the default), a span costs one relaxed load. There is one
+   * tracer per process, `tracer()`.
+   */
+  class Tracer
+  {
+  public:
+    Tracer(void) : _enabled(false), _capacity(0), _dump_requested(false) {}
+
+    /**
+     * \brief Start recording (call once, before the threads to trace start
+     *        recording)
+     *
+     * \param[in] _events_per_thread Ring size (rounded up to a power of two)
+     */
+    void enable(size_t _events_per_thread)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _capacity = 1;
+      while (_capacity < _events_per_thread)
+      {
+        _capacity <<= 1;
+      }
+      for (auto &buffer : _buffers)
+      {
+        buffer->events.resize(_capacity);
+      }
+      _enabled.store(true, std::memory_order_release);
+    }
+
+    bool enabled(void) const
+    {
+      return _enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Name the calling thread's track (e.g. "capture")
+     */
+    void nameThread(const std::string &_name)
+    {
+      ThreadBuffer &buffer = threadBuffer();
+      std::lock_guard<std::mutex> lock(_mutex);
+      buffer.name = _name;
+    }
+
+    /**
+     * \brief Record a completed span of the calling thread
+     *
+     * \param[in] _name Stage name; must outlive the tracer (a string literal)
+     * \param[in] _sequence Frame the span worked on (0: none)
+     */
+    void record(const char *_name, uint64_t _start_ns, uint64_t _end_ns, uint64_t _sequence)
+    {
+      ThreadBuffer &buffer = threadBuffer();
+      if (buffer.events.empty())
+      {
+        return;
+      }
+      uint64_t head = buffer.head.load(std::memory_order_relaxed);
+      Event &event = buffer.events[head & (buffer.events.size() - 1)];
+      event.name = _name;
+      event.start_ns = _start_ns;
+      event.duration_ns = static_cast<uint32_t>(std::min<uint64_t>((_end_ns - _start_ns), UINT32_MAX));
+      event.sequence = static_cast<uint32_t>(_sequence);
+      buffer.head.store((head + 1), std::memory_order_release);
+    }
+
+    /**
+     * \brief Ask for a dump from a signal handler (async-signal-safe)
+     */
+    void requestDump(void)
+    {
+      _dump_requested.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Whether a dump was requested since the last call
+     */
+    bool takeDumpRequest(void)
+    {
+      return _dump_requested.exchange(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Write the recorded spans as Chrome trace-event JSON
+     *
+     * \return Spans written, or -1 on failure
+     */
+    long dump(const std::string &_path)
+    {
+      FILE *out = std::fopen(_path.c_str(), "w");
+      if (!out)
+      {
+        perror(_path.c_str());
+        return -1;
+      }
+      std::lock_guard<std::mutex> lock(_mutex);
+      long written = 0;
+      int pid = static_cast<int>(getpid());
+      const char *separator = "";
+      std::vector<Event> events;
+      std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+      for (auto &buffer : _buffers)
+      {
+        std::fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"", separator, pid, buffer->tid);
+        writeEscaped(out, (buffer->name.empty() ? ("thread " + std::to_string(buffer->tid)) : buffer->name));
+        std::fprintf(out, "\"}}");
+        separator = ",";
+
+        // Copy the ring, then drop what was overwritten meanwhile
+        size_t capacity = buffer->events.size();
+        if (!capacity)
+        {
+          continue;
+        }
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = ((head > capacity) ? (head - capacity) : 0);
+        events.clear();
+        for (uint64_t i = first; i < head; ++i)
+        {
+          events.push_back(buffer->events[i & (capacity - 1)]);
+        }
+        uint64_t overwritten = (buffer->head.load(std::memory_order_acquire) + 1);
+        size_t skip = static_cast<size_t>(std::min<uint64_t>(((overwritten > (first + capacity)) ? (overwritten - (first + capacity)) : 0), events.size()));
+
+        for (size_t i = skip; i < events.size(); ++i)
+        {
+          const Event &event = events[i];
+          std::fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", event.name, pid, buffer->tid, (event.start_ns / 1000.0), (event.duration_ns / 1000.0));
+          if (event.sequence)
+          {
+            std::fprintf(out, ",\"args\":{\"frame\":%u}", event.sequence);
+          }
+          std::fprintf(out, "}");
+          ++written;
+        }
+      }
+      std::fprintf(out, "\n]}\n");
+      if (std::fclose(out))
+      {
+        perror(_path.c_str());
+        return -1;
+      }
+      return written;
+    }
+
+    /**
+     * \brief Monotonic time (ns), the clock of every span
+     */
+    static uint64_t now(void)
+    {
+      struct timespec time;
+      clock_gettime(CLOCK_MONOTONIC, &time);
+      return ((static_cast<uint64_t>(time.tv_sec) * 1000000000ull) + time.tv_nsec);
+    }
+
+  private:
+    struct Event
+    {
+      const char *name;
+      uint64_t start_ns;
+      uint32_t duration_ns;
+      uint32_t sequence;
+    };
+
+    struct ThreadBuffer
+    {
+      int tid;
+      std::string name;
+      std::vector<Event> events;
+      std::atomic<uint64_t> head;
+    };
+
+    std::atomic<bool> _enabled;
+    size_t _capacity;
+    std::atomic<bool> _dump_requested;
+    std::mutex _mutex; // buffer list, names and capacity
+    std::vector<std::unique_ptr<ThreadBuffer> > _buffers;
+
+    /**
+     * \brief The calling thread's ring (registered on first use; rings
+     *        outlive their threads, so a dump still shows them)
+     */
+    ThreadBuffer &threadBuffer(void)
+    {
+      static thread_local ThreadBuffer *cached = nullptr;
+      if (!cached)
+      {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        buffer->tid = static_cast<int>(syscall(SYS_gettid));
+        buffer->head.store(0, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(_mutex);
+        buffer->events.resize(_capacity);
+        cached = buffer.get();
+        _buffers.push_back(std::move(buffer));
+      }
+      return *cached;
+    }
+
+    static void writeEscaped(FILE *_out, const std::string &_text)
+    {
+      for (char c : _text)
+      {
+        if (c == '"' || c == '\\')
+        {
+          std::fputc('\\', _out);
+        }
+        std::fputc((static_cast<unsigned char>(c) < 0x20) ? ' ' : c, _out);
+      }
+    }
+  };
+
+  /**
+   * \brief The process-wide tracer
+   */
+  inline Tracer &tracer(void)
+  {
+    static Tracer instance;
+    return instance;
+  }
+
+  /**
+   * \brief Records the enclosing scope as a span (nothing while tracing is
+   *        disabled)
+   */
+  class TraceSpan
+  {
+  public:
+    /**
+     * \param[in] _name Stage name (a string literal)
+     * \param[in] _sequence Frame the stage works on (0: none or not yet known)
+     */
+    explicit TraceSpan(const char *_name, uint64_t _sequence = 0) : _name(_name), _sequence(_sequence), _start_ns(tracer().enabled() ? Tracer::now() : 0) {}
+
+    ~TraceSpan(void)
+    {
+      if (_start_ns)
+      {
+        tracer().record(_name, _start_ns, Tracer::now(), _sequence);
+      }
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    /**
+     * \brief Set the frame once it is known (e.g. after acquiring it)
+     */
+    void setSequence(uint64_t _new_sequence)
+    {
+      _sequence = _new_sequence;
+    }
+
+  private:
+    const char *_name;
+    uint64_t _sequence;
+    uint64_t _start_ns;
+  };
+} // namespace zak
+
+#endif // ZAK_TRACE_HPP
@@ -0,0 +1,77 @@
+#ifndef ZAK_TRIPLE_BUFFER_HPP
+#define ZAK_TRIPLE_BUFFER_HPP
+
+// C/C++ Libraries
+#include <atomic>
+#include <cstdint>
+
+namespace zak
+{
+  /**
+   * \brief Index protocol of a latest-only triple buffer (one producer, one
+   *        consumer)
+   *
+   * Of three slots, the producer owns a "back" slot it fills and the
+   * consumer a "front" slot it reads; the third, "middle" slot is shared and
+   * held here, with a FRESH bit while it holds a slot the consumer has not
+   * taken. `publish` swaps the back slot in as the middle one and `acquire`
+   * swaps the front slot for a fresh middle one, each with one atomic
+   * exchange, so neither side ever waits and the consumer always gets the
+   * newest slot. The owner keeps the slots and its own back/front indices
+   * (on separate cache lines from this one).
+   */
+  class TripleBuffer
+  {
+  public:
+    TripleBuffer(void) : _middle(1) {}
+
+    /**
+     * \brief Make `_new_middle` the (stale) middle slot (while neither side
+     *        runs)
+     */
+    void reset(uint32_t _new_middle)
+    {
+      _middle.store(_new_middle, std::memory_order_release);
+    }
+
+    /**
+     * \brief Hand over the filled back slot (producer; wait-free)
+     *
+     * \param[out] _overwritten Whether it replaced a slot the consumer never took
+     * \return The slot to fill next
+     */
+    uint32_t publish(uint32_t _back, bool &_overwritten)
+    {
+      uint32_t previous = _middle.exchange((_back | FRESH), std::memory_order_acq_rel);
+      _overwritten = ((previous & FRESH) != 0);
+      return (previous & INDEX_MASK);
+    }
+
+    /**
+     * \brief Whether a slot was published since the last `acquire`
+     */
+    bool fresh(void) const
+    {
+      return ((_middle.load(std::memory_order_relaxed) & FRESH) != 0);
+    }
+
+    /**
+     * \brief Trade the front slot for the newest one (consumer; wait-free;
+     *        only when `fresh`)
+     *
+     * \return The new front slot
+     */
+    uint32_t acquire(uint32_t _front)
+    {
+      return (_middle.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK);
+    }
+
+  private:
+    static const uint32_t FRESH = 0x80;
+    static const uint32_t INDEX_MASK = 0x7F;
+
+    std::atomic<uint32_t> _middle;
+  };
+} // namespace zak
+
+#endif // ZAK_TRIPLE_BUFFER_HPP